@@ -0,0 +1,115 @@
+#include "vulkan_command_allocator.h"
+#include <algorithm>
+
+VulkanCommandAllocator::VulkanCommandAllocator(VkDevice device, SVulkanCommandAllocatorConfig config)
+    : device_(device), config_(config)
+{
+    config_.frame_count = std::max(config_.frame_count, 1u);
+}
+
+VulkanCommandAllocator::~VulkanCommandAllocator()
+{
+    // destroying a pool frees its command buffers
+    thread_pools_.ForEach(
+        [this](SThreadPools& thread_pools)
+        {
+            for (auto& frame : thread_pools.frames)
+            {
+                if (frame.command_pool != VK_NULL_HANDLE)
+                {
+                    vkDestroyCommandPool(device_, frame.command_pool, nullptr);
+                }
+            }
+        });
+}
+
+VkCommandBuffer VulkanCommandAllocator::Allocate(uint32_t frame_index, VkCommandBufferLevel level)
+{
+    auto* thread_pools = get_thread_pools();
+    if (thread_pools == nullptr)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    auto& frame           = thread_pools->frames[frame_index % config_.frame_count];
+    auto& command_buffers = frame.command_buffers[level];
+    auto& used_count      = frame.used_count[level];
+    if (used_count < command_buffers.size())
+    {
+        return command_buffers[used_count++];
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool        = frame.command_pool;
+    alloc_info.level              = level;
+    alloc_info.commandBufferCount = 1;
+
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    VkResult result                = vkAllocateCommandBuffers(device_, &alloc_info, &command_buffer);
+    if (result != VK_SUCCESS)
+    {
+        Logger::LogWithVkResult(result, "Failed to allocate command buffer", "");
+        return VK_NULL_HANDLE;
+    }
+    command_buffers.push_back(command_buffer);
+    ++used_count;
+    return command_buffer;
+}
+
+bool VulkanCommandAllocator::ResetFrame(uint32_t frame_index)
+{
+    bool succeeded = true;
+    thread_pools_.ForEach(
+        [this, frame_index, &succeeded](SThreadPools& thread_pools)
+        {
+            auto& frame = thread_pools.frames[frame_index % config_.frame_count];
+            if (frame.used_count[VK_COMMAND_BUFFER_LEVEL_PRIMARY] == 0 && frame.used_count[VK_COMMAND_BUFFER_LEVEL_SECONDARY] == 0)
+            {
+                return;
+            }
+
+            VkResult result = vkResetCommandPool(device_, frame.command_pool, 0);
+            if (result != VK_SUCCESS)
+            {
+                Logger::LogWithVkResult(result, "Failed to reset command pool", "");
+                succeeded = false;
+            }
+            frame.used_count[VK_COMMAND_BUFFER_LEVEL_PRIMARY]   = 0;
+            frame.used_count[VK_COMMAND_BUFFER_LEVEL_SECONDARY] = 0;
+        });
+    return succeeded;
+}
+
+VulkanCommandAllocator::SThreadPools* VulkanCommandAllocator::get_thread_pools()
+{
+    return thread_pools_.Get(
+        [this]() -> std::unique_ptr<SThreadPools>
+        {
+            // no RESET_COMMAND_BUFFER_BIT, buffers are only ever reset with their pool
+            VkCommandPoolCreateInfo pool_info{};
+            pool_info.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            pool_info.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            pool_info.queueFamilyIndex = config_.queue_family_index;
+
+            auto thread_pools = std::make_unique<SThreadPools>();
+            thread_pools->frames.resize(config_.frame_count);
+            for (auto& frame : thread_pools->frames)
+            {
+                VkResult result = vkCreateCommandPool(device_, &pool_info, nullptr, &frame.command_pool);
+                if (result != VK_SUCCESS)
+                {
+                    Logger::LogWithVkResult(result, "Failed to create command pool", "");
+                    for (auto& created : thread_pools->frames)
+                    {
+                        if (created.command_pool != VK_NULL_HANDLE)
+                        {
+                            vkDestroyCommandPool(device_, created.command_pool, nullptr);
+                        }
+                    }
+                    return nullptr;
+                }
+            }
+            return thread_pools;
+        });
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "_templates/thread_slots.h"
+#include "utility/logger.h"
+
+struct SVulkanCommandAllocatorConfig
+{
+    uint32_t queue_family_index;
+    uint32_t frame_count;
+};
+
+/// @brief Hands out command buffers from per-thread, per-frame command pools.
+/// @note 1.every thread owns one transient pool per frame in flight, created on its first allocation.
+/// @note 2.ResetFrame resets every thread's pool of a frame slot with vkResetCommandPool, command buffers are recycled.
+/// @note 3.ResetFrame must run once the frame that last used the slot has retired and must not race with allocations of that slot.
+class VulkanCommandAllocator
+{
+public:
+    VulkanCommandAllocator(VkDevice device, SVulkanCommandAllocatorConfig config);
+    ~VulkanCommandAllocator();
+
+    VulkanCommandAllocator(const VulkanCommandAllocator&)            = delete;
+    VulkanCommandAllocator& operator=(const VulkanCommandAllocator&) = delete;
+
+    /// @brief take a command buffer from the calling thread's pool of a frame slot
+    /// @return the command buffer in the initial state, VK_NULL_HANDLE on failure
+    VkCommandBuffer Allocate(uint32_t frame_index, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+    /// @brief reset every thread's pool of a frame slot
+    bool ResetFrame(uint32_t frame_index);
+
+private:
+    struct SFramePool
+    {
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> command_buffers[2]; // indexed by VkCommandBufferLevel
+        uint32_t used_count[2] = {0, 0};
+    };
+
+    struct SThreadPools
+    {
+        std::vector<SFramePool> frames;
+    };
+
+    VkDevice device_;
+    SVulkanCommandAllocatorConfig config_;
+    templates::ThreadSlots<SThreadPools> thread_pools_;
+
+    /// @brief pools of the calling thread, created on first use
+    SThreadPools* get_thread_pools();
+};
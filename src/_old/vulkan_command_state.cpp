@@ -0,0 +1,185 @@
+#include "vulkan_command_state.h"
+#include <algorithm>
+
+SVulkanDynamicStateFunctions SVulkanDynamicStateFunctions::Load(VkDevice device, SVulkanDynamicStateConfig config)
+{
+    SVulkanDynamicStateFunctions functions;
+    if (config.vertex_input)
+    {
+        functions.set_vertex_input =
+            reinterpret_cast<PFN_vkCmdSetVertexInputEXT>(vkGetDeviceProcAddr(device, "vkCmdSetVertexInputEXT"));
+    }
+    if (config.color_blend_enable)
+    {
+        functions.set_color_blend_enable =
+            reinterpret_cast<PFN_vkCmdSetColorBlendEnableEXT>(vkGetDeviceProcAddr(device, "vkCmdSetColorBlendEnableEXT"));
+    }
+    return functions;
+}
+
+VulkanCommandStateCache::VulkanCommandStateCache(VkCommandBuffer command_buffer, const SVulkanDynamicStateFunctions& functions)
+    : command_buffer_(command_buffer), functions_(functions)
+{
+}
+
+bool VulkanCommandStateCache::changed(bool differs)
+{
+    if (differs)
+    {
+        ++recorded_count_;
+    }
+    else
+    {
+        ++skipped_count_;
+    }
+    return differs;
+}
+
+void VulkanCommandStateCache::BindPipeline(const VulkanPipelineHelper& pipeline)
+{
+    if (!changed(pipeline.GetPipeline() != pipeline_))
+    {
+        return;
+    }
+    vkCmdBindPipeline(command_buffer_, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.GetPipeline());
+    pipeline_ = pipeline.GetPipeline();
+
+    // states the new pipeline bakes in overwrite whatever was set dynamically before
+    const auto& config    = pipeline.GetConfig();
+    dynamic_raster_state_ = config.dynamic_raster_state;
+    dynamic_vertex_input_ = config.dynamic_vertex_input && functions_.set_vertex_input != nullptr;
+    dynamic_blend_enable_ = config.dynamic_blend_enable && functions_.set_color_blend_enable != nullptr;
+    has_raster_state_     = has_raster_state_ && dynamic_raster_state_;
+    has_vertex_input_     = has_vertex_input_ && dynamic_vertex_input_;
+    has_blend_enable_     = has_blend_enable_ && dynamic_blend_enable_;
+}
+
+void VulkanCommandStateCache::SetViewport(const VkViewport& viewport)
+{
+    bool differs = !has_viewport_ || viewport.x != viewport_.x || viewport.y != viewport_.y ||
+                   viewport.width != viewport_.width || viewport.height != viewport_.height ||
+                   viewport.minDepth != viewport_.minDepth || viewport.maxDepth != viewport_.maxDepth;
+    if (!changed(differs))
+    {
+        return;
+    }
+    vkCmdSetViewport(command_buffer_, 0, 1, &viewport);
+    viewport_     = viewport;
+    has_viewport_ = true;
+}
+
+void VulkanCommandStateCache::SetScissor(const VkRect2D& scissor)
+{
+    bool differs = !has_scissor_ || scissor.offset.x != scissor_.offset.x || scissor.offset.y != scissor_.offset.y ||
+                   scissor.extent.width != scissor_.extent.width || scissor.extent.height != scissor_.extent.height;
+    if (!changed(differs))
+    {
+        return;
+    }
+    vkCmdSetScissor(command_buffer_, 0, 1, &scissor);
+    scissor_     = scissor;
+    has_scissor_ = true;
+}
+
+void VulkanCommandStateCache::SetRasterState(const SVulkanRasterState& raster_state)
+{
+    if (dynamic_raster_state_)
+    {
+        bool all = !has_raster_state_;
+        if (changed(all || raster_state.cull_mode != raster_state_.cull_mode))
+            vkCmdSetCullMode(command_buffer_, raster_state.cull_mode);
+        if (changed(all || raster_state.front_face != raster_state_.front_face))
+            vkCmdSetFrontFace(command_buffer_, raster_state.front_face);
+        if (changed(all || raster_state.topology != raster_state_.topology))
+            vkCmdSetPrimitiveTopology(command_buffer_, raster_state.topology);
+        if (changed(all || raster_state.depth_test_enable != raster_state_.depth_test_enable))
+            vkCmdSetDepthTestEnable(command_buffer_, raster_state.depth_test_enable);
+        if (changed(all || raster_state.depth_write_enable != raster_state_.depth_write_enable))
+            vkCmdSetDepthWriteEnable(command_buffer_, raster_state.depth_write_enable);
+        if (changed(all || raster_state.depth_compare_op != raster_state_.depth_compare_op))
+            vkCmdSetDepthCompareOp(command_buffer_, raster_state.depth_compare_op);
+        if (changed(all || raster_state.depth_bias_enable != raster_state_.depth_bias_enable))
+            vkCmdSetDepthBiasEnable(command_buffer_, raster_state.depth_bias_enable);
+        if (changed(all || raster_state.primitive_restart_enable != raster_state_.primitive_restart_enable))
+            vkCmdSetPrimitiveRestartEnable(command_buffer_, raster_state.primitive_restart_enable);
+        raster_state_     = raster_state;
+        has_raster_state_ = true;
+    }
+
+    if (dynamic_blend_enable_ && changed(!has_blend_enable_ || raster_state.blend_enable != blend_enable_))
+    {
+        functions_.set_color_blend_enable(command_buffer_, 0, 1, &raster_state.blend_enable);
+        blend_enable_     = raster_state.blend_enable;
+        has_blend_enable_ = true;
+    }
+}
+
+void VulkanCommandStateCache::SetVertexInput(const VkVertexInputBindingDescription& binding,
+                                             const std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+    if (!dynamic_vertex_input_)
+    {
+        return;
+    }
+
+    auto same_attribute = [](const VkVertexInputAttributeDescription& lhs, const VkVertexInputAttributeDescription& rhs)
+    {
+        return lhs.location == rhs.location && lhs.binding == rhs.binding && lhs.format == rhs.format &&
+               lhs.offset == rhs.offset;
+    };
+    bool differs = !has_vertex_input_ || binding.binding != vertex_binding_.binding ||
+                   binding.stride != vertex_binding_.stride || binding.inputRate != vertex_binding_.inputRate ||
+                   !std::equal(attributes.begin(), attributes.end(), vertex_attributes_.begin(), vertex_attributes_.end(), same_attribute);
+    if (!changed(differs))
+    {
+        return;
+    }
+
+    VkVertexInputBindingDescription2EXT binding_description{};
+    binding_description.sType     = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT;
+    binding_description.binding   = binding.binding;
+    binding_description.stride    = binding.stride;
+    binding_description.inputRate = binding.inputRate;
+    binding_description.divisor   = 1;
+
+    std::vector<VkVertexInputAttributeDescription2EXT> attribute_descriptions(attributes.size());
+    for (size_t i = 0; i < attributes.size(); ++i)
+    {
+        attribute_descriptions[i].sType    = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT;
+        attribute_descriptions[i].location = attributes[i].location;
+        attribute_descriptions[i].binding  = attributes[i].binding;
+        attribute_descriptions[i].format   = attributes[i].format;
+        attribute_descriptions[i].offset   = attributes[i].offset;
+    }
+    functions_.set_vertex_input(command_buffer_,
+                                1,
+                                &binding_description,
+                                static_cast<uint32_t>(attribute_descriptions.size()),
+                                attribute_descriptions.data());
+    vertex_binding_    = binding;
+    vertex_attributes_ = attributes;
+    has_vertex_input_  = true;
+}
+
+void VulkanCommandStateCache::BindVertexBuffer(VkBuffer buffer, VkDeviceSize offset)
+{
+    if (!changed(buffer != vertex_buffer_ || offset != vertex_offset_))
+    {
+        return;
+    }
+    vkCmdBindVertexBuffers(command_buffer_, 0, 1, &buffer, &offset);
+    vertex_buffer_ = buffer;
+    vertex_offset_ = offset;
+}
+
+void VulkanCommandStateCache::BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType index_type)
+{
+    if (!changed(buffer != index_buffer_ || offset != index_offset_ || index_type != index_type_))
+    {
+        return;
+    }
+    vkCmdBindIndexBuffer(command_buffer_, buffer, offset, index_type);
+    index_buffer_ = buffer;
+    index_offset_ = offset;
+    index_type_   = index_type;
+}
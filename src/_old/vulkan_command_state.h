@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "vulkan_pipeline.h"
+
+struct SVulkanDynamicStateConfig
+{
+    bool vertex_input       = false; // VK_EXT_vertex_input_dynamic_state enabled on the device
+    bool color_blend_enable = false; // VK_EXT_extended_dynamic_state3 colorBlendEnable enabled on the device
+};
+
+/// @brief Entry points of the dynamic states beyond core 1.3, the loader does not export extension commands.
+struct SVulkanDynamicStateFunctions
+{
+    PFN_vkCmdSetVertexInputEXT set_vertex_input            = nullptr;
+    PFN_vkCmdSetColorBlendEnableEXT set_color_blend_enable = nullptr;
+
+    static SVulkanDynamicStateFunctions Load(VkDevice device, SVulkanDynamicStateConfig config);
+};
+
+/// @brief Raster state one draw needs, only the parts its pipeline declares dynamic are applied.
+struct SVulkanRasterState
+{
+    VkCullModeFlags cull_mode         = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace front_face            = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    VkPrimitiveTopology topology      = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkBool32 depth_test_enable        = VK_TRUE;
+    VkBool32 depth_write_enable       = VK_TRUE;
+    VkCompareOp depth_compare_op      = VK_COMPARE_OP_LESS;
+    VkBool32 depth_bias_enable        = VK_FALSE;
+    VkBool32 primitive_restart_enable = VK_FALSE;
+    VkBool32 blend_enable             = VK_FALSE;
+};
+
+/// @brief Records binds and dynamic state into one command buffer, dropping commands that would not change anything.
+/// @note 1.one instance per command buffer, state is not inherited by secondary command buffers.
+/// @note 2.binding a different pipeline forgets the dynamic states it bakes in, they are set again on the next draw.
+class VulkanCommandStateCache
+{
+public:
+    VulkanCommandStateCache(VkCommandBuffer command_buffer, const SVulkanDynamicStateFunctions& functions);
+
+    void BindPipeline(const VulkanPipelineHelper& pipeline);
+    void SetViewport(const VkViewport& viewport);
+    void SetScissor(const VkRect2D& scissor);
+    void SetRasterState(const SVulkanRasterState& raster_state);
+    /// @brief only recorded when the bound pipeline has dynamic vertex input
+    void SetVertexInput(const VkVertexInputBindingDescription& binding, const std::vector<VkVertexInputAttributeDescription>& attributes);
+    void BindVertexBuffer(VkBuffer buffer, VkDeviceSize offset);
+    void BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType index_type);
+
+    uint32_t GetRecordedCount() const { return recorded_count_; }
+    uint32_t GetSkippedCount() const { return skipped_count_; }
+
+private:
+    VkCommandBuffer command_buffer_;
+    const SVulkanDynamicStateFunctions& functions_;
+
+    VkPipeline pipeline_ = VK_NULL_HANDLE;
+    bool dynamic_raster_state_ = false;
+    bool dynamic_vertex_input_ = false;
+    bool dynamic_blend_enable_ = false;
+
+    bool has_viewport_ = false;
+    VkViewport viewport_{};
+    bool has_scissor_ = false;
+    VkRect2D scissor_{};
+    bool has_raster_state_ = false;
+    SVulkanRasterState raster_state_{};
+    bool has_blend_enable_ = false;
+    VkBool32 blend_enable_ = VK_FALSE;
+    bool has_vertex_input_ = false;
+    VkVertexInputBindingDescription vertex_binding_{};
+    std::vector<VkVertexInputAttributeDescription> vertex_attributes_;
+
+    VkBuffer vertex_buffer_ = VK_NULL_HANDLE;
+    VkDeviceSize vertex_offset_ = 0;
+    VkBuffer index_buffer_ = VK_NULL_HANDLE;
+    VkDeviceSize index_offset_ = 0;
+    VkIndexType index_type_ = VK_INDEX_TYPE_UINT32;
+
+    uint32_t recorded_count_ = 0;
+    uint32_t skipped_count_ = 0;
+
+    /// @brief count the command, true if it has to be recorded
+    bool changed(bool differs);
+};
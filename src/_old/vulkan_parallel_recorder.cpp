@@ -0,0 +1,139 @@
+#include "vulkan_parallel_recorder.h"
+#include <algorithm>
+
+VulkanParallelRecorder::VulkanParallelRecorder(VulkanCommandAllocator& command_allocator, SVulkanParallelRecorderConfig config)
+    : command_allocator_(command_allocator), config_(config)
+{
+    if (config_.thread_count == 0)
+    {
+        config_.thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    config_.min_draws_per_thread = std::max(config_.min_draws_per_thread, 1u);
+}
+
+VulkanParallelRecorder::~VulkanParallelRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    job_condition_.notify_all();
+
+    for (auto& worker : workers_)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    workers_.clear();
+}
+
+bool VulkanParallelRecorder::Initialize()
+{
+    for (uint32_t i = 0; i < config_.thread_count; ++i)
+    {
+        workers_.emplace_back(&VulkanParallelRecorder::worker_loop, this, i);
+    }
+    Logger::LogInfo("Parallel recorder started " + std::to_string(workers_.size()) + " worker threads");
+    return true;
+}
+
+uint32_t VulkanParallelRecorder::GetPartitionCount(uint32_t draw_count) const
+{
+    uint32_t wanted = (draw_count + config_.min_draws_per_thread - 1) / config_.min_draws_per_thread;
+    return std::min(wanted, static_cast<uint32_t>(workers_.size()));
+}
+
+bool VulkanParallelRecorder::Record(uint32_t frame_index,
+                                    const VkCommandBufferInheritanceInfo& inheritance_info,
+                                    uint32_t draw_count,
+                                    const RecordFunction& record_function,
+                                    std::vector<VkCommandBuffer>& secondary_command_buffers)
+{
+    uint32_t partition_count = GetPartitionCount(draw_count);
+    secondary_command_buffers.assign(partition_count, VK_NULL_HANDLE);
+    if (partition_count == 0)
+    {
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_             = {frame_index, &inheritance_info, &record_function, draw_count, partition_count, &secondary_command_buffers};
+        pending_workers_ = static_cast<uint32_t>(workers_.size());
+        job_failed_.store(false, std::memory_order_relaxed);
+        ++job_generation_;
+    }
+    job_condition_.notify_all();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_condition_.wait(lock, [this] { return pending_workers_ == 0; });
+    return !job_failed_.load(std::memory_order_relaxed);
+}
+
+void VulkanParallelRecorder::worker_loop(uint32_t worker_index)
+{
+    uint64_t seen_generation = 0;
+    while (true)
+    {
+        SJob job{};
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            job_condition_.wait(lock, [this, seen_generation] { return stop_ || job_generation_ != seen_generation; });
+            if (stop_)
+            {
+                return;
+            }
+            seen_generation = job_generation_;
+            job             = job_;
+        }
+
+        // workers past the partition count only acknowledge the job
+        if (worker_index < job.partition_count && !record_partition(job, worker_index))
+        {
+            job_failed_.store(true, std::memory_order_relaxed);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_workers_ == 0)
+        {
+            done_condition_.notify_one();
+        }
+    }
+}
+
+bool VulkanParallelRecorder::record_partition(const SJob& job, uint32_t partition_index)
+{
+    // contiguous ranges keep the draw order when the secondaries are executed in order
+    auto first_draw = static_cast<uint32_t>(static_cast<uint64_t>(job.draw_count) * partition_index / job.partition_count);
+    auto end_draw   = static_cast<uint32_t>(static_cast<uint64_t>(job.draw_count) * (partition_index + 1) / job.partition_count);
+
+    VkCommandBuffer command_buffer = command_allocator_.Allocate(job.frame_index, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    if (command_buffer == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = job.inheritance_info;
+    VkResult result             = vkBeginCommandBuffer(command_buffer, &begin_info);
+    if (result != VK_SUCCESS)
+    {
+        Logger::LogWithVkResult(result, "Failed to begin secondary command buffer", "");
+        return false;
+    }
+
+    (*job.record_function)(command_buffer, first_draw, end_draw - first_draw);
+
+    result = vkEndCommandBuffer(command_buffer);
+    if (result != VK_SUCCESS)
+    {
+        Logger::LogWithVkResult(result, "Failed to end secondary command buffer", "");
+        return false;
+    }
+    (*job.secondary_command_buffers)[partition_index] = command_buffer;
+    return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "utility/logger.h"
+#include "vulkan_command_allocator.h"
+
+struct SVulkanParallelRecorderConfig
+{
+    uint32_t thread_count;                // worker threads, 0 picks hardware concurrency - 1
+    uint32_t min_draws_per_thread = 2048; // smaller partitions cost more in thread handoff than they save
+};
+
+/// @brief Records a draw list in parallel into secondary command buffers.
+/// @note 1.secondaries come from the workers' own pools of the command allocator, reset with their frame slot.
+/// @note 2.secondaries do not inherit state, the record function binds everything it uses.
+/// @note 3.Record is called from one thread.
+class VulkanParallelRecorder
+{
+public:
+    /// @brief records draws [first_draw, first_draw + draw_count) into a secondary command buffer
+    using RecordFunction = std::function<void(VkCommandBuffer command_buffer, uint32_t first_draw, uint32_t draw_count)>;
+
+    VulkanParallelRecorder(VulkanCommandAllocator& command_allocator, SVulkanParallelRecorderConfig config);
+    ~VulkanParallelRecorder();
+
+    bool Initialize();
+
+    /// @brief number of secondaries Record would produce, 1 or less means recording inline is cheaper
+    uint32_t GetPartitionCount(uint32_t draw_count) const;
+
+    /// @brief partition the draw list across the workers and record it
+    /// @param frame_index frame slot the secondaries are allocated for
+    /// @param inheritance_info render pass or dynamic rendering state the secondaries execute in
+    /// @param draw_count number of draws in the list
+    /// @param record_function called once per partition on a worker thread
+    /// @param secondary_command_buffers output secondaries in draw order, to be executed with vkCmdExecuteCommands
+    /// @return true if every partition was recorded
+    bool Record(uint32_t frame_index,
+                const VkCommandBufferInheritanceInfo& inheritance_info,
+                uint32_t draw_count,
+                const RecordFunction& record_function,
+                std::vector<VkCommandBuffer>& secondary_command_buffers);
+
+private:
+    struct SJob
+    {
+        uint32_t frame_index;
+        const VkCommandBufferInheritanceInfo* inheritance_info;
+        const RecordFunction* record_function;
+        uint32_t draw_count;
+        uint32_t partition_count;
+        std::vector<VkCommandBuffer>* secondary_command_buffers;
+    };
+
+    VulkanCommandAllocator& command_allocator_;
+    SVulkanParallelRecorderConfig config_;
+    std::vector<std::thread> workers_;
+
+    // job handoff, every worker acknowledges every job
+    std::mutex mutex_;
+    std::condition_variable job_condition_;
+    std::condition_variable done_condition_;
+    SJob job_{};
+    uint64_t job_generation_ = 0;
+    uint32_t pending_workers_ = 0;
+    bool stop_ = false;
+    std::atomic<bool> job_failed_ = false;
+
+    void worker_loop(uint32_t worker_index);
+    bool record_partition(const SJob& job, uint32_t partition_index);
+};
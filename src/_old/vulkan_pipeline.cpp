@@ -1,4 +1,5 @@
 #include "vulkan_pipeline.h"
+#include <cstddef>
 
 VulkanPipelineHelper::~VulkanPipelineHelper()
 {
@@ -14,9 +15,41 @@ VulkanPipelineHelper::~VulkanPipelineHelper()
     }
 }
 
-bool VulkanPipelineHelper::CreatePipeline(VkDevice device)
+bool VulkanPipelineHelper::CreatePipeline(VkDevice device, VkPipelineCache pipeline_cache)
+{
+    return create_pipeline(device, pipeline_cache, 0, {}, 0);
+}
+
+bool VulkanPipelineHelper::CreateLibraryPart(VkDevice device, VkPipelineCache pipeline_cache, VkGraphicsPipelineLibraryFlagsEXT part)
+{
+    return create_pipeline(device,
+                           pipeline_cache,
+                           part,
+                           {},
+                           VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT);
+}
+
+bool VulkanPipelineHelper::LinkLibraries(VkDevice device, VkPipelineCache pipeline_cache, const std::vector<VkPipeline>& libraries, bool optimize)
+{
+    return create_pipeline(device, pipeline_cache, 0, libraries, optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0);
+}
+
+bool VulkanPipelineHelper::create_pipeline(VkDevice device,
+                                           VkPipelineCache pipeline_cache,
+                                           VkGraphicsPipelineLibraryFlagsEXT parts,
+                                           const std::vector<VkPipeline>& libraries,
+                                           VkPipelineCreateFlags flags)
 {
     device_ = device;
+
+    // which parts of the state this pipeline carries, a monolithic pipeline carries all of them
+    bool is_linked = !libraries.empty();
+    bool is_monolithic = parts == 0 && !is_linked;
+    bool has_vertex_input = is_monolithic || (parts & VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT);
+    bool has_pre_rasterization = is_monolithic || (parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT);
+    bool has_fragment_shader = is_monolithic || (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+    bool has_fragment_output = is_monolithic || (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT);
+    bool needs_layout = has_pre_rasterization || has_fragment_shader || is_linked;
     
     // input assembly
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -59,7 +92,7 @@ bool VulkanPipelineHelper::CreatePipeline(VkDevice device)
     rasterizer.rasterizerDiscardEnable = VK_FALSE; // Disable if you want to draw
     rasterizer.polygonMode = VK_POLYGON_MODE_FILL; // Fill the polygon
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.cullMode = config_.cull_mode;
     // 如果模型依然颠倒，可以尝试更改这个值
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE; // 或者尝试 VK_FRONT_FACE_CLOCKWISE
     rasterizer.depthBiasEnable = VK_FALSE;
@@ -80,9 +113,9 @@ bool VulkanPipelineHelper::CreatePipeline(VkDevice device)
     // depth and stencil testing
     VkPipelineDepthStencilStateCreateInfo depthStencil{};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;           // 启用深度测试
-    depthStencil.depthWriteEnable = VK_TRUE;          // 启用深度写入
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS; // 使用小于比较操作（标准深度测试）
+    depthStencil.depthTestEnable = config_.depth_test_enable;   // 启用深度测试
+    depthStencil.depthWriteEnable = config_.depth_write_enable; // 启用深度写入
+    depthStencil.depthCompareOp = config_.depth_compare_op;     // 默认使用小于比较操作（标准深度测试）
     depthStencil.depthBoundsTestEnable = VK_FALSE;    // 禁用深度边界测试
     depthStencil.minDepthBounds = 0.0f;               // 可选
     depthStencil.maxDepthBounds = 1.0f;               // 可选
@@ -93,9 +126,11 @@ bool VulkanPipelineHelper::CreatePipeline(VkDevice device)
     // color blending
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
+    colorBlendAttachment.blendEnable = config_.blend_enable;
+    // straight alpha blending when enabled, a dynamic blend enable keeps the factors so it can be switched on
+    bool has_blend_factors = config_.blend_enable || config_.dynamic_blend_enable;
+    colorBlendAttachment.srcColorBlendFactor = has_blend_factors ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstColorBlendFactor = has_blend_factors ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
     colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
     colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
     colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
@@ -117,10 +152,11 @@ bool VulkanPipelineHelper::CreatePipeline(VkDevice device)
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(config_.descriptor_set_layouts.size());
     pipelineLayoutInfo.pSetLayouts = config_.descriptor_set_layouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(config_.push_constant_ranges.size());
+    pipelineLayoutInfo.pPushConstantRanges = config_.push_constant_ranges.data();
 
-    if (!Logger::LogWithVkResult(vkCreatePipelineLayout(device_, &pipelineLayoutInfo, nullptr, &pipeline_layout_), 
+    // library parts and the linked pipeline each own an identically defined layout
+    if (needs_layout && !Logger::LogWithVkResult(vkCreatePipelineLayout(device_, &pipelineLayoutInfo, nullptr, &pipeline_layout_),
         "Failed to create pipeline layout", 
         "Created pipeline layout successfully"))
     {
@@ -128,68 +164,141 @@ bool VulkanPipelineHelper::CreatePipeline(VkDevice device)
     }
 
     VkPipelineShaderStageCreateInfo shader_stages[2];
+    VkSpecializationInfo specialization_infos[2];
+    std::vector<VkSpecializationMapEntry> specialization_entries[2];
+    uint32_t shader_stage_count = 0;
+    // the constants are read in place from the config, each entry points at the value of one SVulkanSpecializationConstant
+    auto get_specialization_info = [&](EShaderType shader_type, uint32_t index) -> const VkSpecializationInfo*
+    {
+        auto it = config_.specialization_constants.find(shader_type);
+        if (it == config_.specialization_constants.end() || it->second.empty())
+        {
+            return nullptr;
+        }
+        const auto& constants = it->second;
+        for (uint32_t i = 0; i < constants.size(); ++i)
+        {
+            specialization_entries[index].push_back({constants[i].constant_id,
+                                                     static_cast<uint32_t>(i * sizeof(SVulkanSpecializationConstant) + offsetof(SVulkanSpecializationConstant, value)),
+                                                     sizeof(uint32_t)});
+        }
+        specialization_infos[index].mapEntryCount = static_cast<uint32_t>(specialization_entries[index].size());
+        specialization_infos[index].pMapEntries = specialization_entries[index].data();
+        specialization_infos[index].dataSize = constants.size() * sizeof(SVulkanSpecializationConstant);
+        specialization_infos[index].pData = constants.data();
+        return &specialization_infos[index];
+    };
     // 获取顶点着色器模块
     auto it_vert = config_.shader_module_map.find(EShaderType::kVertexShader);
-    if (it_vert == config_.shader_module_map.end()) {
+    if (has_pre_rasterization && it_vert == config_.shader_module_map.end()) {
         Logger::LogError("Vertex shader module not found in pipeline config map.");
         return false;
     }
-    shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    shader_stages[0].module = it_vert->second;
-    shader_stages[0].pName = "main";
-    shader_stages[0].pSpecializationInfo = nullptr;
-    shader_stages[0].pNext = nullptr;
-    shader_stages[0].flags = 0;
+    if (has_pre_rasterization)
+    {
+        VkPipelineShaderStageCreateInfo& stage = shader_stages[shader_stage_count++];
+        stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        stage.module = it_vert->second;
+        stage.pName = "main";
+        stage.pSpecializationInfo = get_specialization_info(EShaderType::kVertexShader, shader_stage_count - 1);
+        stage.pNext = nullptr;
+        stage.flags = 0;
+    }
 
     // 获取片段着色器模块
     auto it_frag = config_.shader_module_map.find(EShaderType::kFragmentShader);
-    if (it_frag == config_.shader_module_map.end()) {
+    if (has_fragment_shader && it_frag == config_.shader_module_map.end()) {
         Logger::LogError("Fragment shader module not found in pipeline config map.");
         return false;
     }
-    shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shader_stages[1].module = it_frag->second;
-    shader_stages[1].pName = "main";
-    shader_stages[1].pSpecializationInfo = nullptr;
-    shader_stages[1].pNext = nullptr;
-    shader_stages[1].flags = 0;
+    if (has_fragment_shader)
+    {
+        VkPipelineShaderStageCreateInfo& stage = shader_stages[shader_stage_count++];
+        stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        stage.module = it_frag->second;
+        stage.pName = "main";
+        stage.pSpecializationInfo = get_specialization_info(EShaderType::kFragmentShader, shader_stage_count - 1);
+        stage.pNext = nullptr;
+        stage.flags = 0;
+    }
 
     std::vector<VkDynamicState> dynamicStates =
     {
         VK_DYNAMIC_STATE_VIEWPORT,
         VK_DYNAMIC_STATE_SCISSOR
     };
+    if (config_.dynamic_raster_state)
+    {
+        dynamicStates.insert(dynamicStates.end(), {
+            VK_DYNAMIC_STATE_CULL_MODE,
+            VK_DYNAMIC_STATE_FRONT_FACE,
+            VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY,
+            VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+            VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+            VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+            VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE,
+            VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE
+        });
+    }
+    if (config_.dynamic_vertex_input)
+    {
+        dynamicStates.push_back(VK_DYNAMIC_STATE_VERTEX_INPUT_EXT);
+    }
+    if (config_.dynamic_blend_enable)
+    {
+        dynamicStates.push_back(VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT);
+    }
 
     VkPipelineDynamicStateCreateInfo dynamicState{};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
     dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
     dynamicState.pDynamicStates = dynamicStates.data();
 
+    // attachment formats replace the render pass with dynamic rendering
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(config_.color_attachment_formats.size());
+    renderingInfo.pColorAttachmentFormats = config_.color_attachment_formats.data();
+    renderingInfo.depthAttachmentFormat = config_.depth_attachment_format;
+    renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+    const void* rendering_chain = config_.renderpass == VK_NULL_HANDLE ? &renderingInfo : nullptr;
+
+    // graphics pipeline library, the part being built or the libraries being linked
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryPartInfo{};
+    libraryPartInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryPartInfo.pNext = rendering_chain;
+    libraryPartInfo.flags = parts;
+
+    VkPipelineLibraryCreateInfoKHR linkInfo{};
+    linkInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    linkInfo.libraryCount = static_cast<uint32_t>(libraries.size());
+    linkInfo.pLibraries = libraries.data();
+
     // pipeline create info
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = static_cast<uint32_t>(std::size(shader_stages));
-    pipelineInfo.pStages = shader_stages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil; // 将深度测试状态添加到管线中
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.stageCount = shader_stage_count;
+    pipelineInfo.pStages = shader_stage_count > 0 ? shader_stages : nullptr;
+    pipelineInfo.pVertexInputState = has_vertex_input ? &vertexInputInfo : nullptr;
+    pipelineInfo.pInputAssemblyState = has_vertex_input ? &inputAssembly : nullptr;
+    pipelineInfo.pViewportState = has_pre_rasterization ? &viewportState : nullptr;
+    pipelineInfo.pRasterizationState = has_pre_rasterization ? &rasterizer : nullptr;
+    pipelineInfo.pMultisampleState = (has_fragment_shader || has_fragment_output) ? &multisampling : nullptr;
+    pipelineInfo.pDepthStencilState = has_fragment_shader ? &depthStencil : nullptr; // 将深度测试状态添加到管线中
+    pipelineInfo.pColorBlendState = has_fragment_output ? &colorBlending : nullptr;
+    pipelineInfo.pDynamicState = &dynamicState; // every part only picks the dynamic states of its own state
     pipelineInfo.layout = pipeline_layout_;
     pipelineInfo.renderPass = config_.renderpass;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
     pipelineInfo.basePipelineIndex = -1; // Optional
-    pipelineInfo.pNext = nullptr; // Optional
-    pipelineInfo.flags = 0; // Optional
+    pipelineInfo.pNext = is_linked ? static_cast<const void*>(&linkInfo) : (parts != 0 ? static_cast<const void*>(&libraryPartInfo) : rendering_chain);
+    pipelineInfo.flags = flags;
 
 
-    return Logger::LogWithVkResult(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline_), 
+    return Logger::LogWithVkResult(vkCreateGraphicsPipelines(device_, pipeline_cache, 1, &pipelineInfo, nullptr, &pipeline_),
         "Failed to create graphics pipeline", 
         "Succeeded in creating graphics pipeline");
 }
\ No newline at end of file
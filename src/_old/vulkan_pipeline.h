@@ -14,24 +14,56 @@ struct SVulkanPipelineConfig
 {
     VkExtent2D swap_chain_extent;
     std::map<EShaderType, VkShaderModule> shader_module_map;
-    VkRenderPass renderpass;
+    std::map<EShaderType, std::vector<SVulkanSpecializationConstant>> specialization_constants; // per stage, compiled into the variant
+    VkRenderPass renderpass = VK_NULL_HANDLE; // VK_NULL_HANDLE builds the pipeline for dynamic rendering
+    std::vector<VkFormat> color_attachment_formats; // dynamic rendering only
+    VkFormat depth_attachment_format = VK_FORMAT_UNDEFINED; // dynamic rendering only
     VkVertexInputBindingDescription vertex_input_binding_description;
     std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
     std::vector<VkDescriptorSetLayout> descriptor_set_layouts;
+    std::vector<VkPushConstantRange> push_constant_ranges;
+
+    // fixed function state
+    VkCullModeFlags cull_mode = VK_CULL_MODE_BACK_BIT;
+    VkBool32 depth_test_enable = VK_TRUE;
+    VkBool32 depth_write_enable = VK_TRUE;
+    VkCompareOp depth_compare_op = VK_COMPARE_OP_LESS;
+    VkBool32 blend_enable = VK_FALSE;
+
+    // extended dynamic state, set while recording instead of baked in so one pipeline covers every variation
+    bool dynamic_raster_state = false; // cull mode, front face, topology, depth test/write/compare, depth bias and primitive restart enable (core 1.3)
+    bool dynamic_vertex_input = false; // VK_EXT_vertex_input_dynamic_state
+    bool dynamic_blend_enable = false; // VK_EXT_extended_dynamic_state3 colorBlendEnable
 };
 
 class VulkanPipelineHelper
 {
 private:
     SVulkanPipelineConfig config_;
-    VkPipelineLayout pipeline_layout_;
-    VkPipeline pipeline_;
-    VkDevice device_;
+    VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+    VkPipeline pipeline_ = VK_NULL_HANDLE;
+    VkDevice device_ = VK_NULL_HANDLE;
 public:
     VulkanPipelineHelper(SVulkanPipelineConfig config) : config_(config) {}
     ~VulkanPipelineHelper();
 
-    bool CreatePipeline(VkDevice device);
+    bool CreatePipeline(VkDevice device, VkPipelineCache pipeline_cache = VK_NULL_HANDLE);
+
+    // VK_EXT_graphics_pipeline_library
+    // build one part of the pipeline as a library, it keeps link time optimization info for an optimized relink
+    bool CreateLibraryPart(VkDevice device, VkPipelineCache pipeline_cache, VkGraphicsPipelineLibraryFlagsEXT part);
+    // link complete libraries, fast link unless optimize is set
+    bool LinkLibraries(VkDevice device, VkPipelineCache pipeline_cache, const std::vector<VkPipeline>& libraries, bool optimize);
+
     VkPipeline GetPipeline() const { return pipeline_; }
     VkPipelineLayout GetPipelineLayout() const { return pipeline_layout_; }
+    const SVulkanPipelineConfig& GetConfig() const { return config_; }
+
+private:
+    // parts == 0 and no libraries builds a monolithic pipeline
+    bool create_pipeline(VkDevice device,
+                         VkPipelineCache pipeline_cache,
+                         VkGraphicsPipelineLibraryFlagsEXT parts,
+                         const std::vector<VkPipeline>& libraries,
+                         VkPipelineCreateFlags flags);
 };
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include "vulkan_pipeline_cache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // closing a stream only hands the data to the OS, a rename may reach the disk before it does
+    bool flush_to_disk(const std::string& path)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        bool flushed = FlushFileBuffers(file) != 0;
+        CloseHandle(file);
+        return flushed;
+#else
+        int file = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (file < 0)
+        {
+            return false;
+        }
+        bool flushed = fsync(file) == 0;
+        close(file);
+        return flushed;
+#endif
+    }
+
+    // the rename itself is an update of the directory
+    void flush_directory(const std::filesystem::path& path)
+    {
+#if !defined(_WIN32)
+        auto directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+        int file       = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file >= 0)
+        {
+            fsync(file);
+            close(file);
+        }
+#endif
+    }
+}
+
+VulkanPipelineCache::VulkanPipelineCache(VkDevice device, VkPhysicalDevice physical_device, SVulkanPipelineCacheConfig config)
+    : device_(device), physical_device_properties_{}, config_(std::move(config))
+{
+    vkGetPhysicalDeviceProperties(physical_device, &physical_device_properties_);
+}
+
+VulkanPipelineCache::~VulkanPipelineCache()
+{
+    stop_writer();
+    if (pipeline_cache_ != VK_NULL_HANDLE)
+    {
+        Save();
+        vkDestroyPipelineCache(device_, pipeline_cache_, nullptr);
+        pipeline_cache_ = VK_NULL_HANDLE;
+    }
+}
+
+bool VulkanPipelineCache::Initialize()
+{
+    std::vector<char> data;
+    warm_ = read_blob(data) && validate_header(data);
+    if (!warm_)
+    {
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo cache_info{};
+    cache_info.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.initialDataSize = data.size();
+    cache_info.pInitialData    = data.empty() ? nullptr : data.data();
+
+    if (!Logger::LogWithVkResult(vkCreatePipelineCache(device_, &cache_info, nullptr, &pipeline_cache_),
+                                 "Failed to create pipeline cache",
+                                 "Succeeded in creating pipeline cache"))
+    {
+        return false;
+    }
+    saved_size_  = data.size();
+    queued_size_ = data.size();
+    Logger::LogInfo(warm_ ? "Pipeline cache loaded " + std::to_string(data.size()) + " bytes from " + config_.cache_path
+                          : "Pipeline cache starts cold");
+
+    if (config_.save_interval_frames != 0 && !config_.cache_path.empty())
+    {
+        writer_ = std::thread(&VulkanPipelineCache::writer_loop, this);
+    }
+    return true;
+}
+
+bool VulkanPipelineCache::Save()
+{
+    if (pipeline_cache_ == VK_NULL_HANDLE || config_.cache_path.empty())
+    {
+        return false;
+    }
+
+    std::vector<char> data;
+    if (!get_data(saved_size_, data))
+    {
+        return false;
+    }
+    return data.empty() || write_blob(data);
+}
+
+void VulkanPipelineCache::Tick(uint64_t frame_serial)
+{
+    if (!writer_.joinable() || frame_serial - last_save_frame_ < config_.save_interval_frames)
+    {
+        return;
+    }
+    last_save_frame_ = frame_serial;
+
+    // reading the data is a copy in memory, the file system work is left to the writer
+    std::vector<char> data;
+    if (!get_data(queued_size_, data) || data.empty())
+    {
+        return;
+    }
+    queued_size_ = data.size();
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        pending_blob_     = std::move(data);
+        has_pending_blob_ = true;
+    }
+    writer_condition_.notify_one();
+}
+
+bool VulkanPipelineCache::get_data(size_t size_on_record, std::vector<char>& data) const
+{
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device_, pipeline_cache_, &size, nullptr) != VK_SUCCESS)
+    {
+        Logger::LogError("Failed to query pipeline cache size");
+        return false;
+    }
+    // the cache only grows, an unchanged size means nothing new was compiled
+    if (size == size_on_record)
+    {
+        data.clear();
+        return true;
+    }
+
+    data.resize(size);
+    if (!Logger::LogWithVkResult(vkGetPipelineCacheData(device_, pipeline_cache_, &size, data.data()),
+                                 "Failed to get pipeline cache data",
+                                 "Succeeded in getting pipeline cache data"))
+    {
+        data.clear();
+        return false;
+    }
+    data.resize(size);
+    return true;
+}
+
+bool VulkanPipelineCache::write_blob(const std::vector<char>& data)
+{
+    std::lock_guard<std::mutex> lock(file_mutex_);
+
+    // write next to the target, flush it and rename over the target, readers only ever see a complete blob
+    std::string temporary_path = config_.cache_path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            Logger::LogError("Failed to open " + temporary_path);
+            return false;
+        }
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file.good())
+        {
+            Logger::LogError("Failed to write " + temporary_path);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    if (!flush_to_disk(temporary_path))
+    {
+        Logger::LogError("Failed to flush " + temporary_path + " to disk");
+        std::filesystem::remove(temporary_path, error);
+        return false;
+    }
+
+    std::filesystem::rename(temporary_path, config_.cache_path, error);
+    if (error)
+    {
+        Logger::LogError("Failed to replace " + config_.cache_path + ": " + error.message());
+        std::filesystem::remove(temporary_path, error);
+        return false;
+    }
+    flush_directory(config_.cache_path);
+
+    saved_size_ = data.size();
+    Logger::LogInfo("Pipeline cache saved " + std::to_string(data.size()) + " bytes to " + config_.cache_path);
+    return true;
+}
+
+void VulkanPipelineCache::writer_loop()
+{
+    while (true)
+    {
+        std::vector<char> data;
+        {
+            std::unique_lock<std::mutex> lock(writer_mutex_);
+            writer_condition_.wait(lock, [this]() { return stop_writer_ || has_pending_blob_; });
+            if (!has_pending_blob_)
+            {
+                return;
+            }
+            data              = std::move(pending_blob_);
+            has_pending_blob_ = false;
+        }
+        write_blob(data);
+    }
+}
+
+void VulkanPipelineCache::stop_writer()
+{
+    if (!writer_.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        stop_writer_ = true;
+    }
+    writer_condition_.notify_one();
+    writer_.join();
+}
+
+bool VulkanPipelineCache::read_blob(std::vector<char>& data) const
+{
+    std::ifstream file(config_.cache_path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    auto size = static_cast<size_t>(file.tellg());
+    data.resize(size);
+    file.seekg(0);
+    file.read(data.data(), static_cast<std::streamsize>(size));
+    return file.good();
+}
+
+bool VulkanPipelineCache::validate_header(const std::vector<char>& data) const
+{
+    // header layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() < sizeof(header))
+    {
+        Logger::LogWarning("Pipeline cache blob is too small, discarded");
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (header.headerSize < sizeof(header) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+    {
+        Logger::LogWarning("Pipeline cache header version is not supported, discarded");
+        return false;
+    }
+    if (header.headerSize > data.size())
+    {
+        Logger::LogWarning("Pipeline cache header is longer than the blob, discarded");
+        return false;
+    }
+    if (header.vendorID != physical_device_properties_.vendorID ||
+        header.deviceID != physical_device_properties_.deviceID ||
+        std::memcmp(header.pipelineCacheUUID, physical_device_properties_.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        Logger::LogWarning("Pipeline cache was written by another device or driver, discarded");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utility/logger.h"
+
+struct SVulkanPipelineCacheConfig
+{
+    std::string cache_path;               // blob loaded at startup and written back
+    uint32_t save_interval_frames = 0;    // 0 only saves on destruction
+};
+
+/// @brief Keeps a VkPipelineCache on disk across launches.
+/// @note 1.a blob written by another driver or device is discarded after checking its header, the cache starts cold.
+/// @note 2.saving writes a temporary file, flushes it to disk and only then renames it over the old one,
+///         a crash or power loss leaves either the old or the new blob.
+/// @note 3.periodic saves read the cache data on the calling thread and write it from a worker thread.
+/// @note 4.the destructor saves, it must run before the device is destroyed.
+class VulkanPipelineCache
+{
+public:
+    VulkanPipelineCache(VkDevice device, VkPhysicalDevice physical_device, SVulkanPipelineCacheConfig config);
+    ~VulkanPipelineCache();
+
+    VulkanPipelineCache(const VulkanPipelineCache&)            = delete;
+    VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+
+    /// @brief load the blob if it is valid for this device and create the cache from it
+    bool Initialize();
+
+    /// @brief write the cache data back to disk on the calling thread, skipped if nothing was added since the last save
+    bool Save();
+
+    /// @brief hand the cache data to the writer thread every save_interval_frames frames
+    void Tick(uint64_t frame_serial);
+
+    VkPipelineCache GetPipelineCache() const { return pipeline_cache_; }
+
+    /// @return true if the cache was created from a valid blob
+    bool IsWarm() const { return warm_; }
+
+private:
+    VkDevice device_;
+    VkPhysicalDeviceProperties physical_device_properties_;
+    SVulkanPipelineCacheConfig config_;
+    VkPipelineCache pipeline_cache_ = VK_NULL_HANDLE;
+    bool warm_                      = false;
+    std::atomic<size_t> saved_size_{0}; // size of the blob on disk
+    size_t queued_size_             = 0; // size of the last blob handed to the writer
+    uint64_t last_save_frame_       = 0;
+
+    // writer thread, only the latest blob is kept, an older one still waiting is replaced
+    std::mutex writer_mutex_;
+    std::condition_variable writer_condition_;
+    std::vector<char> pending_blob_;
+    bool has_pending_blob_ = false;
+    bool stop_writer_      = false;
+    std::thread writer_;
+    std::mutex file_mutex_; // Save and the writer thread share the temporary file
+
+    /// @return false on failure, true with empty data if nothing changed since size_on_record
+    bool get_data(size_t size_on_record, std::vector<char>& data) const;
+    bool write_blob(const std::vector<char>& data);
+    void writer_loop();
+    void stop_writer();
+    bool read_blob(std::vector<char>& data) const;
+    bool validate_header(const std::vector<char>& data) const;
+};
@@ -0,0 +1,501 @@
+#include "vulkan_pipeline_library.h"
+#include <chrono>
+
+namespace
+{
+    // FNV-1a, fed field by field so struct padding never reaches the hash
+    constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+    constexpr uint64_t kFnvPrime       = 1099511628211ull;
+
+    template <typename T>
+    void hash_value(uint64_t& hash, const T& value)
+    {
+        const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            hash ^= bytes[i];
+            hash *= kFnvPrime;
+        }
+    }
+
+    void hash_shader(uint64_t& hash, const SVulkanPipelineConfig& config, EShaderType shader_type)
+    {
+        auto it = config.shader_module_map.find(shader_type);
+        hash_value(hash, shader_type);
+        hash_value(hash, it != config.shader_module_map.end() ? it->second : VK_NULL_HANDLE);
+        auto constants = config.specialization_constants.find(shader_type);
+        if (constants != config.specialization_constants.end())
+        {
+            for (const auto& constant : constants->second)
+            {
+                hash_value(hash, constant.constant_id);
+                hash_value(hash, constant.value);
+            }
+        }
+    }
+
+    void hash_layout(uint64_t& hash, const SVulkanPipelineConfig& config)
+    {
+        for (const auto& descriptor_set_layout : config.descriptor_set_layouts)
+        {
+            hash_value(hash, descriptor_set_layout);
+        }
+        for (const auto& push_constant_range : config.push_constant_ranges)
+        {
+            hash_value(hash, push_constant_range.stageFlags);
+            hash_value(hash, push_constant_range.offset);
+            hash_value(hash, push_constant_range.size);
+        }
+    }
+
+    // dynamic states stay out of the hash, variants differing only in them share one pipeline
+    void hash_vertex_input(uint64_t& hash, const SVulkanPipelineConfig& config)
+    {
+        hash_value(hash, config.dynamic_raster_state);
+        hash_value(hash, config.dynamic_vertex_input);
+        if (config.dynamic_vertex_input)
+        {
+            return;
+        }
+        hash_value(hash, config.vertex_input_binding_description.binding);
+        hash_value(hash, config.vertex_input_binding_description.stride);
+        hash_value(hash, config.vertex_input_binding_description.inputRate);
+        for (const auto& attribute : config.vertex_input_attribute_descriptions)
+        {
+            hash_value(hash, attribute.location);
+            hash_value(hash, attribute.binding);
+            hash_value(hash, attribute.format);
+            hash_value(hash, attribute.offset);
+        }
+    }
+
+    void hash_pre_rasterization(uint64_t& hash, const SVulkanPipelineConfig& config)
+    {
+        hash_shader(hash, config, EShaderType::kVertexShader);
+        hash_layout(hash, config);
+        hash_value(hash, config.dynamic_raster_state);
+        if (!config.dynamic_raster_state)
+        {
+            hash_value(hash, config.cull_mode);
+        }
+        hash_value(hash, config.renderpass);
+    }
+
+    void hash_fragment_shader(uint64_t& hash, const SVulkanPipelineConfig& config)
+    {
+        hash_shader(hash, config, EShaderType::kFragmentShader);
+        hash_layout(hash, config);
+        hash_value(hash, config.dynamic_raster_state);
+        if (!config.dynamic_raster_state)
+        {
+            hash_value(hash, config.depth_test_enable);
+            hash_value(hash, config.depth_write_enable);
+            hash_value(hash, config.depth_compare_op);
+        }
+        hash_value(hash, config.renderpass);
+    }
+
+    void hash_fragment_output(uint64_t& hash, const SVulkanPipelineConfig& config)
+    {
+        hash_value(hash, config.dynamic_blend_enable);
+        if (!config.dynamic_blend_enable)
+        {
+            hash_value(hash, config.blend_enable);
+        }
+        hash_value(hash, config.renderpass);
+        for (const auto& color_format : config.color_attachment_formats)
+        {
+            hash_value(hash, color_format);
+        }
+        hash_value(hash, config.depth_attachment_format);
+    }
+
+    bool uses_module(const VulkanPipelineHelper& pipeline, VkShaderModule module)
+    {
+        for (const auto& [shader_type, shader_module] : pipeline.GetConfig().shader_module_map)
+        {
+            if (shader_module == module)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    constexpr VkGraphicsPipelineLibraryFlagsEXT kLibraryParts[] = {
+        VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT};
+}
+
+VulkanPipelineLibrary::VulkanPipelineLibrary(VkDevice device, VkPipelineCache pipeline_cache, SVulkanPipelineLibraryConfig config)
+    : device_(device), pipeline_cache_(pipeline_cache), config_(config)
+{
+}
+
+VulkanPipelineLibrary::~VulkanPipelineLibrary()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        jobs_.clear();
+    }
+    job_condition_.notify_all();
+
+    for (auto& worker : workers_)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    workers_.clear();
+    pipelines_.clear();
+    retired_pipelines_.clear();
+    parts_.clear();
+}
+
+bool VulkanPipelineLibrary::Initialize()
+{
+    for (uint32_t i = 0; i < config_.thread_count; ++i)
+    {
+        workers_.emplace_back(&VulkanPipelineLibrary::worker_loop, this);
+    }
+    Logger::LogInfo("Pipeline library started " + std::to_string(workers_.size()) + " compile threads" +
+                    (config_.use_graphics_pipeline_library ? " with graphics pipeline library" : ""));
+    return true;
+}
+
+uint64_t VulkanPipelineLibrary::HashState(const SVulkanPipelineConfig& config)
+{
+    uint64_t hash = kFnvOffsetBasis;
+    hash_vertex_input(hash, config);
+    hash_pre_rasterization(hash, config);
+    hash_fragment_shader(hash, config);
+    hash_fragment_output(hash, config);
+    return hash == INVALID_KEY ? 1 : hash;
+}
+
+uint64_t VulkanPipelineLibrary::HashPart(const SVulkanPipelineConfig& config, VkGraphicsPipelineLibraryFlagsEXT part)
+{
+    uint64_t hash = kFnvOffsetBasis;
+    hash_value(hash, part);
+    switch (part)
+    {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+        hash_vertex_input(hash, config);
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        hash_pre_rasterization(hash, config);
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        hash_fragment_shader(hash, config);
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+        hash_fragment_output(hash, config);
+        break;
+    default:
+        break;
+    }
+    return hash;
+}
+
+uint64_t VulkanPipelineLibrary::SetFallback(const SVulkanPipelineConfig& config)
+{
+    uint64_t key  = HashState(config);
+    auto pipeline = compile(config);
+    if (pipeline == nullptr)
+    {
+        Logger::LogError("Failed to compile the fallback pipeline");
+        return INVALID_KEY;
+    }
+
+    // the fallback is monolithic, its parts are built too so variants sharing them link right away
+    std::vector<VkPipeline> libraries;
+    if (config_.use_graphics_pipeline_library && !create_parts(config, libraries))
+    {
+        Logger::LogWarning("Failed to build pipeline library parts of the fallback pipeline");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    fallback_       = pipeline.get();
+    pipelines_[key] = std::move(pipeline);
+    return key;
+}
+
+uint64_t VulkanPipelineLibrary::Request(const SVulkanPipelineConfig& config)
+{
+    uint64_t key = HashState(config);
+
+    std::vector<VkPipeline> libraries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pipelines_.find(key) != pipelines_.end() || queued_keys_.find(key) != queued_keys_.end())
+        {
+            return key;
+        }
+        // pending from here on, a second request for the key neither links nor queues it again
+        queued_keys_.insert(key);
+        if (!config_.use_graphics_pipeline_library || !find_parts(config, libraries))
+        {
+            jobs_.push_back({.key = key, .config = config, .optimize = false});
+            job_condition_.notify_one();
+            return key;
+        }
+    }
+
+    // every part is already built, a fast link is cheap enough for the calling thread but not for holding the lock,
+    // Get and IsReady run on the render thread, parts live as long as the library so the handles stay valid
+    auto pipeline = link(config, libraries, false);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool linked = pipeline != nullptr;
+    if (linked)
+    {
+        store(key, std::move(pipeline));
+    }
+    // a failed fast link falls back to a full build on a worker
+    jobs_.push_back({.key = key, .config = config, .optimize = linked});
+    job_condition_.notify_one();
+    return key;
+}
+
+bool VulkanPipelineLibrary::PromoteFallback(uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pipelines_.find(key);
+    if (it == pipelines_.end() || it->second == nullptr)
+    {
+        return false;
+    }
+    fallback_ = it->second.get();
+    return true;
+}
+
+bool VulkanPipelineLibrary::ReleaseShaderModule(VkShaderModule module, std::vector<std::unique_ptr<VulkanPipelineHelper>>& released)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    // a queued or running job may hold a config with the module
+    if (!queued_keys_.empty() || (fallback_ != nullptr && uses_module(*fallback_, module)))
+    {
+        return false;
+    }
+
+    for (auto it = pipelines_.begin(); it != pipelines_.end();)
+    {
+        // failed variants keep no config, they are retried if requested again
+        if (it->second == nullptr || uses_module(*it->second, module))
+        {
+            if (it->second != nullptr)
+            {
+                released.push_back(std::move(it->second));
+            }
+            it = pipelines_.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    for (auto it = parts_.begin(); it != parts_.end();)
+    {
+        if (uses_module(*it->second, module))
+        {
+            released.push_back(std::move(it->second));
+            it = parts_.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    return true;
+}
+
+std::vector<std::unique_ptr<VulkanPipelineHelper>> VulkanPipelineLibrary::TakeRetiredPipelines()
+{
+    std::vector<std::unique_ptr<VulkanPipelineHelper>> retired;
+    std::lock_guard<std::mutex> lock(mutex_);
+    retired.swap(retired_pipelines_);
+    return retired;
+}
+
+const VulkanPipelineHelper* VulkanPipelineLibrary::Get(uint64_t key) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pipelines_.find(key);
+    if (it != pipelines_.end() && it->second != nullptr)
+    {
+        return it->second.get();
+    }
+    return fallback_;
+}
+
+bool VulkanPipelineLibrary::IsReady(uint64_t key) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pipelines_.find(key);
+    return it != pipelines_.end() && it->second != nullptr;
+}
+
+bool VulkanPipelineLibrary::HasFailed(uint64_t key) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pipelines_.find(key);
+    return it != pipelines_.end() && it->second == nullptr;
+}
+
+size_t VulkanPipelineLibrary::GetPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_keys_.size();
+}
+
+void VulkanPipelineLibrary::worker_loop()
+{
+    while (true)
+    {
+        SCompileJob job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            job_condition_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+            if (stop_)
+            {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        // compiled without the lock, the pipeline cache is internally synchronized
+        auto start_time = std::chrono::steady_clock::now();
+        std::unique_ptr<VulkanPipelineHelper> pipeline;
+        std::vector<VkPipeline> libraries;
+        if (!config_.use_graphics_pipeline_library)
+        {
+            pipeline = compile(job.config);
+        }
+        else if (create_parts(job.config, libraries))
+        {
+            pipeline = link(job.config, libraries, job.optimize);
+        }
+        auto compile_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (job.optimize)
+        {
+            // a failed relink keeps the fast linked variant
+            if (pipeline == nullptr)
+            {
+                Logger::LogWarning("Failed to relink pipeline variant " + std::to_string(job.key) + ", keeping the fast linked one");
+            }
+            else
+            {
+                Logger::LogInfo("Relinked pipeline variant " + std::to_string(job.key) + " in " + std::to_string(compile_ms) + " ms");
+                store(job.key, std::move(pipeline));
+            }
+            queued_keys_.erase(job.key);
+            continue;
+        }
+
+        if (pipeline == nullptr)
+        {
+            Logger::LogError("Failed to compile pipeline variant " + std::to_string(job.key) + ", the fallback stays in use");
+            store(job.key, nullptr);
+            queued_keys_.erase(job.key);
+            continue;
+        }
+
+        Logger::LogInfo("Compiled pipeline variant " + std::to_string(job.key) + " in " + std::to_string(compile_ms) + " ms");
+        store(job.key, std::move(pipeline));
+        if (config_.use_graphics_pipeline_library)
+        {
+            // fast linked, the optimized relink keeps the key pending
+            jobs_.push_back({.key = job.key, .config = std::move(job.config), .optimize = true});
+            job_condition_.notify_one();
+        }
+        else
+        {
+            queued_keys_.erase(job.key);
+        }
+    }
+}
+
+std::unique_ptr<VulkanPipelineHelper> VulkanPipelineLibrary::compile(const SVulkanPipelineConfig& config) const
+{
+    auto pipeline = std::make_unique<VulkanPipelineHelper>(config);
+    if (!pipeline->CreatePipeline(device_, pipeline_cache_))
+    {
+        return nullptr;
+    }
+    return pipeline;
+}
+
+bool VulkanPipelineLibrary::find_parts(const SVulkanPipelineConfig& config, std::vector<VkPipeline>& libraries) const
+{
+    libraries.clear();
+    for (auto part : kLibraryParts)
+    {
+        auto it = parts_.find(HashPart(config, part));
+        if (it == parts_.end())
+        {
+            return false;
+        }
+        libraries.push_back(it->second->GetPipeline());
+    }
+    return true;
+}
+
+bool VulkanPipelineLibrary::create_parts(const SVulkanPipelineConfig& config, std::vector<VkPipeline>& libraries)
+{
+    libraries.clear();
+    for (auto part : kLibraryParts)
+    {
+        uint64_t part_key = HashPart(config, part);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = parts_.find(part_key);
+            if (it != parts_.end())
+            {
+                libraries.push_back(it->second->GetPipeline());
+                continue;
+            }
+        }
+
+        auto library = std::make_unique<VulkanPipelineHelper>(config);
+        if (!library->CreateLibraryPart(device_, pipeline_cache_, part))
+        {
+            return false;
+        }
+
+        // another worker may have built the same part meanwhile, the first one stays
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto [it, inserted] = parts_.try_emplace(part_key, std::move(library));
+        libraries.push_back(it->second->GetPipeline());
+    }
+    return true;
+}
+
+std::unique_ptr<VulkanPipelineHelper> VulkanPipelineLibrary::link(const SVulkanPipelineConfig& config,
+                                                                  const std::vector<VkPipeline>& libraries,
+                                                                  bool optimize) const
+{
+    auto pipeline = std::make_unique<VulkanPipelineHelper>(config);
+    if (!pipeline->LinkLibraries(device_, pipeline_cache_, libraries, optimize))
+    {
+        return nullptr;
+    }
+    return pipeline;
+}
+
+void VulkanPipelineLibrary::store(uint64_t key, std::unique_ptr<VulkanPipelineHelper> pipeline)
+{
+    auto& slot = pipelines_[key];
+    if (slot != nullptr)
+    {
+        // a promoted fallback follows its relink
+        if (fallback_ == slot.get())
+        {
+            fallback_ = pipeline.get();
+        }
+        retired_pipelines_.push_back(std::move(slot));
+    }
+    slot = std::move(pipeline);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "utility/logger.h"
+#include "vulkan_pipeline.h"
+
+struct SVulkanPipelineLibraryConfig
+{
+    uint32_t thread_count = 1; // background compile threads
+    bool use_graphics_pipeline_library = false; // VK_EXT_graphics_pipeline_library, monolithic compiles otherwise
+};
+
+/// @brief Caches pipelines by a hash of their full state and compiles missing variants in the background.
+/// @note 1.the key covers shaders and their specialization constants, vertex layout, descriptor set layouts, fixed function state and attachment formats.
+/// @note 2.Get never blocks, a variant still compiling resolves to the fallback pipeline.
+/// @note 3.pipelines are destroyed with the library, the device must be idle by then.
+/// @note 4.with graphics pipeline library the four parts are cached by their own state, a variant whose parts exist is
+///         fast linked on the calling thread and replaced by an optimized relink from a worker.
+/// @note 5.keys hash shader module handles, a module is only destroyed after ReleaseShaderModule dropped everything built
+///         from it, otherwise a new module reusing the handle would resolve to stale pipelines.
+class VulkanPipelineLibrary
+{
+public:
+    static constexpr uint64_t INVALID_KEY = 0;
+
+    VulkanPipelineLibrary(VkDevice device, VkPipelineCache pipeline_cache, SVulkanPipelineLibraryConfig config = {});
+    ~VulkanPipelineLibrary();
+
+    VulkanPipelineLibrary(const VulkanPipelineLibrary&)            = delete;
+    VulkanPipelineLibrary& operator=(const VulkanPipelineLibrary&) = delete;
+
+    bool Initialize();
+
+    /// @brief hash every part of the config that ends up in the pipeline, the viewport extent is dynamic and skipped
+    static uint64_t HashState(const SVulkanPipelineConfig& config);
+
+    /// @brief hash the state one graphics pipeline library part is built from
+    static uint64_t HashPart(const SVulkanPipelineConfig& config, VkGraphicsPipelineLibraryFlagsEXT part);
+
+    /// @brief compile the fallback pipeline on the calling thread
+    /// @return its key, INVALID_KEY on failure
+    uint64_t SetFallback(const SVulkanPipelineConfig& config);
+
+    /// @brief look up a variant and queue its compilation if it is unknown
+    /// @return key to resolve with Get
+    uint64_t Request(const SVulkanPipelineConfig& config);
+
+    /// @brief make a ready variant the fallback, e.g. the one swapped in by a shader reload
+    /// @return false if the variant is not ready
+    bool PromoteFallback(uint64_t key);
+
+    /// @brief drop every variant and part built from a shader module, failed variants are forgotten too
+    /// @param released pipelines to destroy once the frames using them retired
+    /// @return false while compiles are pending or the fallback uses the module, nothing is released then
+    bool ReleaseShaderModule(VkShaderModule module, std::vector<std::unique_ptr<VulkanPipelineHelper>>& released);
+
+    /// @brief hand over the fast linked variants replaced by their relink, to destroy once the frames using them retired
+    std::vector<std::unique_ptr<VulkanPipelineHelper>> TakeRetiredPipelines();
+
+    /// @return the variant if it is ready, otherwise the fallback pipeline
+    const VulkanPipelineHelper* Get(uint64_t key) const;
+
+    bool IsReady(uint64_t key) const;
+    /// @return true if the variant was compiled and failed, Get keeps resolving it to the fallback
+    bool HasFailed(uint64_t key) const;
+    size_t GetPendingCount() const;
+
+private:
+    struct SCompileJob
+    {
+        uint64_t key;
+        SVulkanPipelineConfig config;
+        bool optimize = false; // relink a fast linked variant with link time optimization
+    };
+
+    VkDevice device_;
+    VkPipelineCache pipeline_cache_;
+    SVulkanPipelineLibraryConfig config_;
+
+    // compiled variants, a failed compile is kept as nullptr so it is not retried every frame
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, std::unique_ptr<VulkanPipelineHelper>> pipelines_;
+    std::unordered_set<uint64_t> queued_keys_;
+    std::deque<SCompileJob> jobs_;
+    const VulkanPipelineHelper* fallback_ = nullptr;
+
+    // graphics pipeline library parts keyed by HashPart
+    std::unordered_map<uint64_t, std::unique_ptr<VulkanPipelineHelper>> parts_;
+    // fast linked variants replaced by their optimized relink, frames in flight may still use them, kept until taken
+    std::vector<std::unique_ptr<VulkanPipelineHelper>> retired_pipelines_;
+
+    std::condition_variable job_condition_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+
+    void worker_loop();
+    std::unique_ptr<VulkanPipelineHelper> compile(const SVulkanPipelineConfig& config) const;
+
+    /// @brief collect the four parts of a config, mutex_ must be held
+    bool find_parts(const SVulkanPipelineConfig& config, std::vector<VkPipeline>& libraries) const;
+    /// @brief collect the four parts of a config, building the missing ones without holding mutex_
+    bool create_parts(const SVulkanPipelineConfig& config, std::vector<VkPipeline>& libraries);
+    std::unique_ptr<VulkanPipelineHelper> link(const SVulkanPipelineConfig& config, const std::vector<VkPipeline>& libraries, bool optimize) const;
+    /// @brief publish a variant, mutex_ must be held
+    void store(uint64_t key, std::unique_ptr<VulkanPipelineHelper> pipeline);
+};
@@ -22,6 +22,13 @@ struct SVulkanShaderConfig
     const char* shader_path;
 };
 
+// bool, int, uint and float constants are all four bytes, floats are passed by their bit pattern
+struct SVulkanSpecializationConstant
+{
+    uint32_t constant_id;
+    uint32_t value;
+};
+
 class VulkanShaderHelper
 {
 public:
@@ -29,7 +36,7 @@ public:
     VulkanShaderHelper(VkDevice device) : device_(device) {};
     ~VulkanShaderHelper();
 
-    bool ReadShaderCode(const char* filename, std::vector<uint32_t>& shader_code);
+    static bool ReadShaderCode(const char* filename, std::vector<uint32_t>& shader_code);
     bool CreateShaderModule(VkDevice device, const std::vector<uint32_t>& shader_code, EShaderType shader_type);
     VkShaderModule GetShaderModule(EShaderType shader_type) const 
     {
@@ -0,0 +1,156 @@
+#include "vulkan_shader_library.h"
+
+namespace
+{
+    constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+    constexpr uint64_t kFnvPrime       = 1099511628211ull;
+
+    bool matches_stage(EShaderType shader_type, VkShaderStageFlagBits stage)
+    {
+        switch (shader_type)
+        {
+        case EShaderType::kVertexShader: return stage == VK_SHADER_STAGE_VERTEX_BIT;
+        case EShaderType::kFragmentShader: return stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+        case EShaderType::kComputeShader: return stage == VK_SHADER_STAGE_COMPUTE_BIT;
+        case EShaderType::kGeometryShader: return stage == VK_SHADER_STAGE_GEOMETRY_BIT;
+        case EShaderType::kTessellationShader:
+            return stage == VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT || stage == VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        default: return true;
+        }
+    }
+}
+
+VulkanShaderLibrary::~VulkanShaderLibrary()
+{
+    for (auto& [key, entry] : shaders_)
+    {
+        if (entry.module != VK_NULL_HANDLE)
+        {
+            vkDestroyShaderModule(device_, entry.module, nullptr);
+            entry.module = VK_NULL_HANDLE;
+        }
+    }
+    shaders_.clear();
+}
+
+uint64_t VulkanShaderLibrary::HashCode(const std::vector<uint32_t>& spirv)
+{
+    uint64_t hash = kFnvOffsetBasis;
+    for (uint32_t word : spirv)
+    {
+        for (uint32_t byte = 0; byte < 4; ++byte)
+        {
+            hash ^= (word >> (byte * 8)) & 0xFF;
+            hash *= kFnvPrime;
+        }
+    }
+    // INVALID_KEY stays reserved
+    return hash != INVALID_KEY ? hash : 1;
+}
+
+bool VulkanShaderLibrary::LoadShaders(const std::vector<SVulkanShaderConfig>& configs, std::vector<uint64_t>& keys)
+{
+    // read everything up front, a missing file fails the batch before any module is created
+    std::vector<std::vector<uint32_t>> shader_codes(configs.size());
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+        if (!VulkanShaderHelper::ReadShaderCode(configs[i].shader_path, shader_codes[i]))
+        {
+            Logger::LogError("Failed to read shader code from " + std::string(configs[i].shader_path));
+            return false;
+        }
+    }
+
+    keys.clear();
+    keys.reserve(configs.size());
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+        uint64_t key = AddShader(configs[i].shader_type, shader_codes[i]);
+        if (key == INVALID_KEY)
+        {
+            Logger::LogError("Failed to create shader module for " + std::string(configs[i].shader_path));
+            return false;
+        }
+        keys.push_back(key);
+    }
+    return true;
+}
+
+uint64_t VulkanShaderLibrary::AddShader(EShaderType shader_type, const std::vector<uint32_t>& spirv)
+{
+    uint64_t key = HashCode(spirv);
+    if (shaders_.find(key) != shaders_.end())
+    {
+        return key;
+    }
+
+    SShaderEntry entry{};
+    entry.shader_type = shader_type;
+    if (!VulkanShaderReflection::Reflect(spirv, entry.reflection))
+    {
+        return INVALID_KEY;
+    }
+    if (!matches_stage(shader_type, entry.reflection.stage))
+    {
+        Logger::LogError("Shader entry point " + entry.reflection.entry_point + " is not of the requested stage");
+        return INVALID_KEY;
+    }
+
+    VkShaderModuleCreateInfo create_info = {};
+    create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    create_info.codeSize = spirv.size() * sizeof(uint32_t);
+    create_info.pCode = spirv.data();
+    if (!Logger::LogWithVkResult(vkCreateShaderModule(device_, &create_info, nullptr, &entry.module),
+                                 "Failed to create shader module",
+                                 "Succeeded in creating shader module"))
+    {
+        return INVALID_KEY;
+    }
+
+    shaders_.emplace(key, std::move(entry));
+    return key;
+}
+
+VkShaderModule VulkanShaderLibrary::Release(uint64_t key)
+{
+    auto it = shaders_.find(key);
+    if (it == shaders_.end())
+    {
+        return VK_NULL_HANDLE;
+    }
+    VkShaderModule module = it->second.module;
+    shaders_.erase(it);
+    return module;
+}
+
+VkShaderModule VulkanShaderLibrary::GetModule(uint64_t key) const
+{
+    auto it = shaders_.find(key);
+    return it != shaders_.end() ? it->second.module : VK_NULL_HANDLE;
+}
+
+const SVulkanShaderReflection* VulkanShaderLibrary::GetReflection(uint64_t key) const
+{
+    auto it = shaders_.find(key);
+    return it != shaders_.end() ? &it->second.reflection : nullptr;
+}
+
+std::vector<SVulkanSpecializationConstant> VulkanShaderLibrary::Specialize(uint64_t key, const std::map<std::string, uint32_t>& feature_values) const
+{
+    std::vector<SVulkanSpecializationConstant> constants;
+    const SVulkanShaderReflection* reflection = GetReflection(key);
+    if (reflection == nullptr)
+    {
+        return constants;
+    }
+
+    for (const auto& constant : reflection->specialization_constants)
+    {
+        auto it = feature_values.find(constant.name);
+        if (it != feature_values.end())
+        {
+            constants.push_back({constant.constant_id, it->second});
+        }
+    }
+    return constants;
+}
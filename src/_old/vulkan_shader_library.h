@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "utility/logger.h"
+#include "vulkan_shader.h"
+#include "vulkan_shader_reflection.h"
+
+/// @brief Owns shader modules keyed by a hash of their SPIR-V, any number of modules per stage.
+/// @note 1.the same code loaded twice, from another path or another request, shares one module.
+/// @note 2.every module is reflected once when it is added, pipelines reuse the result.
+/// @note 3.modules are destroyed with the library unless released earlier, pipelines built from them do not need them afterwards.
+class VulkanShaderLibrary
+{
+public:
+    static constexpr uint64_t INVALID_KEY = 0;
+
+    VulkanShaderLibrary(VkDevice device) : device_(device) {}
+    ~VulkanShaderLibrary();
+
+    VulkanShaderLibrary(const VulkanShaderLibrary&)            = delete;
+    VulkanShaderLibrary& operator=(const VulkanShaderLibrary&) = delete;
+
+    /// @brief FNV-1a over the SPIR-V words
+    static uint64_t HashCode(const std::vector<uint32_t>& spirv);
+
+    /// @brief read every file first, then create modules for the distinct ones
+    /// @param keys one key per config, in order
+    /// @return false if any file cannot be read or compiled, no module is created when a read fails
+    bool LoadShaders(const std::vector<SVulkanShaderConfig>& configs, std::vector<uint64_t>& keys);
+
+    /// @return key of the module for this code, INVALID_KEY on failure
+    uint64_t AddShader(EShaderType shader_type, const std::vector<uint32_t>& spirv);
+
+    /// @brief forget a module, its reflection is gone with it
+    /// @return the module for the caller to destroy, VK_NULL_HANDLE if the key is unknown
+    VkShaderModule Release(uint64_t key);
+
+    VkShaderModule GetModule(uint64_t key) const;
+    const SVulkanShaderReflection* GetReflection(uint64_t key) const;
+
+    /// @brief constants for the feature values the module declares, matched by constant name
+    /// @note 1.values the module does not declare are dropped so they do not split pipeline variants.
+    std::vector<SVulkanSpecializationConstant> Specialize(uint64_t key, const std::map<std::string, uint32_t>& feature_values) const;
+
+    size_t GetModuleCount() const { return shaders_.size(); }
+
+private:
+    struct SShaderEntry
+    {
+        EShaderType shader_type;
+        VkShaderModule module = VK_NULL_HANDLE;
+        SVulkanShaderReflection reflection;
+    };
+
+    VkDevice device_;
+    std::unordered_map<uint64_t, SShaderEntry> shaders_;
+};
@@ -0,0 +1,731 @@
+#include "vulkan_shader_reflection.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    // the subset of the SPIR-V grammar the reflection reads
+    constexpr uint32_t kSpirvMagic = 0x07230203;
+    constexpr uint32_t kSpirvHeaderWords = 5;
+
+    constexpr uint32_t kOpName = 5;
+    constexpr uint32_t kOpEntryPoint = 15;
+    constexpr uint32_t kOpTypeBool = 20;
+    constexpr uint32_t kOpTypeInt = 21;
+    constexpr uint32_t kOpTypeFloat = 22;
+    constexpr uint32_t kOpTypeVector = 23;
+    constexpr uint32_t kOpTypeMatrix = 24;
+    constexpr uint32_t kOpTypeImage = 25;
+    constexpr uint32_t kOpTypeSampler = 26;
+    constexpr uint32_t kOpTypeSampledImage = 27;
+    constexpr uint32_t kOpTypeArray = 28;
+    constexpr uint32_t kOpTypeRuntimeArray = 29;
+    constexpr uint32_t kOpTypeStruct = 30;
+    constexpr uint32_t kOpTypePointer = 32;
+    constexpr uint32_t kOpConstant = 43;
+    constexpr uint32_t kOpFunctionCall = 57;
+    constexpr uint32_t kOpVariable = 59;
+    constexpr uint32_t kOpImageTexelPointer = 60;
+    constexpr uint32_t kOpLoad = 61;
+    constexpr uint32_t kOpCopyMemory = 63;
+    constexpr uint32_t kOpAccessChain = 65;
+    constexpr uint32_t kOpInBoundsAccessChain = 66;
+    constexpr uint32_t kOpDecorate = 71;
+    constexpr uint32_t kOpMemberDecorate = 72;
+    constexpr uint32_t kOpTypeAccelerationStructureKHR = 5341;
+
+    constexpr uint32_t kDecorationSpecId = 1;
+    constexpr uint32_t kDecorationBlock = 2;
+    constexpr uint32_t kDecorationBufferBlock = 3;
+    constexpr uint32_t kDecorationArrayStride = 6;
+    constexpr uint32_t kDecorationMatrixStride = 7;
+    constexpr uint32_t kDecorationBuiltIn = 11;
+    constexpr uint32_t kDecorationLocation = 30;
+    constexpr uint32_t kDecorationBinding = 33;
+    constexpr uint32_t kDecorationDescriptorSet = 34;
+    constexpr uint32_t kDecorationOffset = 35;
+
+    constexpr uint32_t kStorageUniformConstant = 0;
+    constexpr uint32_t kStorageInput = 1;
+    constexpr uint32_t kStorageUniform = 2;
+    constexpr uint32_t kStoragePushConstant = 9;
+    constexpr uint32_t kStorageStorageBuffer = 12;
+
+    constexpr uint32_t kDimBuffer = 5;
+    constexpr uint32_t kDimSubpassData = 6;
+
+    struct SSpirvType
+    {
+        uint32_t opcode = 0;
+        std::vector<uint32_t> operands; // words following the result id
+    };
+
+    struct SSpirvDecorations
+    {
+        bool has_location = false;
+        uint32_t location = 0;
+        bool has_binding = false;
+        uint32_t binding = 0;
+        uint32_t set = 0;
+        bool block = false;
+        bool buffer_block = false;
+        bool builtin = false;
+        bool has_spec_id = false;
+        uint32_t spec_id = 0;
+        uint32_t array_stride = 0;
+        std::unordered_map<uint32_t, uint32_t> member_offsets;
+        std::unordered_map<uint32_t, uint32_t> member_matrix_strides;
+    };
+
+    struct SSpirvVariable
+    {
+        uint32_t id;
+        uint32_t pointer_type;
+        uint32_t storage_class;
+    };
+
+    struct SSpirvModule
+    {
+        bool has_entry_point = false;
+        uint32_t execution_model = 0;
+        std::string entry_point;
+        std::unordered_map<uint32_t, SSpirvType> types;
+        std::unordered_map<uint32_t, uint32_t> constants;
+        std::unordered_map<uint32_t, SSpirvDecorations> decorations;
+        std::unordered_map<uint32_t, std::string> names;
+        std::vector<SSpirvVariable> variables;
+        std::unordered_set<uint32_t> accessed_ids; // pointers the code loads from or indexes into
+    };
+
+    // literal strings are nul terminated and packed four characters per word
+    std::string read_string(const uint32_t* words, uint32_t word_count)
+    {
+        std::string result;
+        for (uint32_t i = 0; i < word_count; ++i)
+        {
+            for (uint32_t byte = 0; byte < 4; ++byte)
+            {
+                char c = static_cast<char>((words[i] >> (byte * 8)) & 0xFF);
+                if (c == '\0')
+                {
+                    return result;
+                }
+                result.push_back(c);
+            }
+        }
+        return result;
+    }
+
+    /// @brief words an instruction needs before the reflection reads its operands, opcode word included
+    uint32_t min_word_count(uint32_t opcode)
+    {
+        switch (opcode)
+        {
+        case kOpTypeBool:
+        case kOpTypeSampler:
+        case kOpTypeStruct:
+        case kOpTypeAccelerationStructureKHR:
+            return 2;
+        case kOpName:
+        case kOpTypeFloat:
+        case kOpTypeSampledImage:
+        case kOpTypeRuntimeArray:
+        case kOpCopyMemory:
+        case kOpDecorate:
+            return 3;
+        case kOpEntryPoint:
+        case kOpTypeInt:
+        case kOpTypeVector:
+        case kOpTypeMatrix:
+        case kOpTypeArray:
+        case kOpTypePointer:
+        case kOpConstant:
+        case kOpFunctionCall:
+        case kOpVariable:
+        case kOpLoad:
+        case kOpAccessChain:
+        case kOpInBoundsAccessChain:
+        case kOpMemberDecorate:
+            return 4;
+        case kOpImageTexelPointer:
+            return 6;
+        case kOpTypeImage:
+            return 9;
+        default:
+            return 1;
+        }
+    }
+
+    bool parse_module(const std::vector<uint32_t>& spirv, SSpirvModule& module)
+    {
+        if (spirv.size() < kSpirvHeaderWords || spirv[0] != kSpirvMagic)
+        {
+            Logger::LogError("Not a SPIR-V module");
+            return false;
+        }
+
+        size_t offset = kSpirvHeaderWords;
+        while (offset < spirv.size())
+        {
+            uint32_t word_count = spirv[offset] >> 16;
+            uint32_t opcode = spirv[offset] & 0xFFFF;
+            // a truncated instruction would have its operands read from the next one or past the module
+            if (word_count < min_word_count(opcode) || offset + word_count > spirv.size())
+            {
+                Logger::LogError("Malformed SPIR-V instruction at word " + std::to_string(offset));
+                return false;
+            }
+            const uint32_t* words = spirv.data() + offset;
+
+            switch (opcode)
+            {
+            case kOpName:
+                module.names[words[1]] = read_string(words + 2, word_count - 2);
+                break;
+            case kOpEntryPoint:
+                if (!module.has_entry_point)
+                {
+                    module.has_entry_point = true;
+                    module.execution_model = words[1];
+                    module.entry_point = read_string(words + 3, word_count - 3);
+                }
+                break;
+            case kOpTypeBool:
+            case kOpTypeInt:
+            case kOpTypeFloat:
+            case kOpTypeVector:
+            case kOpTypeMatrix:
+            case kOpTypeImage:
+            case kOpTypeSampler:
+            case kOpTypeSampledImage:
+            case kOpTypeArray:
+            case kOpTypeRuntimeArray:
+            case kOpTypeStruct:
+            case kOpTypePointer:
+            case kOpTypeAccelerationStructureKHR:
+                module.types[words[1]] = SSpirvType{opcode, std::vector<uint32_t>(words + 2, words + word_count)};
+                break;
+            case kOpConstant:
+                module.constants[words[2]] = words[3];
+                break;
+            case kOpVariable:
+                module.variables.push_back({words[2], words[1], words[3]});
+                break;
+            case kOpLoad:
+            case kOpAccessChain:
+            case kOpInBoundsAccessChain:
+            case kOpImageTexelPointer:
+                module.accessed_ids.insert(words[3]);
+                break;
+            case kOpCopyMemory:
+                module.accessed_ids.insert(words[2]);
+                break;
+            case kOpFunctionCall:
+                module.accessed_ids.insert(words + 4, words + word_count);
+                break;
+            case kOpDecorate:
+            {
+                auto& decorations = module.decorations[words[1]];
+                uint32_t value = word_count > 3 ? words[3] : 0;
+                switch (words[2])
+                {
+                case kDecorationSpecId: decorations.has_spec_id = true; decorations.spec_id = value; break;
+                case kDecorationBlock: decorations.block = true; break;
+                case kDecorationBufferBlock: decorations.buffer_block = true; break;
+                case kDecorationArrayStride: decorations.array_stride = value; break;
+                case kDecorationBuiltIn: decorations.builtin = true; break;
+                case kDecorationLocation: decorations.has_location = true; decorations.location = value; break;
+                case kDecorationBinding: decorations.has_binding = true; decorations.binding = value; break;
+                case kDecorationDescriptorSet: decorations.set = value; break;
+                default: break;
+                }
+                break;
+            }
+            case kOpMemberDecorate:
+            {
+                auto& decorations = module.decorations[words[1]];
+                uint32_t value = word_count > 4 ? words[4] : 0;
+                if (words[3] == kDecorationOffset)
+                    decorations.member_offsets[words[2]] = value;
+                else if (words[3] == kDecorationMatrixStride)
+                    decorations.member_matrix_strides[words[2]] = value;
+                else if (words[3] == kDecorationBuiltIn)
+                    decorations.builtin = true;
+                break;
+            }
+            default:
+                break;
+            }
+            offset += word_count;
+        }
+
+        if (!module.has_entry_point)
+        {
+            Logger::LogError("SPIR-V module has no entry point");
+            return false;
+        }
+        return true;
+    }
+
+    const SSpirvType* find_type(const SSpirvModule& module, uint32_t type_id)
+    {
+        auto it = module.types.find(type_id);
+        return it != module.types.end() ? &it->second : nullptr;
+    }
+
+    const SSpirvDecorations* find_decorations(const SSpirvModule& module, uint32_t id)
+    {
+        auto it = module.decorations.find(id);
+        return it != module.decorations.end() ? &it->second : nullptr;
+    }
+
+    /// @brief byte size of a type in a block, runtime arrays count as zero
+    uint32_t type_size(const SSpirvModule& module, uint32_t type_id, uint32_t matrix_stride = 0)
+    {
+        const SSpirvType* type = find_type(module, type_id);
+        if (type == nullptr)
+        {
+            return 0;
+        }
+
+        switch (type->opcode)
+        {
+        case kOpTypeBool:
+            return 4;
+        case kOpTypeInt:
+        case kOpTypeFloat:
+            return type->operands[0] / 8;
+        case kOpTypeVector:
+            return type->operands[1] * type_size(module, type->operands[0]);
+        case kOpTypeMatrix:
+        {
+            uint32_t column_size = matrix_stride != 0 ? matrix_stride : type_size(module, type->operands[0]);
+            return type->operands[1] * column_size;
+        }
+        case kOpTypeArray:
+        {
+            auto length = module.constants.find(type->operands[1]);
+            const auto* decorations = find_decorations(module, type_id);
+            uint32_t stride = decorations != nullptr && decorations->array_stride != 0
+                ? decorations->array_stride
+                : type_size(module, type->operands[0], matrix_stride);
+            return length != module.constants.end() ? length->second * stride : 0;
+        }
+        case kOpTypeStruct:
+        {
+            const auto* decorations = find_decorations(module, type_id);
+            uint32_t size = 0;
+            for (uint32_t member = 0; member < type->operands.size(); ++member)
+            {
+                uint32_t member_matrix_stride = 0;
+                uint32_t member_offset = size;
+                if (decorations != nullptr)
+                {
+                    auto stride = decorations->member_matrix_strides.find(member);
+                    member_matrix_stride = stride != decorations->member_matrix_strides.end() ? stride->second : 0;
+                    auto offset = decorations->member_offsets.find(member);
+                    member_offset = offset != decorations->member_offsets.end() ? offset->second : size;
+                }
+                size = std::max(size, member_offset + type_size(module, type->operands[member], member_matrix_stride));
+            }
+            return size;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    /// @brief lowest member offset of a block, push constant ranges start there
+    uint32_t block_offset(const SSpirvModule& module, uint32_t struct_id)
+    {
+        const auto* decorations = find_decorations(module, struct_id);
+        if (decorations == nullptr || decorations->member_offsets.empty())
+        {
+            return 0;
+        }
+        uint32_t offset = UINT32_MAX;
+        for (const auto& [member, member_offset] : decorations->member_offsets)
+        {
+            offset = std::min(offset, member_offset);
+        }
+        return offset;
+    }
+
+    VkFormat vertex_format(const SSpirvModule& module, uint32_t type_id)
+    {
+        const SSpirvType* type = find_type(module, type_id);
+        if (type == nullptr)
+        {
+            return VK_FORMAT_UNDEFINED;
+        }
+
+        uint32_t components = 1;
+        if (type->opcode == kOpTypeVector)
+        {
+            components = type->operands[1];
+            type = find_type(module, type->operands[0]);
+            if (type == nullptr)
+            {
+                return VK_FORMAT_UNDEFINED;
+            }
+        }
+        if (components < 1 || components > 4)
+        {
+            return VK_FORMAT_UNDEFINED;
+        }
+
+        static const VkFormat kFloat32Formats[] = {
+            VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+        static const VkFormat kFloat64Formats[] = {
+            VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT};
+        static const VkFormat kSint32Formats[] = {
+            VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+        static const VkFormat kUint32Formats[] = {
+            VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+
+        if (type->opcode == kOpTypeFloat && type->operands[0] == 32)
+            return kFloat32Formats[components - 1];
+        if (type->opcode == kOpTypeFloat && type->operands[0] == 64)
+            return kFloat64Formats[components - 1];
+        if (type->opcode == kOpTypeInt && type->operands[0] == 32)
+            return type->operands[1] != 0 ? kSint32Formats[components - 1] : kUint32Formats[components - 1];
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    bool to_stage(uint32_t execution_model, VkShaderStageFlagBits& stage)
+    {
+        switch (execution_model)
+        {
+        case 0: stage = VK_SHADER_STAGE_VERTEX_BIT; return true;
+        case 1: stage = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT; return true;
+        case 2: stage = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT; return true;
+        case 3: stage = VK_SHADER_STAGE_GEOMETRY_BIT; return true;
+        case 4: stage = VK_SHADER_STAGE_FRAGMENT_BIT; return true;
+        case 5: stage = VK_SHADER_STAGE_COMPUTE_BIT; return true;
+        default: return false;
+        }
+    }
+
+    /// @brief descriptor type and count of a resource variable, arrays are unwrapped into the count
+    bool reflect_binding(const SSpirvModule& module, const SSpirvVariable& variable, uint32_t pointee_id, SVulkanReflectedBinding& binding)
+    {
+        uint32_t type_id = pointee_id;
+        const SSpirvType* type = find_type(module, type_id);
+        binding.descriptor_count = 1;
+        while (type != nullptr && (type->opcode == kOpTypeArray || type->opcode == kOpTypeRuntimeArray))
+        {
+            if (type->opcode == kOpTypeRuntimeArray)
+            {
+                binding.descriptor_count = 0;
+            }
+            else
+            {
+                auto length = module.constants.find(type->operands[1]);
+                binding.descriptor_count *= length != module.constants.end() ? length->second : 1;
+            }
+            type_id = type->operands[0];
+            type = find_type(module, type_id);
+        }
+        if (type == nullptr)
+        {
+            return false;
+        }
+
+        const auto* type_decorations = find_decorations(module, type_id);
+        switch (variable.storage_class)
+        {
+        case kStorageUniform:
+            binding.descriptor_type = type_decorations != nullptr && type_decorations->buffer_block
+                ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            binding.block_size = type_size(module, type_id);
+            return true;
+        case kStorageStorageBuffer:
+            binding.descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            binding.block_size = type_size(module, type_id);
+            return true;
+        case kStorageUniformConstant:
+            switch (type->opcode)
+            {
+            case kOpTypeSampler:
+                binding.descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLER;
+                return true;
+            case kOpTypeSampledImage:
+                binding.descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                return true;
+            case kOpTypeAccelerationStructureKHR:
+                binding.descriptor_type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+                return true;
+            case kOpTypeImage:
+            {
+                uint32_t dim = type->operands[1];
+                uint32_t sampled = type->operands[5];
+                if (dim == kDimBuffer)
+                    binding.descriptor_type = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                else if (dim == kDimSubpassData)
+                    binding.descriptor_type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                else
+                    binding.descriptor_type = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                return true;
+            }
+            default:
+                return false;
+            }
+        default:
+            return false;
+        }
+    }
+}
+
+bool VulkanShaderReflection::Reflect(const std::vector<uint32_t>& spirv, SVulkanShaderReflection& reflection)
+{
+    SSpirvModule module;
+    if (!parse_module(spirv, module))
+    {
+        return false;
+    }
+
+    reflection = SVulkanShaderReflection{};
+    reflection.entry_point = module.entry_point;
+    if (!to_stage(module.execution_model, reflection.stage))
+    {
+        Logger::LogError("Unsupported SPIR-V execution model " + std::to_string(module.execution_model));
+        return false;
+    }
+
+    for (const auto& variable : module.variables)
+    {
+        const SSpirvType* pointer = find_type(module, variable.pointer_type);
+        if (pointer == nullptr || pointer->opcode != kOpTypePointer)
+        {
+            continue;
+        }
+        uint32_t pointee_id = pointer->operands[1];
+        const auto* decorations = find_decorations(module, variable.id);
+        auto name = module.names.find(variable.id);
+
+        // vertex inputs, matrices take one location per column
+        if (variable.storage_class == kStorageInput)
+        {
+            if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || decorations == nullptr || decorations->builtin ||
+                !decorations->has_location)
+            {
+                continue;
+            }
+            const SSpirvType* type = find_type(module, pointee_id);
+            uint32_t column_count = 1;
+            uint32_t column_type = pointee_id;
+            if (type != nullptr && type->opcode == kOpTypeMatrix)
+            {
+                column_type = type->operands[0];
+                column_count = type->operands[1];
+            }
+            for (uint32_t column = 0; column < column_count; ++column)
+            {
+                SVulkanReflectedVertexInput input;
+                input.location = decorations->location + column;
+                input.format = vertex_format(module, column_type);
+                input.used = module.accessed_ids.count(variable.id) != 0;
+                input.name = name != module.names.end() ? name->second : std::string();
+                reflection.vertex_inputs.push_back(input);
+            }
+            continue;
+        }
+
+        // push constant block
+        if (variable.storage_class == kStoragePushConstant)
+        {
+            uint32_t offset = block_offset(module, pointee_id);
+            uint32_t end = type_size(module, pointee_id);
+            if (end > offset)
+            {
+                reflection.push_constant_ranges.push_back({reflection.stage, offset, end - offset});
+            }
+            continue;
+        }
+
+        // descriptors
+        if (decorations == nullptr || !decorations->has_binding)
+        {
+            continue;
+        }
+        SVulkanReflectedBinding binding;
+        binding.set = decorations->set;
+        binding.binding = decorations->binding;
+        binding.name = name != module.names.end() ? name->second : std::string();
+        if (binding.name.empty())
+        {
+            // uniform blocks are usually named by their type
+            auto type_name = module.names.find(pointee_id);
+            binding.name = type_name != module.names.end() ? type_name->second : std::string();
+        }
+        if (!reflect_binding(module, variable, pointee_id, binding))
+        {
+            Logger::LogWarning("Skipped unsupported resource at set " + std::to_string(binding.set) + " binding " +
+                               std::to_string(binding.binding));
+            continue;
+        }
+        reflection.bindings.push_back(binding);
+    }
+
+    // specialization constants are decorated on the constant itself, not on a variable
+    for (const auto& [id, decorations] : module.decorations)
+    {
+        if (!decorations.has_spec_id)
+        {
+            continue;
+        }
+        auto name = module.names.find(id);
+        reflection.specialization_constants.push_back({decorations.spec_id, name != module.names.end() ? name->second : std::string()});
+    }
+
+    auto by_location = [](const SVulkanReflectedVertexInput& lhs, const SVulkanReflectedVertexInput& rhs)
+    { return lhs.location < rhs.location; };
+    std::sort(reflection.vertex_inputs.begin(), reflection.vertex_inputs.end(), by_location);
+    auto by_constant_id = [](const SVulkanReflectedSpecializationConstant& lhs, const SVulkanReflectedSpecializationConstant& rhs)
+    { return lhs.constant_id < rhs.constant_id; };
+    std::sort(reflection.specialization_constants.begin(), reflection.specialization_constants.end(), by_constant_id);
+    return true;
+}
+
+bool VulkanShaderReflection::MergeSetLayouts(const std::vector<const SVulkanShaderReflection*>& reflections,
+                                             std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>>& set_layouts,
+                                             SVulkanSetLayoutOptions options)
+{
+    std::map<uint32_t, std::map<uint32_t, VkDescriptorSetLayoutBinding>> merged;
+    for (const auto* reflection : reflections)
+    {
+        for (const auto& binding : reflection->bindings)
+        {
+            VkDescriptorType descriptor_type = binding.descriptor_type;
+            if (options.dynamic_uniform_buffers && descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            {
+                descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            }
+            if (binding.descriptor_count == 0)
+            {
+                Logger::LogWarning("Runtime sized array at set " + std::to_string(binding.set) + " binding " +
+                                   std::to_string(binding.binding) + " needs a variable descriptor count layout");
+            }
+
+            auto& set = merged[binding.set];
+            auto it = set.find(binding.binding);
+            if (it == set.end())
+            {
+                VkDescriptorSetLayoutBinding layout_binding{};
+                layout_binding.binding = binding.binding;
+                layout_binding.descriptorType = descriptor_type;
+                layout_binding.descriptorCount = binding.descriptor_count;
+                layout_binding.stageFlags = reflection->stage;
+                set.emplace(binding.binding, layout_binding);
+                continue;
+            }
+
+            if (it->second.descriptorType != descriptor_type || it->second.descriptorCount != binding.descriptor_count)
+            {
+                Logger::LogError("Stages disagree on set " + std::to_string(binding.set) + " binding " +
+                                 std::to_string(binding.binding) + " (" + binding.name + ")");
+                return false;
+            }
+            it->second.stageFlags |= reflection->stage;
+        }
+    }
+
+    set_layouts.clear();
+    for (const auto& [set, bindings] : merged)
+    {
+        auto& layout_bindings = set_layouts[set];
+        for (const auto& [binding, layout_binding] : bindings)
+        {
+            layout_bindings.push_back(layout_binding);
+        }
+    }
+    return true;
+}
+
+std::vector<VkPushConstantRange> VulkanShaderReflection::MergePushConstantRanges(const std::vector<const SVulkanShaderReflection*>& reflections)
+{
+    // a stage may only appear in one range, blocks of the same stage are widened into one
+    std::vector<VkPushConstantRange> ranges;
+    for (const auto* reflection : reflections)
+    {
+        for (const auto& range : reflection->push_constant_ranges)
+        {
+            auto it = std::find_if(ranges.begin(), ranges.end(),
+                                   [&range](const VkPushConstantRange& existing) { return existing.stageFlags == range.stageFlags; });
+            if (it == ranges.end())
+            {
+                ranges.push_back(range);
+                continue;
+            }
+            uint32_t end = std::max(it->offset + it->size, range.offset + range.size);
+            it->offset = std::min(it->offset, range.offset);
+            it->size = end - it->offset;
+        }
+    }
+    return ranges;
+}
+
+bool VulkanShaderReflection::SelectVertexAttributes(const SVulkanShaderReflection& vertex_reflection,
+                                                    const std::vector<VkVertexInputAttributeDescription>& available,
+                                                    std::vector<VkVertexInputAttributeDescription>& selected)
+{
+    selected.clear();
+    for (const auto& input : vertex_reflection.vertex_inputs)
+    {
+        if (!input.used)
+        {
+            continue;
+        }
+        auto it = std::find_if(available.begin(), available.end(),
+                               [&input](const VkVertexInputAttributeDescription& attribute) { return attribute.location == input.location; });
+        if (it == available.end())
+        {
+            Logger::LogError("Vertex format does not provide location " + std::to_string(input.location) + " (" + input.name + ")");
+            return false;
+        }
+        selected.push_back(*it);
+    }
+    return true;
+}
+
+VulkanDescriptorSetLayoutCache::~VulkanDescriptorSetLayoutCache()
+{
+    for (auto& [key, layout] : layouts_)
+    {
+        vkDestroyDescriptorSetLayout(device_, layout, nullptr);
+    }
+    layouts_.clear();
+}
+
+VkDescriptorSetLayout VulkanDescriptorSetLayoutCache::GetOrCreate(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    std::vector<uint32_t> key;
+    key.reserve(bindings.size() * 4);
+    for (const auto& binding : bindings)
+    {
+        key.insert(key.end(), {binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags});
+    }
+
+    auto it = layouts_.find(key);
+    if (it != layouts_.end())
+    {
+        return it->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    layout_info.pBindings = bindings.data();
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    if (!Logger::LogWithVkResult(vkCreateDescriptorSetLayout(device_, &layout_info, nullptr, &layout),
+                                 "Failed to create descriptor set layout",
+                                 "Succeeded in creating descriptor set layout"))
+    {
+        return VK_NULL_HANDLE;
+    }
+    layouts_.emplace(std::move(key), layout);
+    return layout;
+}
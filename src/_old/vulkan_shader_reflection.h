@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "utility/logger.h"
+
+struct SVulkanReflectedBinding
+{
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    VkDescriptorType descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uint32_t descriptor_count = 1; // 0 for runtime sized arrays
+    uint32_t block_size = 0;       // size of uniform and storage blocks, trailing runtime arrays excluded
+    std::string name;
+};
+
+struct SVulkanReflectedVertexInput
+{
+    uint32_t location = 0;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    bool used = false; // read by the entry point, unused inputs can be dropped from the vertex layout
+    std::string name;
+};
+
+struct SVulkanReflectedSpecializationConstant
+{
+    uint32_t constant_id = 0;
+    std::string name;
+};
+
+struct SVulkanShaderReflection
+{
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+    std::string entry_point;
+    std::vector<SVulkanReflectedBinding> bindings;
+    std::vector<VkPushConstantRange> push_constant_ranges;
+    std::vector<SVulkanReflectedVertexInput> vertex_inputs; // vertex stage only, built-ins excluded
+    std::vector<SVulkanReflectedSpecializationConstant> specialization_constants;
+};
+
+struct SVulkanSetLayoutOptions
+{
+    // SPIR-V cannot tell dynamic uniform buffers apart, promote every uniform buffer when they are bound with offsets
+    bool dynamic_uniform_buffers = false;
+};
+
+/// @brief Reads descriptor bindings, push constants, vertex inputs and specialization constants straight from a SPIR-V module.
+/// @note 1.only the first entry point of a module is reflected.
+/// @note 2.a vertex input counts as used when the entry point loads from it.
+class VulkanShaderReflection
+{
+public:
+    /// @brief parse a module as loaded by VulkanShaderHelper::ReadShaderCode
+    static bool Reflect(const std::vector<uint32_t>& spirv, SVulkanShaderReflection& reflection);
+
+    /// @brief merge the bindings of several stages into one binding list per set, stage flags are combined
+    /// @return false if two stages declare the same binding differently
+    static bool MergeSetLayouts(const std::vector<const SVulkanShaderReflection*>& reflections,
+                                std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>>& set_layouts,
+                                SVulkanSetLayoutOptions options = {});
+
+    /// @brief merge push constant ranges of several stages into one range per stage
+    static std::vector<VkPushConstantRange> MergePushConstantRanges(const std::vector<const SVulkanShaderReflection*>& reflections);
+
+    /// @brief keep the attributes the vertex shader reads, the rest only cost fetch bandwidth
+    /// @param available every attribute the vertex format provides, matched by location
+    /// @return false if the shader reads a location the vertex format does not provide
+    static bool SelectVertexAttributes(const SVulkanShaderReflection& vertex_reflection,
+                                       const std::vector<VkVertexInputAttributeDescription>& available,
+                                       std::vector<VkVertexInputAttributeDescription>& selected);
+};
+
+/// @brief Creates descriptor set layouts once per distinct binding list and owns them.
+/// @note 1.shaders that declare identical sets get the same VkDescriptorSetLayout.
+class VulkanDescriptorSetLayoutCache
+{
+public:
+    VulkanDescriptorSetLayoutCache(VkDevice device) : device_(device) {}
+    ~VulkanDescriptorSetLayoutCache();
+
+    VulkanDescriptorSetLayoutCache(const VulkanDescriptorSetLayoutCache&)            = delete;
+    VulkanDescriptorSetLayoutCache& operator=(const VulkanDescriptorSetLayoutCache&) = delete;
+
+    /// @return the layout for these bindings, VK_NULL_HANDLE on failure
+    VkDescriptorSetLayout GetOrCreate(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+    size_t GetLayoutCount() const { return layouts_.size(); }
+
+private:
+    VkDevice device_;
+    // keyed by binding, type, count and stages of every binding in order
+    std::map<std::vector<uint32_t>, VkDescriptorSetLayout> layouts_;
+};
@@ -0,0 +1,295 @@
+#include "vulkan_shader_watcher.h"
+#include <array>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char** environ;
+#endif
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    bool is_glsl_source(const std::filesystem::path& path)
+    {
+        static const std::array<const char*, 8> kExtensions = {".vert", ".frag", ".comp", ".geom", ".tesc", ".tese", ".mesh", ".task"};
+        auto extension = path.extension().string();
+        for (const char* glsl_extension : kExtensions)
+        {
+            if (extension == glsl_extension)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool is_spirv(const std::filesystem::path& path)
+    {
+        return path.extension() == ".spv";
+    }
+
+#if defined(_WIN32)
+    // CommandLineToArgvW rules, backslashes only escape when they precede a quote
+    std::string quote_argument(const std::string& argument)
+    {
+        std::string quoted = "\"";
+        size_t backslashes = 0;
+        for (char c : argument)
+        {
+            if (c == '\\')
+            {
+                ++backslashes;
+                continue;
+            }
+            quoted.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+            backslashes = 0;
+            quoted.push_back(c);
+        }
+        quoted.append(backslashes * 2, '\\');
+        quoted.push_back('"');
+        return quoted;
+    }
+#endif
+
+    /// @brief run a program found on PATH with these arguments and wait for it, no shell is involved
+    /// @return true if it exited with 0
+    bool run_process(const std::vector<std::string>& arguments)
+    {
+#if defined(_WIN32)
+        std::string command_line;
+        for (const auto& argument : arguments)
+        {
+            command_line += (command_line.empty() ? "" : " ") + quote_argument(argument);
+        }
+
+        STARTUPINFOA startup_info{};
+        startup_info.cb = sizeof(startup_info);
+        PROCESS_INFORMATION process_info{};
+        if (!CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup_info, &process_info))
+        {
+            Logger::LogError("Failed to start " + arguments[0] + ", error " + std::to_string(GetLastError()));
+            return false;
+        }
+        WaitForSingleObject(process_info.hProcess, INFINITE);
+        DWORD exit_code = 1;
+        GetExitCodeProcess(process_info.hProcess, &exit_code);
+        CloseHandle(process_info.hThread);
+        CloseHandle(process_info.hProcess);
+        return exit_code == 0;
+#else
+        std::vector<char*> argv;
+        for (const auto& argument : arguments)
+        {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        pid_t pid = 0;
+        int spawn_result = posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+        if (spawn_result != 0)
+        {
+            Logger::LogError("Failed to start " + arguments[0] + ", errno " + std::to_string(spawn_result));
+            return false;
+        }
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0)
+        {
+            if (errno != EINTR)
+            {
+                return false;
+            }
+        }
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+    }
+}
+
+VulkanShaderWatcher::~VulkanShaderWatcher()
+{
+    Stop();
+}
+
+bool VulkanShaderWatcher::Start()
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(config_.shader_directory, error))
+    {
+        Logger::LogError("Shader directory not found: " + config_.shader_directory);
+        return false;
+    }
+
+    running_ = true;
+#if defined(__linux__)
+    thread_ = std::thread(&VulkanShaderWatcher::watch_loop, this);
+#else
+    scan_write_times(false);
+    thread_ = std::thread(&VulkanShaderWatcher::poll_loop, this);
+#endif
+    Logger::LogInfo("Watching " + config_.shader_directory + " for shader changes");
+    return true;
+}
+
+void VulkanShaderWatcher::Stop()
+{
+    running_ = false;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+std::vector<std::filesystem::path> VulkanShaderWatcher::TakeChangedShaders()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::filesystem::path> changed(changed_shaders_.begin(), changed_shaders_.end());
+    changed_shaders_.clear();
+    return changed;
+}
+
+void VulkanShaderWatcher::watch_loop()
+{
+#if defined(__linux__)
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0 || inotify_add_watch(inotify_fd, config_.shader_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        Logger::LogWarning("inotify unavailable, polling shader modification times instead");
+        if (inotify_fd >= 0)
+        {
+            close(inotify_fd);
+        }
+        scan_write_times(false);
+        poll_loop();
+        return;
+    }
+
+    // editors save through a rename as often as in place, both end in one of the two events
+    alignas(inotify_event) char buffer[4096];
+    while (running_)
+    {
+        pollfd poll_fd{inotify_fd, POLLIN, 0};
+        if (poll(&poll_fd, 1, static_cast<int>(config_.poll_interval.count())) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0)
+            {
+                on_file_changed(std::filesystem::path(config_.shader_directory) / event->name);
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+    close(inotify_fd);
+#else
+    poll_loop();
+#endif
+}
+
+void VulkanShaderWatcher::poll_loop()
+{
+    while (running_)
+    {
+        std::this_thread::sleep_for(config_.poll_interval);
+        scan_write_times(true);
+    }
+}
+
+void VulkanShaderWatcher::scan_write_times(bool report_changes)
+{
+    std::error_code error;
+    std::vector<std::filesystem::path> changed;
+    for (const auto& entry : std::filesystem::directory_iterator(config_.shader_directory, error))
+    {
+        const auto& path = entry.path();
+        if (!is_glsl_source(path) && !is_spirv(path))
+        {
+            continue;
+        }
+        auto write_time = std::filesystem::last_write_time(path, error);
+        if (error)
+        {
+            continue;
+        }
+        auto it = write_times_.find(path);
+        if (it == write_times_.end() || it->second != write_time)
+        {
+            write_times_[path] = write_time;
+            changed.push_back(path);
+        }
+    }
+
+    if (report_changes)
+    {
+        for (const auto& path : changed)
+        {
+            on_file_changed(path);
+        }
+    }
+}
+
+void VulkanShaderWatcher::on_file_changed(const std::filesystem::path& path)
+{
+    std::filesystem::path spirv_path;
+    if (is_glsl_source(path))
+    {
+        spirv_path = path;
+        spirv_path += ".spv";
+        if (!compile(path, spirv_path))
+        {
+            return;
+        }
+        // the compiler's own write must not be picked up as a second change
+        std::error_code error;
+        write_times_[spirv_path] = std::filesystem::last_write_time(spirv_path, error);
+    }
+    else if (is_spirv(path))
+    {
+        auto source = path;
+        source.replace_extension();
+        if (std::filesystem::exists(source))
+        {
+            return;
+        }
+        spirv_path = path;
+    }
+    else
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    changed_shaders_.insert(spirv_path);
+}
+
+bool VulkanShaderWatcher::compile(const std::filesystem::path& source, const std::filesystem::path& output)
+{
+    auto start_time = std::chrono::steady_clock::now();
+    // paths go to the compiler as they are, quotes or shell characters in them are never interpreted
+    if (!run_process({config_.compiler, source.string(), "-o", output.string()}))
+    {
+        Logger::LogError("Failed to compile " + source.filename().string() + ", keeping the previous module");
+        return false;
+    }
+    auto compile_time_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    Logger::LogInfo("Recompiled " + source.filename().string() + " in " + std::to_string(compile_time_ms) + " ms");
+    return true;
+}
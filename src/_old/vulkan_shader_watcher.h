@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utility/logger.h"
+
+struct SVulkanShaderWatcherConfig
+{
+    std::string shader_directory;
+    std::string compiler = "glslc"; // invoked as <compiler> <source> -o <source>.spv, the same call compile.bat makes
+    std::chrono::milliseconds poll_interval{250};
+};
+
+/// @brief Watches a shader directory and recompiles changed GLSL on its own thread.
+/// @note 1.inotify on Linux, modification times are polled elsewhere.
+/// @note 2.a .spv changed on disk is reported directly unless its GLSL source sits next to it, the source wins then.
+/// @note 3.the watcher never touches Vulkan objects, the render thread picks up changed modules at a frame boundary.
+class VulkanShaderWatcher
+{
+public:
+    VulkanShaderWatcher(SVulkanShaderWatcherConfig config) : config_(std::move(config)) {}
+    ~VulkanShaderWatcher();
+
+    VulkanShaderWatcher(const VulkanShaderWatcher&)            = delete;
+    VulkanShaderWatcher& operator=(const VulkanShaderWatcher&) = delete;
+
+    bool Start();
+    void Stop();
+
+    /// @return .spv files rebuilt or changed since the last call
+    std::vector<std::filesystem::path> TakeChangedShaders();
+
+private:
+    SVulkanShaderWatcherConfig config_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::mutex mutex_;
+    std::set<std::filesystem::path> changed_shaders_;
+
+    // polling fallback
+    std::map<std::filesystem::path, std::filesystem::file_time_type> write_times_;
+
+    void watch_loop();
+    void poll_loop();
+    void scan_write_times(bool report_changes);
+    void on_file_changed(const std::filesystem::path& path);
+    bool compile(const std::filesystem::path& source, const std::filesystem::path& output);
+};
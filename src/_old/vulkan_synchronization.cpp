@@ -2,93 +2,90 @@
 
 VulkanSynchronizationHelper::~VulkanSynchronizationHelper()
 {
-    for (auto& semaphore : semaphores_)
+    for (auto* semaphore : semaphores_)
     {
-        vkDestroySemaphore(device_, semaphore.second, nullptr);
+        vkDestroySemaphore(device_, semaphore, nullptr);
     }
     semaphores_.clear();
-
-    for (auto& fence : fences_)
-    {
-        vkDestroyFence(device_, fence.second, nullptr);
-    }
-    fences_.clear();
+    semaphore_names_.clear();
 }
 
-bool VulkanSynchronizationHelper::CreateVkSemaphore(std::string id)
+SVulkanSemaphoreHandle VulkanSynchronizationHelper::CreateVkSemaphore(std::string debug_name)
 {
     VkSemaphoreCreateInfo semaphore_info{};
     semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
     semaphore_info.flags = 0;
 
-    if (semaphores_.find(id) != semaphores_.end())
-    {
-        Logger::LogError("Semaphore with ID " + id + " already exists.");
-        return semaphores_[id];
-    }
-    VkSemaphore semaphore;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
     if (!Logger::LogWithVkResult(
         vkCreateSemaphore(device_, &semaphore_info, nullptr, &semaphore),
-        "Failed to create semaphore " + id,
-        "Succeeded in creating semaphore " + id))
+        "Failed to create semaphore " + debug_name,
+        "Succeeded in creating semaphore " + debug_name))
     {
-        return false;
+        return {};
     }
-    semaphores_[id] = semaphore;
-    return true;
+    semaphores_.push_back(semaphore);
+    semaphore_names_.push_back(std::move(debug_name));
+    return {static_cast<uint32_t>(semaphores_.size() - 1)};
 }
 
-bool VulkanSynchronizationHelper::CreateFence(std::string id)
+SVulkanSemaphoreHandle VulkanSynchronizationHelper::CreateTimelineSemaphore(uint64_t initial_value, std::string debug_name)
 {
-    VkFenceCreateInfo fence_info{};
-    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VkSemaphoreTypeCreateInfo type_info{};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue = initial_value;
 
-    if (fences_.find(id) != fences_.end())
-    {
-        Logger::LogError("Fence with ID " + id + " already exists.");
-        return fences_[id];
-    }
-    VkFence fence;
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &type_info;
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
     if (!Logger::LogWithVkResult(
-        vkCreateFence(device_, &fence_info, nullptr, &fence),
-        "Failed to create fence " + id,
-        "Succeeded in creating fence " + id))
+        vkCreateSemaphore(device_, &semaphore_info, nullptr, &semaphore),
+        "Failed to create timeline semaphore " + debug_name,
+        "Succeeded in creating timeline semaphore " + debug_name))
     {
-        return false;
+        return {};
     }
-    fences_[id] = fence;
-    return true;
+    semaphores_.push_back(semaphore);
+    semaphore_names_.push_back(std::move(debug_name));
+    return {static_cast<uint32_t>(semaphores_.size() - 1)};
 }
 
-bool VulkanSynchronizationHelper::WaitForFence(std::string id)
+bool VulkanSynchronizationHelper::WaitForTimeline(SVulkanSemaphoreHandle handle, uint64_t value, uint64_t timeout)
 {
-    return Logger::LogWithVkResult(vkWaitForFences(device_, 1, &fences_[id], VK_TRUE, UINT64_MAX), 
-        "Failed to wait for fence " + id,
-        "Succeeded in waiting for fence " + id);
-}
+    VkSemaphoreWaitInfo wait_info{};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &semaphores_[handle.index];
+    wait_info.pValues = &value;
 
-bool VulkanSynchronizationHelper::ResetFence(std::string id)
-{
-    return Logger::LogWithVkResult(vkResetFences(device_, 1, &fences_[id]),
-        "Failed to reset fence " + id,
-        "Succeeded in resetting fence " + id);
+    VkResult result = vkWaitSemaphores(device_, &wait_info, timeout);
+    if (result != VK_SUCCESS)
+    {
+        return Logger::LogWithVkResult(result, "Failed to wait for timeline semaphore " + semaphore_names_[handle.index], "");
+    }
+    return true;
 }
 
-VkSemaphore VulkanSynchronizationHelper::GetSemaphore(std::string id) const
+uint64_t VulkanSynchronizationHelper::GetTimelineValue(SVulkanSemaphoreHandle handle) const
 {
-    if (semaphores_.find(id) != semaphores_.end())
+    uint64_t value = 0;
+    VkResult result = vkGetSemaphoreCounterValue(device_, semaphores_[handle.index], &value);
+    if (result != VK_SUCCESS)
     {
-        return semaphores_.at(id);
+        Logger::LogWithVkResult(result, "Failed to get counter value of " + semaphore_names_[handle.index], "");
+        return 0;
     }
-    return VK_NULL_HANDLE;
+    return value;
 }
 
-VkFence VulkanSynchronizationHelper::GetFence(std::string id) const
+VkSemaphore VulkanSynchronizationHelper::GetSemaphore(SVulkanSemaphoreHandle handle) const
 {
-    if (fences_.find(id) != fences_.end())
+    if (handle.index < semaphores_.size())
     {
-        return fences_.at(id);
+        return semaphores_[handle.index];
     }
     return VK_NULL_HANDLE;
 }
@@ -1,25 +1,41 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
-#include <map>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include "utility/logger.h"
 
+/// @brief dense index of a semaphore owned by VulkanSynchronizationHelper
+struct SVulkanSemaphoreHandle
+{
+    uint32_t index = UINT32_MAX;
+    bool IsValid() const { return index != UINT32_MAX; }
+};
+
+/// @brief Owns semaphores, addressed by dense handles.
+/// @note 1.debug names are only kept for log messages, lookups never touch them.
+/// @note 2.per-frame calls (wait, get) only log on failure.
+/// @note 3.timeline semaphores share the semaphore handle space with binary ones.
 class VulkanSynchronizationHelper
 {
 private:
     VkDevice device_;
-    std::map<std::string, VkSemaphore> semaphores_;
-    std::map<std::string, VkFence> fences_;
+    std::vector<VkSemaphore> semaphores_;
+    std::vector<std::string> semaphore_names_;
 public:
     VulkanSynchronizationHelper(VkDevice device) : device_(device) {};
     ~VulkanSynchronizationHelper();
 
-    bool CreateVkSemaphore(std::string id);
-    bool CreateFence(std::string id);
+    /// @return handle of the new semaphore, invalid on failure
+    SVulkanSemaphoreHandle CreateVkSemaphore(std::string debug_name = {});
+    /// @return handle of the new timeline semaphore, invalid on failure
+    SVulkanSemaphoreHandle CreateTimelineSemaphore(uint64_t initial_value = 0, std::string debug_name = {});
 
-    bool WaitForFence(std::string id);
-    bool ResetFence(std::string id);
+    /// @brief block until the timeline semaphore reaches the value
+    bool WaitForTimeline(SVulkanSemaphoreHandle handle, uint64_t value, uint64_t timeout = UINT64_MAX);
+    /// @return the current counter value of the timeline semaphore, 0 on failure
+    uint64_t GetTimelineValue(SVulkanSemaphoreHandle handle) const;
 
-    VkSemaphore GetSemaphore(std::string id) const;
-    VkFence GetFence(std::string id) const;
+    VkSemaphore GetSemaphore(SVulkanSemaphoreHandle handle) const;
 };
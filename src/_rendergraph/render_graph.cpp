@@ -0,0 +1,429 @@
+#include "render_graph.h"
+#include <algorithm>
+#include <iostream>
+
+namespace rg
+{
+    // --- Pass Resources ---
+
+    RgPhysicalResource RgPassResources::Get(RgResourceHandle handle) const
+    {
+        return graph_.resource_of(handle).physical;
+    }
+
+    const RgTextureDesc &RgPassResources::GetTextureDesc(RgResourceHandle handle) const
+    {
+        return graph_.resource_of(handle).texture_desc;
+    }
+
+    const RgBufferDesc &RgPassResources::GetBufferDesc(RgResourceHandle handle) const
+    {
+        return graph_.resource_of(handle).buffer_desc;
+    }
+
+    // --- Pass Builder ---
+
+    RgResourceHandle RgPassBuilder::CreateTexture(const std::string &name, const RgTextureDesc &desc)
+    {
+        RgResourceHandle handle = graph_.create_resource(name, RgResourceType::kTexture, pass_);
+        graph_.resources_.back().texture_desc = desc;
+        graph_.passes_[pass_].creates.push_back(handle.node);
+        return handle;
+    }
+
+    RgResourceHandle RgPassBuilder::CreateBuffer(const std::string &name, const RgBufferDesc &desc)
+    {
+        RgResourceHandle handle = graph_.create_resource(name, RgResourceType::kBuffer, pass_);
+        graph_.resources_.back().buffer_desc = desc;
+        graph_.passes_[pass_].creates.push_back(handle.node);
+        return handle;
+    }
+
+    RgResourceHandle RgPassBuilder::Read(RgResourceHandle handle)
+    {
+        if (!graph_.is_valid(handle))
+        {
+            std::cerr << "RgPassBuilder: pass " << graph_.passes_[pass_].name << " reads an invalid resource" << std::endl;
+            graph_.setup_failed_ = true;
+            return {};
+        }
+        graph_.nodes_[handle.node].readers.push_back(pass_);
+        graph_.passes_[pass_].reads.push_back(handle.node);
+        return handle;
+    }
+
+    RgResourceHandle RgPassBuilder::Write(RgResourceHandle handle)
+    {
+        if (!graph_.is_valid(handle))
+        {
+            std::cerr << "RgPassBuilder: pass " << graph_.passes_[pass_].name << " writes an invalid resource" << std::endl;
+            graph_.setup_failed_ = true;
+            return {};
+        }
+
+        // versions form a chain, writing an older one would fork the resource
+        uint32_t resource = graph_.nodes_[handle.node].resource;
+        if (graph_.resources_[resource].latest_node != handle.node)
+        {
+            std::cerr << "RgPassBuilder: pass " << graph_.passes_[pass_].name << " writes an outdated version of "
+                      << graph_.resources_[resource].name << std::endl;
+            graph_.setup_failed_ = true;
+            return {};
+        }
+
+        RgRenderGraph::RgResourceNode node;
+        node.resource = resource;
+        node.producer = pass_;
+        node.previous = handle.node;
+        graph_.nodes_.push_back(std::move(node));
+
+        uint32_t new_node = static_cast<uint32_t>(graph_.nodes_.size() - 1);
+        graph_.resources_[resource].latest_node = new_node;
+        graph_.passes_[pass_].writes.push_back(new_node);
+        return {new_node};
+    }
+
+    void RgPassBuilder::SetSideEffect()
+    {
+        graph_.passes_[pass_].side_effect = true;
+    }
+
+    // --- Setup ---
+
+    RgResourceHandle RgRenderGraph::create_resource(const std::string &name, RgResourceType type, uint32_t producer)
+    {
+        RgResource resource;
+        resource.name = name;
+        resource.type = type;
+        resource.latest_node = static_cast<uint32_t>(nodes_.size());
+        resources_.push_back(std::move(resource));
+
+        RgResourceNode node;
+        node.resource = static_cast<uint32_t>(resources_.size() - 1);
+        node.producer = producer;
+        nodes_.push_back(std::move(node));
+
+        compiled_ = false;
+        return {static_cast<uint32_t>(nodes_.size() - 1)};
+    }
+
+    RgResourceHandle RgRenderGraph::ImportTexture(const std::string &name, const RgTextureDesc &desc, RgPhysicalResource resource)
+    {
+        RgResourceHandle handle = create_resource(name, RgResourceType::kTexture, kRgInvalidIndex);
+        resources_.back().texture_desc = desc;
+        resources_.back().imported = true;
+        resources_.back().physical = resource;
+        return handle;
+    }
+
+    RgResourceHandle RgRenderGraph::ImportBuffer(const std::string &name, const RgBufferDesc &desc, RgPhysicalResource resource)
+    {
+        RgResourceHandle handle = create_resource(name, RgResourceType::kBuffer, kRgInvalidIndex);
+        resources_.back().buffer_desc = desc;
+        resources_.back().imported = true;
+        resources_.back().physical = resource;
+        return handle;
+    }
+
+    uint32_t RgRenderGraph::AddPass(const std::string &name, const std::function<void(RgPassBuilder &)> &setup, RgExecuteCallback execute)
+    {
+        uint32_t pass = static_cast<uint32_t>(passes_.size());
+        passes_.emplace_back();
+        passes_.back().name = name;
+        passes_.back().execute = std::move(execute);
+        compiled_ = false;
+
+        RgPassBuilder builder(*this, pass);
+        if (setup)
+        {
+            setup(builder);
+        }
+        return pass;
+    }
+
+    // --- Compile ---
+
+    bool RgRenderGraph::Compile()
+    {
+        compiled_ = false;
+        if (setup_failed_)
+        {
+            std::cerr << "RgRenderGraph: setup failed, the graph cannot be compiled" << std::endl;
+            return false;
+        }
+
+        execution_order_.clear();
+        for (auto &pass : passes_)
+        {
+            pass.culled = true;
+            pass.level = 0;
+            pass.successors.clear();
+            pass.predecessor_count = 0;
+            pass.realize.clear();
+            pass.release.clear();
+        }
+        for (auto &resource : resources_)
+        {
+            resource.first_use = kRgInvalidIndex;
+            resource.last_use = kRgInvalidIndex;
+        }
+
+        cull_passes();
+        if (!sort_passes())
+        {
+            return false;
+        }
+        compute_lifetimes();
+
+        compiled_ = true;
+        return true;
+    }
+
+    void RgRenderGraph::cull_passes()
+    {
+        // walk back from the passes with visible results along producer edges, everything not reached is culled
+        std::vector<uint32_t> stack;
+        for (uint32_t pass = 0; pass < passes_.size(); ++pass)
+        {
+            bool is_root = passes_[pass].side_effect;
+            for (uint32_t node : passes_[pass].writes)
+            {
+                is_root = is_root || resources_[nodes_[node].resource].imported;
+            }
+            if (is_root)
+            {
+                passes_[pass].culled = false;
+                stack.push_back(pass);
+            }
+        }
+
+        auto keep = [this, &stack](uint32_t node)
+        {
+            uint32_t producer = nodes_[node].producer;
+            if (producer != kRgInvalidIndex && passes_[producer].culled)
+            {
+                passes_[producer].culled = false;
+                stack.push_back(producer);
+            }
+        };
+        while (!stack.empty())
+        {
+            uint32_t pass = stack.back();
+            stack.pop_back();
+            for (uint32_t node : passes_[pass].reads)
+            {
+                keep(node);
+            }
+            // a write keeps what was there before, the previous version has to be produced first
+            for (uint32_t node : passes_[pass].writes)
+            {
+                keep(nodes_[node].previous);
+            }
+        }
+    }
+
+    bool RgRenderGraph::sort_passes()
+    {
+        auto add_edge = [this](uint32_t from, uint32_t to)
+        {
+            if (from == kRgInvalidIndex || from == to || passes_[from].culled)
+            {
+                return;
+            }
+            passes_[from].successors.push_back(to);
+            ++passes_[to].predecessor_count;
+        };
+
+        size_t live_count = 0;
+        for (uint32_t pass = 0; pass < passes_.size(); ++pass)
+        {
+            if (passes_[pass].culled)
+            {
+                continue;
+            }
+            ++live_count;
+            for (uint32_t node : passes_[pass].reads)
+            {
+                add_edge(nodes_[node].producer, pass);
+            }
+            for (uint32_t node : passes_[pass].writes)
+            {
+                // read after write on the previous version, and readers of it must be done before it is overwritten
+                const auto &previous = nodes_[nodes_[node].previous];
+                add_edge(previous.producer, pass);
+                for (uint32_t reader : previous.readers)
+                {
+                    add_edge(reader, pass);
+                }
+            }
+        }
+
+        // Kahn's algorithm one level at a time, ties keep declaration order
+        std::vector<uint32_t> current_level;
+        std::vector<uint32_t> next_level;
+        for (uint32_t pass = 0; pass < passes_.size(); ++pass)
+        {
+            if (!passes_[pass].culled && passes_[pass].predecessor_count == 0)
+            {
+                current_level.push_back(pass);
+            }
+        }
+
+        execution_order_.reserve(live_count);
+        uint32_t level = 0;
+        while (!current_level.empty())
+        {
+            next_level.clear();
+            for (uint32_t pass : current_level)
+            {
+                passes_[pass].level = level;
+                execution_order_.push_back(pass);
+                for (uint32_t successor : passes_[pass].successors)
+                {
+                    if (--passes_[successor].predecessor_count == 0)
+                    {
+                        next_level.push_back(successor);
+                    }
+                }
+            }
+            std::sort(next_level.begin(), next_level.end());
+            std::swap(current_level, next_level);
+            ++level;
+        }
+
+        if (execution_order_.size() != live_count)
+        {
+            std::cerr << "RgRenderGraph: passes depend on each other in a cycle, a pass reads a version another pass overwrites"
+                      << std::endl;
+            execution_order_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void RgRenderGraph::compute_lifetimes()
+    {
+        auto use = [this](uint32_t node, uint32_t position)
+        {
+            auto &resource = resources_[nodes_[node].resource];
+            if (resource.first_use == kRgInvalidIndex)
+            {
+                resource.first_use = position;
+            }
+            resource.last_use = position;
+        };
+
+        for (uint32_t position = 0; position < execution_order_.size(); ++position)
+        {
+            const auto &pass = passes_[execution_order_[position]];
+            for (uint32_t node : pass.creates)
+            {
+                use(node, position);
+            }
+            for (uint32_t node : pass.reads)
+            {
+                use(node, position);
+            }
+            for (uint32_t node : pass.writes)
+            {
+                use(node, position);
+            }
+        }
+
+        // imported resources live outside the graph, transient ones only between their first and last use
+        for (uint32_t resource = 0; resource < resources_.size(); ++resource)
+        {
+            const auto &entry = resources_[resource];
+            if (entry.imported || entry.first_use == kRgInvalidIndex)
+            {
+                continue;
+            }
+            passes_[execution_order_[entry.first_use]].realize.push_back(resource);
+            passes_[execution_order_[entry.last_use]].release.push_back(resource);
+        }
+    }
+
+    bool RgRenderGraph::GetResourceLifetime(RgResourceHandle handle, uint32_t &first_use, uint32_t &last_use) const
+    {
+        if (!compiled_ || !is_valid(handle))
+        {
+            return false;
+        }
+        const auto &resource = resource_of(handle);
+        first_use = resource.first_use;
+        last_use = resource.last_use;
+        return first_use != kRgInvalidIndex;
+    }
+
+    // --- Execute ---
+
+    bool RgRenderGraph::Execute(const RgResourceAllocator &allocator)
+    {
+        if (!compiled_)
+        {
+            std::cerr << "RgRenderGraph: execute called before a successful compile" << std::endl;
+            return false;
+        }
+
+        // transients realized and not released yet, an aborted execution destroys them before returning
+        std::vector<uint32_t> alive;
+        auto destroy = [this, &allocator](uint32_t resource)
+        {
+            auto &entry = resources_[resource];
+            if (allocator.destroy)
+            {
+                allocator.destroy(entry.type, entry.physical);
+            }
+            entry.physical = 0;
+        };
+
+        RgPassResources pass_resources(*this);
+        for (uint32_t pass : execution_order_)
+        {
+            for (uint32_t resource : passes_[pass].realize)
+            {
+                auto &entry = resources_[resource];
+                if (entry.type == RgResourceType::kTexture && allocator.create_texture)
+                {
+                    entry.physical = allocator.create_texture(entry.name, entry.texture_desc);
+                }
+                else if (entry.type == RgResourceType::kBuffer && allocator.create_buffer)
+                {
+                    entry.physical = allocator.create_buffer(entry.name, entry.buffer_desc);
+                }
+                else
+                {
+                    std::cerr << "RgRenderGraph: no allocator to realize " << entry.name << std::endl;
+                    for (uint32_t realized : alive)
+                    {
+                        destroy(realized);
+                    }
+                    return false;
+                }
+                alive.push_back(resource);
+            }
+
+            if (passes_[pass].execute)
+            {
+                passes_[pass].execute(pass_resources);
+            }
+
+            for (uint32_t resource : passes_[pass].release)
+            {
+                destroy(resource);
+                alive.erase(std::find(alive.begin(), alive.end(), resource));
+            }
+        }
+        return true;
+    }
+
+    void RgRenderGraph::Reset()
+    {
+        resources_.clear();
+        nodes_.clear();
+        passes_.clear();
+        execution_order_.clear();
+        compiled_ = false;
+        setup_failed_ = false;
+    }
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "resource.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace rg
+{
+    class RgRenderGraph;
+
+    /// @brief RgPassResources resolves the handles a pass declared to the API objects realized for this execution.
+    class RgPassResources
+    {
+    public:
+        RgPhysicalResource Get(RgResourceHandle handle) const;
+        const RgTextureDesc &GetTextureDesc(RgResourceHandle handle) const;
+        const RgBufferDesc &GetBufferDesc(RgResourceHandle handle) const;
+
+    private:
+        friend class RgRenderGraph;
+        explicit RgPassResources(const RgRenderGraph &graph) : graph_(graph) {}
+
+        const RgRenderGraph &graph_;
+    };
+
+    using RgExecuteCallback = std::function<void(const RgPassResources &)>;
+
+    /// @brief RgPassBuilder declares what one pass creates, reads and writes during setup.
+    class RgPassBuilder
+    {
+    public:
+        RgResourceHandle CreateTexture(const std::string &name, const RgTextureDesc &desc);
+        RgResourceHandle CreateBuffer(const std::string &name, const RgBufferDesc &desc);
+
+        /// @return the same handle, invalid if it does not name a resource
+        RgResourceHandle Read(RgResourceHandle handle);
+
+        /// @brief the pass reads the current contents and produces the next version
+        /// @return handle of the new version, later passes read that one, invalid if the handle is not the latest version
+        RgResourceHandle Write(RgResourceHandle handle);
+
+        /// @brief keep the pass even if nothing reads its outputs, presents and readbacks
+        void SetSideEffect();
+
+    private:
+        friend class RgRenderGraph;
+        RgPassBuilder(RgRenderGraph &graph, uint32_t pass) : graph_(graph), pass_(pass) {}
+
+        RgRenderGraph &graph_;
+        uint32_t pass_;
+    };
+
+    /// @brief RgResourceAllocator creates and destroys the API objects of transient resources around their first and last use.
+    struct RgResourceAllocator
+    {
+        std::function<RgPhysicalResource(const std::string &name, const RgTextureDesc &desc)> create_texture;
+        std::function<RgPhysicalResource(const std::string &name, const RgBufferDesc &desc)> create_buffer;
+        std::function<void(RgResourceType type, RgPhysicalResource resource)> destroy;
+    };
+
+    /// @brief RgRenderGraph is a frame graph in the Frostbite style: passes are declared with their resource usage in a
+    /// @brief setup phase, compiled into an execution order, then executed through callbacks.
+    /// @note 1.compile is pure CPU and touches no graphics API, it can run headless.
+    /// @note 2.passes whose outputs nothing reads are culled, roots are side effect passes and writers of imported resources.
+    /// @note 3.the order is a topological sort by dependency level, passes of one level do not depend on each other.
+    /// @note 4.a graph is built for one frame, Reset clears it for the next one.
+    class RgRenderGraph
+    {
+    public:
+        RgRenderGraph() = default;
+        ~RgRenderGraph() = default;
+
+        RgRenderGraph(const RgRenderGraph &) = delete;
+        RgRenderGraph &operator=(const RgRenderGraph &) = delete;
+
+        // --- Setup ---
+
+        /// @brief resources living outside the graph, the backbuffer or history buffers
+        RgResourceHandle ImportTexture(const std::string &name, const RgTextureDesc &desc, RgPhysicalResource resource);
+        RgResourceHandle ImportBuffer(const std::string &name, const RgBufferDesc &desc, RgPhysicalResource resource);
+
+        /// @brief declare a pass, setup runs immediately
+        /// @return pass index
+        uint32_t AddPass(const std::string &name, const std::function<void(RgPassBuilder &)> &setup, RgExecuteCallback execute);
+
+        // --- Compile ---
+
+        /// @brief cull unused passes, sort the rest and compute resource lifetimes
+        /// @return false if the setup was invalid or the passes depend on each other in a cycle
+        bool Compile();
+
+        const std::vector<uint32_t> &GetExecutionOrder() const { return execution_order_; }
+        bool IsPassCulled(uint32_t pass) const { return passes_[pass].culled; }
+        /// @return dependency level of a pass, 0 for passes depending on nothing
+        uint32_t GetPassLevel(uint32_t pass) const { return passes_[pass].level; }
+        const std::string &GetPassName(uint32_t pass) const { return passes_[pass].name; }
+        size_t GetPassCount() const { return passes_.size(); }
+        size_t GetResourceCount() const { return resources_.size(); }
+
+        /// @brief positions in the execution order of the first and last pass using a resource
+        /// @return false if no executed pass uses it
+        bool GetResourceLifetime(RgResourceHandle handle, uint32_t &first_use, uint32_t &last_use) const;
+
+        // --- Execute ---
+
+        /// @brief run the compiled passes in order, transient resources are created before their first use and
+        /// @brief destroyed after their last
+        bool Execute(const RgResourceAllocator &allocator);
+
+        void Reset();
+
+    private:
+        friend class RgPassBuilder;
+        friend class RgPassResources;
+
+        struct RgResource
+        {
+            std::string name;
+            RgResourceType type = RgResourceType::kTexture;
+            RgTextureDesc texture_desc;
+            RgBufferDesc buffer_desc;
+            bool imported = false;
+            RgPhysicalResource physical = 0;
+            uint32_t latest_node = kRgInvalidIndex;
+
+            // compile results
+            uint32_t first_use = kRgInvalidIndex;
+            uint32_t last_use = kRgInvalidIndex;
+        };
+
+        // one version of a resource
+        struct RgResourceNode
+        {
+            uint32_t resource = kRgInvalidIndex;
+            uint32_t producer = kRgInvalidIndex; // pass creating or writing this version, none for imported resources
+            uint32_t previous = kRgInvalidIndex; // version this one was written over
+            std::vector<uint32_t> readers;
+        };
+
+        struct RgPass
+        {
+            std::string name;
+            RgExecuteCallback execute;
+            std::vector<uint32_t> creates; // nodes
+            std::vector<uint32_t> reads;
+            std::vector<uint32_t> writes;  // nodes produced
+            bool side_effect = false;
+
+            // compile results
+            bool culled = true;
+            uint32_t level = 0;
+            std::vector<uint32_t> successors;
+            uint32_t predecessor_count = 0;
+            std::vector<uint32_t> realize; // resources created before the pass runs
+            std::vector<uint32_t> release; // resources destroyed after it
+        };
+
+        std::vector<RgResource> resources_;
+        std::vector<RgResourceNode> nodes_;
+        std::vector<RgPass> passes_;
+        std::vector<uint32_t> execution_order_;
+        bool compiled_ = false;
+        bool setup_failed_ = false;
+
+        RgResourceHandle create_resource(const std::string &name, RgResourceType type, uint32_t producer);
+        bool is_valid(RgResourceHandle handle) const { return handle.node < nodes_.size(); }
+        const RgResource &resource_of(RgResourceHandle handle) const { return resources_[nodes_[handle.node].resource]; }
+
+        void cull_passes();
+        bool sort_passes();
+        void compute_lifetimes();
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace rg
+{
+    constexpr uint32_t kRgInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    /// @brief API object behind a virtual resource, a VkImage or VkBuffer cast to an integer for the vulkan backend.
+    using RgPhysicalResource = uint64_t;
+
+    enum class RgResourceType : uint8_t
+    {
+        kTexture,
+        kBuffer
+    };
+
+    // --- Virtual Resource Descriptions ---
+
+    /// @note format and usage are passed through to the allocator untouched, VkFormat and VkImageUsageFlags for vulkan
+    struct RgTextureDesc
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t depth = 1;
+        uint32_t mip_levels = 1;
+        uint32_t array_layers = 1;
+        uint32_t format = 0;
+        uint32_t usage = 0;
+    };
+
+    struct RgBufferDesc
+    {
+        uint64_t size = 0;
+        uint32_t usage = 0;
+    };
+
+    /// @brief RgResourceHandle names one version of a virtual resource.
+    /// @note every write produces a new version, so each version has exactly one producing pass.
+    struct RgResourceHandle
+    {
+        uint32_t node = kRgInvalidIndex;
+
+        bool IsValid() const { return node != kRgInvalidIndex; }
+        bool operator==(const RgResourceHandle &other) const { return node == other.node; }
+        bool operator!=(const RgResourceHandle &other) const { return node != other.node; }
+    };
+}
@@ -866,6 +866,21 @@ inline auto require_extensions(const std::vector<const char*>& extensions)
     };
 }
 
+/// @brief Chains an extension structure (e.g. extension features) into device creation
+/// @param p_next Structure with a null pNext that outlives create_logical_device, nullptr adds nothing
+inline auto add_p_next(void* p_next)
+{
+    return [p_next](CommVkLogicalDeviceContext ctx) -> callable::Chainable<CommVkLogicalDeviceContext>
+    {
+        if (p_next != nullptr)
+        {
+            static_cast<VkBaseOutStructure*>(p_next)->pNext = static_cast<VkBaseOutStructure*>(ctx.device_info_.p_next_);
+            ctx.device_info_.p_next_                        = p_next;
+        }
+        return callable::make_chain(std::move(ctx));
+    };
+}
+
 /// @brief Adds a queue request with name for easy identification
 inline auto add_queue(const std::string& queue_name,
                       uint32_t queue_family_index,
@@ -1126,8 +1141,8 @@ inline auto create_logical_device()
             queue_create_infos.push_back(queue_info);
         }
 
-        // Setup feature chain using validated features from physical device
-        void* feature_chain = nullptr;
+        // Setup feature chain using validated features from physical device, extension structures go last
+        void* feature_chain = ctx.device_info_.p_next_;
         if (ctx.validated_features_13_.sType != 0)
         {
             ctx.validated_features_13_.pNext = feature_chain;
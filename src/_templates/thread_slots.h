@@ -0,0 +1,121 @@
+#ifndef THREAD_SLOTS_H
+#define THREAD_SLOTS_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace templates
+{
+
+namespace detail
+{
+
+/// @brief ids of the ThreadSlots owners alive right now, ids are never reused
+struct ThreadSlotOwners
+{
+    std::mutex mutex;
+    std::unordered_set<uint64_t> alive;
+    uint64_t next_id = 1;
+};
+
+// never destroyed, owners with static storage may still retire after it would have been
+inline ThreadSlotOwners& thread_slot_owners()
+{
+    static auto* owners = new ThreadSlotOwners();
+    return *owners;
+}
+
+/// @brief the calling thread's slots of every owner, keyed by owner id since an address could be reused by a later owner
+inline std::unordered_map<uint64_t, void*>& thread_slot_map()
+{
+    thread_local std::unordered_map<uint64_t, void*> slots;
+    return slots;
+}
+
+} // namespace detail
+
+/// @brief ThreadSlots gives every thread its own T per owner, looked up without locking after the thread's first use.
+/// @note 1.a slot is created by the calling thread on first use and lives as long as the ThreadSlots.
+/// @note 2.a thread drops the entries of destroyed owners from its lookup the next time it creates a slot.
+/// @note 3.ForEach visits the slots of every thread, the caller keeps their threads from using them meanwhile.
+template <typename T>
+class ThreadSlots
+{
+public:
+    ThreadSlots()
+    {
+        auto& owners = detail::thread_slot_owners();
+        std::lock_guard<std::mutex> lock(owners.mutex);
+        id_ = owners.next_id++;
+        owners.alive.insert(id_);
+    }
+
+    ~ThreadSlots()
+    {
+        auto& owners = detail::thread_slot_owners();
+        std::lock_guard<std::mutex> lock(owners.mutex);
+        owners.alive.erase(id_);
+    }
+
+    ThreadSlots(const ThreadSlots&)            = delete;
+    ThreadSlots& operator=(const ThreadSlots&) = delete;
+
+    /// @brief slot of the calling thread
+    /// @param create returns the std::unique_ptr<T> of a new slot, or nullptr on failure, only called on first use
+    /// @return the slot, nullptr if create failed
+    template <typename Create>
+    T* Get(Create&& create)
+    {
+        auto& slots = detail::thread_slot_map();
+        auto it     = slots.find(id_);
+        if (it != slots.end())
+        {
+            return static_cast<T*>(it->second);
+        }
+
+        std::unique_ptr<T> slot = create();
+        if (slot == nullptr)
+        {
+            return nullptr;
+        }
+        T* raw = slot.get();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slots_.push_back(std::move(slot));
+        }
+
+        forget_destroyed_owners(slots);
+        slots.emplace(id_, raw);
+        return raw;
+    }
+
+    template <typename Visit>
+    void ForEach(Visit&& visit)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& slot : slots_)
+        {
+            visit(*slot);
+        }
+    }
+
+private:
+    uint64_t id_ = 0;
+    std::mutex mutex_; // only guards creation of slots and iteration over them
+    std::vector<std::unique_ptr<T>> slots_;
+
+    static void forget_destroyed_owners(std::unordered_map<uint64_t, void*>& slots)
+    {
+        auto& owners = detail::thread_slot_owners();
+        std::lock_guard<std::mutex> lock(owners.mutex);
+        std::erase_if(slots, [&owners](const auto& entry) { return owners.alive.count(entry.first) == 0; });
+    }
+};
+
+} // namespace templates
+
+#endif // THREAD_SLOTS_H
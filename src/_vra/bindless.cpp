@@ -0,0 +1,222 @@
+#include "bindless.h"
+#include <algorithm>
+#include <iostream>
+
+namespace vra
+{
+    // -------------------------------------
+    // --- Bindless Table Implementation ---
+
+    VraBindlessTable::VraBindlessTable(VkDevice device, VkPhysicalDevice physical_device, VraBindlessConfig config)
+        : device_(device), config_(config)
+    {
+        // clamp the array sizes to what the device supports with update-after-bind
+        VkPhysicalDeviceDescriptorIndexingProperties indexing_properties = {};
+        indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &indexing_properties;
+        vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+        auto &sampled_images = slots_[static_cast<size_t>(VraBindlessType::SampledImage)];
+        auto &samplers = slots_[static_cast<size_t>(VraBindlessType::Sampler)];
+        auto &storage_buffers = slots_[static_cast<size_t>(VraBindlessType::StorageBuffer)];
+        sampled_images.capacity = std::min({config_.max_sampled_images,
+                                            indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                            indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages});
+        samplers.capacity = std::min({config_.max_samplers,
+                                      indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+                                      indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers});
+        storage_buffers.capacity = std::min({config_.max_storage_buffers,
+                                             indexing_properties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                             indexing_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+    }
+
+    VraBindlessTable::~VraBindlessTable()
+    {
+        if (descriptor_pool_ != VK_NULL_HANDLE)
+            vkDestroyDescriptorPool(device_, descriptor_pool_, nullptr);
+        if (descriptor_set_layout_ != VK_NULL_HANDLE)
+            vkDestroyDescriptorSetLayout(device_, descriptor_set_layout_, nullptr);
+    }
+
+    bool VraBindlessTable::Create()
+    {
+        const VkDescriptorType types[] = {
+            VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            VK_DESCRIPTOR_TYPE_SAMPLER,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        };
+        constexpr size_t binding_count = static_cast<size_t>(VraBindlessType::Count);
+
+        VkDescriptorSetLayoutBinding bindings[binding_count] = {};
+        VkDescriptorBindingFlags binding_flags[binding_count] = {};
+        VkDescriptorPoolSize pool_sizes[binding_count] = {};
+        for (size_t i = 0; i < binding_count; ++i)
+        {
+            // a zero sized array is not allowed, keep one slot even if the device reports no support
+            uint32_t count = std::max(slots_[i].capacity, 1u);
+            bindings[i].binding = static_cast<uint32_t>(i);
+            bindings[i].descriptorType = types[i];
+            bindings[i].descriptorCount = count;
+            bindings[i].stageFlags = config_.stage_flags;
+            binding_flags[i] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                               VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+            pool_sizes[i] = {types[i], count};
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {};
+        binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        binding_flags_info.bindingCount = binding_count;
+        binding_flags_info.pBindingFlags = binding_flags;
+
+        VkDescriptorSetLayoutCreateInfo layout_info = {};
+        layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layout_info.pNext = &binding_flags_info;
+        layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        layout_info.bindingCount = binding_count;
+        layout_info.pBindings = bindings;
+
+        VkResult result = vkCreateDescriptorSetLayout(device_, &layout_info, nullptr, &descriptor_set_layout_);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraBindlessTable: failed to create descriptor set layout, VkResult: " << result << std::endl;
+            return false;
+        }
+
+        VkDescriptorPoolCreateInfo pool_info = {};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        pool_info.maxSets = 1;
+        pool_info.poolSizeCount = binding_count;
+        pool_info.pPoolSizes = pool_sizes;
+
+        result = vkCreateDescriptorPool(device_, &pool_info, nullptr, &descriptor_pool_);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraBindlessTable: failed to create descriptor pool, VkResult: " << result << std::endl;
+            return false;
+        }
+
+        VkDescriptorSetAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool = descriptor_pool_;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &descriptor_set_layout_;
+
+        result = vkAllocateDescriptorSets(device_, &alloc_info, &descriptor_set_);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraBindlessTable: failed to allocate descriptor set, VkResult: " << result << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    uint32_t VraBindlessTable::RegisterSampledImage(VkImageView image_view, VkImageLayout image_layout)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t index = allocate_index(VraBindlessType::SampledImage);
+        if (index != INVALID_INDEX)
+            pending_writes_.push_back({VraBindlessType::SampledImage, index, {VK_NULL_HANDLE, image_view, image_layout}, {}});
+        return index;
+    }
+
+    uint32_t VraBindlessTable::RegisterSampler(VkSampler sampler)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t index = allocate_index(VraBindlessType::Sampler);
+        if (index != INVALID_INDEX)
+            pending_writes_.push_back({VraBindlessType::Sampler, index, {sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED}, {}});
+        return index;
+    }
+
+    uint32_t VraBindlessTable::RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t index = allocate_index(VraBindlessType::StorageBuffer);
+        if (index != INVALID_INDEX)
+            pending_writes_.push_back({VraBindlessType::StorageBuffer, index, {}, {buffer, offset, range}});
+        return index;
+    }
+
+    void VraBindlessTable::Release(VraBindlessType type, uint32_t index, uint64_t current_frame)
+    {
+        if (index == INVALID_INDEX)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        // a write still pending for this index must not land after a later re-registration
+        pending_writes_.erase(std::remove_if(pending_writes_.begin(),
+                                             pending_writes_.end(),
+                                             [type, index](const VraPendingWrite &write)
+                                             { return write.type == type && write.index == index; }),
+                              pending_writes_.end());
+        slots_[static_cast<size_t>(type)].retiring_indices.emplace_back(index, current_frame);
+    }
+
+    void VraBindlessTable::Flush(uint64_t completed_frame)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto &slot : slots_)
+        {
+            auto retired = std::partition(slot.retiring_indices.begin(),
+                                          slot.retiring_indices.end(),
+                                          [completed_frame](const std::pair<uint32_t, uint64_t> &retiring)
+                                          { return retiring.second > completed_frame; });
+            for (auto it = retired; it != slot.retiring_indices.end(); ++it)
+                slot.free_indices.push_back(it->first);
+            slot.retiring_indices.erase(retired, slot.retiring_indices.end());
+        }
+
+        if (pending_writes_.empty())
+            return;
+
+        std::vector<VkWriteDescriptorSet> writes;
+        writes.reserve(pending_writes_.size());
+        for (const auto &pending : pending_writes_)
+        {
+            VkWriteDescriptorSet write = {};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = descriptor_set_;
+            write.dstBinding = static_cast<uint32_t>(pending.type);
+            write.dstArrayElement = pending.index;
+            write.descriptorCount = 1;
+            switch (pending.type)
+            {
+            case VraBindlessType::SampledImage:
+                write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                write.pImageInfo = &pending.image_info;
+                break;
+            case VraBindlessType::Sampler:
+                write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+                write.pImageInfo = &pending.image_info;
+                break;
+            default:
+                write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                write.pBufferInfo = &pending.buffer_info;
+                break;
+            }
+            writes.push_back(write);
+        }
+        vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        pending_writes_.clear();
+    }
+
+    uint32_t VraBindlessTable::allocate_index(VraBindlessType type)
+    {
+        auto &slot = slots_[static_cast<size_t>(type)];
+        if (!slot.free_indices.empty())
+        {
+            uint32_t index = slot.free_indices.back();
+            slot.free_indices.pop_back();
+            return index;
+        }
+        if (slot.high_water < slot.capacity)
+            return slot.high_water++;
+
+        std::cerr << "VraBindlessTable: descriptor array " << static_cast<uint32_t>(type) << " is full" << std::endl;
+        return INVALID_INDEX;
+    }
+}
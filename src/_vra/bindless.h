@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace vra
+{
+    // --- Bindless Config ---
+    struct VraBindlessConfig
+    {
+        // - Array sizes, clamped to the device's update-after-bind limits
+        uint32_t max_sampled_images = 16384;
+        uint32_t max_samplers = 256;
+        uint32_t max_storage_buffers = 16384;
+
+        // - Stages the table is visible to
+        VkShaderStageFlags stage_flags = VK_SHADER_STAGE_ALL;
+    };
+
+    enum class VraBindlessType : uint8_t
+    {
+        SampledImage = 0,
+        Sampler,
+        StorageBuffer,
+        Count
+    };
+
+    /// @brief One large descriptor set of update-after-bind, partially bound arrays.
+    /// @brief Resources are referred to by 32-bit indices into the array of their type.
+    /// @note 1.binding 0 is sampled images, binding 1 is samplers, binding 2 is storage buffers.
+    /// @note 2.writes are batched and applied by Flush, which must run before the submit that reads them.
+    /// @note 3.register/release are guarded by one mutex and may be called from any thread.
+    class VraBindlessTable
+    {
+    public:
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        VraBindlessTable() = delete;
+        VraBindlessTable(VkDevice device, VkPhysicalDevice physical_device, VraBindlessConfig config = {});
+        ~VraBindlessTable();
+
+        VraBindlessTable(const VraBindlessTable &) = delete;
+        VraBindlessTable &operator=(const VraBindlessTable &) = delete;
+
+        /// @brief create the layout, pool and set
+        /// @return true if succeeded
+        bool Create();
+
+        // --- Registration ---
+
+        /// @return index into the sampled image array, INVALID_INDEX if the array is full
+        uint32_t RegisterSampledImage(VkImageView image_view, VkImageLayout image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        /// @return index into the sampler array, INVALID_INDEX if the array is full
+        uint32_t RegisterSampler(VkSampler sampler);
+
+        /// @return index into the storage buffer array, INVALID_INDEX if the array is full
+        uint32_t RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+        /// @brief release an index, it is handed out again once the current frame has retired
+        /// @param current_frame serial of the frame being recorded
+        void Release(VraBindlessType type, uint32_t index, uint64_t current_frame);
+
+        // --- Frame Driven Processing ---
+
+        /// @brief write pending descriptors and recycle released indices of retired frames
+        /// @param completed_frame serial of the last frame retired by the GPU
+        void Flush(uint64_t completed_frame);
+
+        VkDescriptorSetLayout GetDescriptorSetLayout() const { return descriptor_set_layout_; }
+        VkDescriptorSet GetDescriptorSet() const { return descriptor_set_; }
+        uint32_t GetCapacity(VraBindlessType type) const { return slots_[static_cast<size_t>(type)].capacity; }
+
+    private:
+        struct VraIndexAllocator
+        {
+            uint32_t capacity = 0;
+            uint32_t high_water = 0;
+            std::vector<uint32_t> free_indices;
+            std::vector<std::pair<uint32_t, uint64_t>> retiring_indices; // index, frame of release
+        };
+
+        struct VraPendingWrite
+        {
+            VraBindlessType type;
+            uint32_t index;
+            VkDescriptorImageInfo image_info;
+            VkDescriptorBufferInfo buffer_info;
+        };
+
+        VkDevice device_;
+        VraBindlessConfig config_;
+
+        VkDescriptorSetLayout descriptor_set_layout_ = VK_NULL_HANDLE;
+        VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+        VkDescriptorSet descriptor_set_ = VK_NULL_HANDLE;
+
+        std::mutex mutex_;
+        VraIndexAllocator slots_[static_cast<size_t>(VraBindlessType::Count)];
+        std::vector<VraPendingWrite> pending_writes_;
+
+        uint32_t allocate_index(VraBindlessType type);
+    };
+}
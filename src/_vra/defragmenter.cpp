@@ -0,0 +1,311 @@
+#include "defragmenter.h"
+#include <iostream>
+
+namespace vra
+{
+    // ---------------------------------------
+    // --- Defragmenter Implementation ---
+
+    VraDefragmenter::VraDefragmenter(VkDevice device, VmaAllocator allocator, VraDefragmentationConfig config)
+        : device_(device), allocator_(allocator), config_(config)
+    {
+    }
+
+    VraDefragmenter::~VraDefragmenter()
+    {
+        Cancel();
+    }
+
+    void VraDefragmenter::RegisterBuffer(VkBuffer buffer,
+                                         VmaAllocation allocation,
+                                         const VkBufferCreateInfo &buffer_create_info,
+                                         RelocationCallback on_relocated)
+    {
+        VraMovableBuffer movable{buffer, buffer_create_info, std::move(on_relocated)};
+        // the create info is copied, any chained structure would dangle
+        movable.create_info.pNext = nullptr;
+        movable.create_info.pQueueFamilyIndices = nullptr;
+        movable.create_info.queueFamilyIndexCount = 0;
+        movable.create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        // the new location is filled by a transfer copy
+        movable.create_info.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        movable_buffers_[allocation] = std::move(movable);
+    }
+
+    bool VraDefragmenter::UnregisterBuffer(VmaAllocation allocation)
+    {
+        for (const auto &move : pending_moves_)
+        {
+            if (move.allocation == allocation)
+            {
+                std::cerr << "VraDefragmenter: unregistering a buffer which is being moved, finish or cancel the run first" << std::endl;
+                return false;
+            }
+        }
+        movable_buffers_.erase(allocation);
+        return true;
+    }
+
+    void VraDefragmenter::Tick(VkCommandBuffer command_buffer, uint64_t current_serial, uint64_t completed_serial)
+    {
+        if (!IsActive())
+        {
+            if (movable_buffers_.empty() || current_serial - last_check_serial_ < config_.check_interval_frames)
+                return;
+            last_check_serial_ = current_serial;
+            if (CalculateFragmentationRatio() < config_.fragmentation_threshold)
+                return;
+            if (!Begin())
+                return;
+        }
+
+        switch (pass_state_)
+        {
+        case EPassState::kIdle:
+            // record the copies of the next pass into this frame
+            if (RecordPass(command_buffer))
+            {
+                recorded_serial_ = current_serial;
+                pass_state_ = EPassState::kRecorded;
+            }
+            break;
+        case EPassState::kPlanned:
+            // the frame holding the copies was abandoned, the destinations are still bound
+            RecordCopies(command_buffer);
+            recorded_serial_ = current_serial;
+            pass_state_ = EPassState::kRecorded;
+            break;
+        case EPassState::kRecorded:
+            // copies are done, frames recorded from now on use the new buffers
+            if (completed_serial >= recorded_serial_)
+            {
+                ApplyRelocations();
+                relocated_serial_ = current_serial - 1;
+                pass_state_ = EPassState::kRelocated;
+            }
+            break;
+        case EPassState::kRelocated:
+            // the last frame referencing the old buffers has retired
+            if (completed_serial >= relocated_serial_)
+            {
+                bool has_more = FinishPass();
+                pass_state_ = EPassState::kIdle;
+                if (!has_more)
+                    End();
+            }
+            break;
+        }
+    }
+
+    bool VraDefragmenter::Begin()
+    {
+        if (IsActive())
+            return false;
+
+        VmaDefragmentationInfo defrag_info{};
+        defrag_info.flags = config_.algorithm;
+        defrag_info.pool = config_.pool;
+        defrag_info.maxBytesPerPass = config_.max_bytes_per_frame;
+        defrag_info.maxAllocationsPerPass = config_.max_allocations_per_frame;
+
+        last_report_ = {};
+        last_report_.fragmentation_before = CalculateFragmentationRatio();
+
+        VkResult result = vmaBeginDefragmentation(allocator_, &defrag_info, &context_);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraDefragmenter: failed to begin defragmentation, VkResult: " << result << std::endl;
+            context_ = VK_NULL_HANDLE;
+            return false;
+        }
+        pass_state_ = EPassState::kIdle;
+        return true;
+    }
+
+    void VraDefragmenter::Cancel()
+    {
+        if (!IsActive())
+            return;
+
+        if (pass_state_ == EPassState::kPlanned || pass_state_ == EPassState::kRecorded)
+        {
+            // owners never saw the new buffers, drop them and keep the old locations
+            for (auto &move : pending_moves_)
+                vkDestroyBuffer(device_, move.new_buffer, nullptr);
+            pending_moves_.clear();
+            for (uint32_t i = 0; i < pass_info_.moveCount; ++i)
+                pass_info_.pMoves[i].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            vmaEndDefragmentationPass(allocator_, context_, &pass_info_);
+        }
+        else if (pass_state_ == EPassState::kRelocated)
+        {
+            // owners already switched, the pass has to be completed
+            FinishPass();
+        }
+        pass_state_ = EPassState::kIdle;
+        End();
+    }
+
+    void VraDefragmenter::AbortRecordedPass(uint64_t serial)
+    {
+        // the frame still signals its serial, the copies must not count as done when it retires
+        if (IsActive() && pass_state_ == EPassState::kRecorded && recorded_serial_ == serial)
+            pass_state_ = EPassState::kPlanned;
+    }
+
+    float CalculateFragmentation(const VmaDetailedStatistics &statistics)
+    {
+        VkDeviceSize unused_bytes = statistics.statistics.blockBytes - statistics.statistics.allocationBytes;
+        if (unused_bytes == 0 || statistics.unusedRangeCount == 0)
+            return 0.0f;
+        return 1.0f - static_cast<float>(statistics.unusedRangeSizeMax) / static_cast<float>(unused_bytes);
+    }
+
+    float VraDefragmenter::CalculateFragmentationRatio() const
+    {
+        VmaDetailedStatistics statistics{};
+        if (config_.pool != VK_NULL_HANDLE)
+        {
+            vmaCalculatePoolStatistics(allocator_, config_.pool, &statistics);
+        }
+        else
+        {
+            VmaTotalStatistics total{};
+            vmaCalculateStatistics(allocator_, &total);
+            statistics = total.total;
+        }
+        return CalculateFragmentation(statistics);
+    }
+
+    bool VraDefragmenter::RecordPass(VkCommandBuffer command_buffer)
+    {
+        VkResult result = vmaBeginDefragmentationPass(allocator_, context_, &pass_info_);
+        if (result == VK_SUCCESS)
+        {
+            // nothing left to move
+            End();
+            return false;
+        }
+        if (result != VK_INCOMPLETE)
+        {
+            std::cerr << "VraDefragmenter: failed to begin defragmentation pass, VkResult: " << result << std::endl;
+            Cancel();
+            return false;
+        }
+
+        pending_moves_.clear();
+
+        for (uint32_t i = 0; i < pass_info_.moveCount; ++i)
+        {
+            VmaDefragmentationMove &move = pass_info_.pMoves[i];
+            auto it = movable_buffers_.find(move.srcAllocation);
+            if (it == movable_buffers_.end())
+            {
+                // unknown owner, nobody can update its handles
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                continue;
+            }
+
+            VkBuffer new_buffer = VK_NULL_HANDLE;
+            if (vkCreateBuffer(device_, &it->second.create_info, nullptr, &new_buffer) != VK_SUCCESS ||
+                vmaBindBufferMemory(allocator_, move.dstTmpAllocation, new_buffer) != VK_SUCCESS)
+            {
+                if (new_buffer != VK_NULL_HANDLE)
+                    vkDestroyBuffer(device_, new_buffer, nullptr);
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                continue;
+            }
+
+            pending_moves_.push_back({move.srcAllocation, it->second.buffer, new_buffer});
+        }
+
+        if (pending_moves_.empty())
+        {
+            // every proposed move was ignored, stop instead of spinning on the same blocks
+            vmaEndDefragmentationPass(allocator_, context_, &pass_info_);
+            End();
+            return false;
+        }
+
+        RecordCopies(command_buffer);
+        return true;
+    }
+
+    void VraDefragmenter::RecordCopies(VkCommandBuffer command_buffer)
+    {
+        // make earlier transfer writes of this frame visible to the copies
+        VkMemoryBarrier2 pre_barrier{};
+        pre_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        pre_barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        pre_barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+        pre_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        pre_barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+        VkDependencyInfo pre_dependency{};
+        pre_dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        pre_dependency.memoryBarrierCount = 1;
+        pre_dependency.pMemoryBarriers = &pre_barrier;
+        vkCmdPipelineBarrier2(command_buffer, &pre_dependency);
+
+        for (const auto &move : pending_moves_)
+        {
+            VkBufferCopy region{};
+            region.size = movable_buffers_[move.allocation].create_info.size;
+            vkCmdCopyBuffer(command_buffer, move.old_buffer, move.new_buffer, 1, &region);
+        }
+
+        // new locations are only read after the owners switch, a frame later at the earliest
+        VkMemoryBarrier2 post_barrier{};
+        post_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        post_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        post_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        post_barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        post_barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+        VkDependencyInfo post_dependency{};
+        post_dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        post_dependency.memoryBarrierCount = 1;
+        post_dependency.pMemoryBarriers = &post_barrier;
+        vkCmdPipelineBarrier2(command_buffer, &post_dependency);
+    }
+
+    void VraDefragmenter::ApplyRelocations()
+    {
+        for (const auto &move : pending_moves_)
+        {
+            auto it = movable_buffers_.find(move.allocation);
+            if (it == movable_buffers_.end())
+                continue;
+            it->second.buffer = move.new_buffer;
+            if (it->second.on_relocated)
+                it->second.on_relocated({move.allocation, move.old_buffer, move.new_buffer});
+        }
+    }
+
+    bool VraDefragmenter::FinishPass()
+    {
+        // old buffers must be gone before vma releases their memory
+        for (const auto &move : pending_moves_)
+            vkDestroyBuffer(device_, move.old_buffer, nullptr);
+        pending_moves_.clear();
+
+        ++last_report_.passes;
+        VkResult result = vmaEndDefragmentationPass(allocator_, context_, &pass_info_);
+        pass_info_ = {};
+        return result == VK_INCOMPLETE;
+    }
+
+    void VraDefragmenter::End()
+    {
+        if (!IsActive())
+            return;
+
+        vmaEndDefragmentation(allocator_, context_, &last_report_.stats);
+        context_ = VK_NULL_HANDLE;
+        pass_state_ = EPassState::kIdle;
+        last_report_.fragmentation_after = CalculateFragmentationRatio();
+
+        if (on_report_)
+            on_report_(last_report_);
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vma/vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace vra
+{
+    /// @brief 1 - largest unused range / unused bytes over the blocks of the statistics
+    /// @note 0 when the free space is one contiguous range however much of it there is, close to 1 when it is scattered.
+    float CalculateFragmentation(const VmaDetailedStatistics &statistics);
+
+    // --- Defragmentation Config ---
+    struct VraDefragmentationConfig
+    {
+        // - Pool to defragment, VK_NULL_HANDLE means the default pools
+        VmaPool pool = VK_NULL_HANDLE;
+
+        // - Algorithm used by VMA to pick source blocks and destinations
+        VmaDefragmentationFlags algorithm = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+
+        // - Upper bound of bytes copied by the GPU in one frame
+        VkDeviceSize max_bytes_per_frame = 32ull * 1024 * 1024;
+
+        // - Upper bound of moved allocations in one frame, 0 means unlimited
+        uint32_t max_allocations_per_frame = 0;
+
+        // - Defragmentation only starts when the fragmentation ratio exceeds this value
+        float fragmentation_threshold = 0.25f;
+
+        // - How often (in frames) the fragmentation ratio is sampled while idle
+        uint32_t check_interval_frames = 600;
+    };
+
+    /// @brief VraRelocation describes one buffer moved by the defragmenter.
+    /// @brief old_buffer is still valid while the callback runs, it is destroyed after in-flight frames retire.
+    struct VraRelocation
+    {
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VkBuffer old_buffer = VK_NULL_HANDLE;
+        VkBuffer new_buffer = VK_NULL_HANDLE;
+    };
+
+    /// @brief VraDefragmentationReport summarizes one finished defragmentation run.
+    struct VraDefragmentationReport
+    {
+        float fragmentation_before = 0.0f;
+        float fragmentation_after = 0.0f;
+        VmaDefragmentationStats stats{};
+        uint32_t passes = 0;
+    };
+
+    /// @brief Online defragmentation service on top of VMA's defragmentation API.
+    /// @note 1.only registered buffers are moved, every other allocation is reported to VMA as non-movable.
+    /// @note 2.registered buffers must not be written by the host while a pass is in flight.
+    /// @note 3.frame serials are monotonically increasing submission ids, completed serial is the last retired one.
+    class VraDefragmenter
+    {
+    public:
+        using RelocationCallback = std::function<void(const VraRelocation &)>;
+        using ReportCallback = std::function<void(const VraDefragmentationReport &)>;
+
+        VraDefragmenter() = delete;
+        VraDefragmenter(VkDevice device, VmaAllocator allocator, VraDefragmentationConfig config = {});
+        ~VraDefragmenter();
+
+        VraDefragmenter(const VraDefragmenter &) = delete;
+        VraDefragmenter &operator=(const VraDefragmenter &) = delete;
+
+        // --- Registration ---
+
+        /// @brief register a movable buffer
+        /// @param buffer buffer bound to the allocation
+        /// @param allocation vma allocation of the buffer
+        /// @param buffer_create_info create info used to re-create the buffer at the destination
+        /// @param on_relocated invoked once the copy finished, owners swap handles and rewrite descriptors here
+        void RegisterBuffer(VkBuffer buffer,
+                            VmaAllocation allocation,
+                            const VkBufferCreateInfo &buffer_create_info,
+                            RelocationCallback on_relocated);
+
+        /// @brief unregister a buffer, e.g. before destroying it
+        /// @return false if the buffer is being moved by the current pass and must be kept alive
+        bool UnregisterBuffer(VmaAllocation allocation);
+
+        /// @brief set a listener receiving the report of each finished run
+        void SetReportCallback(ReportCallback on_report) { on_report_ = std::move(on_report); }
+
+        // --- Frame Driven Processing ---
+
+        /// @brief advance the defragmentation state machine, must be called while command_buffer is recording
+        /// @param command_buffer command buffer of the current frame, copy commands are recorded into it
+        /// @param current_serial serial of the frame being recorded
+        /// @param completed_serial serial of the last frame retired by the GPU
+        void Tick(VkCommandBuffer command_buffer, uint64_t current_serial, uint64_t completed_serial);
+
+        /// @brief start a run immediately, regardless of the threshold
+        /// @return true if a run has been started
+        bool Begin();
+
+        /// @brief abort an active run, waits for nothing and must only be called while the device is idle
+        void Cancel();
+
+        /// @brief forget the copies recorded into a frame that was never submitted, the next Tick records them again
+        /// @param serial serial of the abandoned frame, nothing happens if the copies were recorded into another one
+        void AbortRecordedPass(uint64_t serial);
+
+        bool IsActive() const { return context_ != VK_NULL_HANDLE; }
+
+        // --- Statistics ---
+
+        /// @brief fragmentation of the free space in the target pool(s), see CalculateFragmentation
+        float CalculateFragmentationRatio() const;
+
+        const VraDefragmentationReport &GetLastReport() const { return last_report_; }
+
+    private:
+        enum class EPassState
+        {
+            kIdle,
+            kPlanned, // destinations are bound, the copies still have to be recorded
+            kRecorded,
+            kRelocated,
+        };
+
+        struct VraMovableBuffer
+        {
+            VkBuffer buffer;
+            VkBufferCreateInfo create_info;
+            RelocationCallback on_relocated;
+        };
+
+        struct VraPendingMove
+        {
+            VmaAllocation allocation;
+            VkBuffer old_buffer;
+            VkBuffer new_buffer;
+        };
+
+        // --- Vulkan Native Objects Cache ---
+
+        VkDevice device_;
+        VmaAllocator allocator_;
+        VraDefragmentationConfig config_;
+
+        // --- Defragmentation State ---
+
+        VmaDefragmentationContext context_ = VK_NULL_HANDLE;
+        VmaDefragmentationPassMoveInfo pass_info_{};
+        EPassState pass_state_ = EPassState::kIdle;
+        uint64_t recorded_serial_ = 0;
+        uint64_t relocated_serial_ = 0;
+        uint64_t last_check_serial_ = 0;
+        std::vector<VraPendingMove> pending_moves_;
+
+        std::unordered_map<VmaAllocation, VraMovableBuffer> movable_buffers_;
+        VraDefragmentationReport last_report_{};
+        ReportCallback on_report_;
+
+        /// @brief begin a vma pass and record copies for the moves of registered buffers
+        bool RecordPass(VkCommandBuffer command_buffer);
+
+        /// @brief record the copies of the pending moves
+        void RecordCopies(VkCommandBuffer command_buffer);
+
+        /// @brief hand the new buffers to their owners
+        void ApplyRelocations();
+
+        /// @brief end the vma pass and destroy the retired buffers
+        /// @return true if vma reports more passes are needed
+        bool FinishPass();
+
+        /// @brief end the vma run and publish the report
+        void End();
+    };
+}
@@ -0,0 +1,54 @@
+#include "deletion.h"
+
+namespace vra
+{
+    // -------------------------------------
+    // --- Deletion Queue Implementation ---
+
+    VraDeletionQueue::~VraDeletionQueue()
+    {
+        Flush();
+    }
+
+    void VraDeletionQueue::Enqueue(uint64_t retire_value, VraDeleter deleter)
+    {
+        pending_.push_back({retire_value, std::move(deleter)});
+    }
+
+    void VraDeletionQueue::EnqueueBuffer(uint64_t retire_value, VmaAllocator allocator, VkBuffer buffer, VmaAllocation allocation)
+    {
+        if (buffer == VK_NULL_HANDLE && allocation == VK_NULL_HANDLE)
+            return;
+        Enqueue(retire_value, [allocator, buffer, allocation]()
+                { vmaDestroyBuffer(allocator, buffer, allocation); });
+    }
+
+    void VraDeletionQueue::EnqueueImage(uint64_t retire_value, VmaAllocator allocator, VkImage image, VmaAllocation allocation)
+    {
+        if (image == VK_NULL_HANDLE && allocation == VK_NULL_HANDLE)
+            return;
+        Enqueue(retire_value, [allocator, image, allocation]()
+                { vmaDestroyImage(allocator, image, allocation); });
+    }
+
+    void VraDeletionQueue::Collect(uint64_t completed_value)
+    {
+        while (!pending_.empty() && pending_.front().retire_value <= completed_value)
+        {
+            // pop first, a deleter may enqueue further deletions
+            VraDeleter deleter = std::move(pending_.front().deleter);
+            pending_.pop_front();
+            deleter();
+        }
+    }
+
+    void VraDeletionQueue::Flush()
+    {
+        while (!pending_.empty())
+        {
+            VraDeleter deleter = std::move(pending_.front().deleter);
+            pending_.pop_front();
+            deleter();
+        }
+    }
+}
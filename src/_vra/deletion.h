@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vma/vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace vra
+{
+    /// @brief Defers destruction of GPU objects until the timeline value of the last submission using them is reached.
+    /// @note 1.deleters run in enqueue order, an entry waits behind older ones even if its own value was reached.
+    /// @note 2.the destructor runs every pending deleter, the owner must make sure the GPU is done by then.
+    /// @note 3.not thread safe, used from the render thread.
+    class VraDeletionQueue
+    {
+    public:
+        using VraDeleter = std::function<void()>;
+
+        VraDeletionQueue() = default;
+        ~VraDeletionQueue();
+
+        VraDeletionQueue(const VraDeletionQueue &) = delete;
+        VraDeletionQueue &operator=(const VraDeletionQueue &) = delete;
+
+        // --- Enqueue ---
+
+        /// @param retire_value timeline value signaled once the GPU no longer uses the object
+        void Enqueue(uint64_t retire_value, VraDeleter deleter);
+
+        void EnqueueBuffer(uint64_t retire_value, VmaAllocator allocator, VkBuffer buffer, VmaAllocation allocation);
+        void EnqueueImage(uint64_t retire_value, VmaAllocator allocator, VkImage image, VmaAllocation allocation);
+
+        // --- Frame Driven Processing ---
+
+        /// @brief run the deleters whose value has been reached
+        /// @param completed_value timeline value the GPU has passed
+        void Collect(uint64_t completed_value);
+
+        /// @brief run every pending deleter regardless of its value
+        void Flush();
+
+        size_t GetPendingCount() const { return pending_.size(); }
+
+    private:
+        struct VraPendingDeletion
+        {
+            uint64_t retire_value;
+            VraDeleter deleter;
+        };
+
+        std::deque<VraPendingDeletion> pending_;
+    };
+}
@@ -0,0 +1,501 @@
+#include "descriptor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+namespace vra
+{
+    namespace
+    {
+        enum class EDescriptorPayload
+        {
+            kBuffer,
+            kImage,
+            kTexelBuffer,
+        };
+
+        EDescriptorPayload payload_of(VkDescriptorType type)
+        {
+            switch (type)
+            {
+            case VK_DESCRIPTOR_TYPE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+                return EDescriptorPayload::kImage;
+            case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+            case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+                return EDescriptorPayload::kTexelBuffer;
+            default:
+                return EDescriptorPayload::kBuffer;
+            }
+        }
+
+        // 64-bit FNV-1a over individual fields, padding bytes are never hashed
+        template <typename T>
+        void hash_append(uint64_t &hash, const T &value)
+        {
+            const auto *bytes = reinterpret_cast<const unsigned char *>(&value);
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        }
+
+        [[maybe_unused]] void hash_append_handle(uint64_t &hash, const void *handle) { hash_append(hash, reinterpret_cast<uintptr_t>(handle)); }
+        [[maybe_unused]] void hash_append_handle(uint64_t &hash, uint64_t handle) { hash_append(hash, handle); }
+    }
+
+    // -------------------------------------------
+    // --- Descriptor Allocator Implementation ---
+
+    VraDescriptorAllocator::VraDescriptorAllocator(VkDevice device, VraDescriptorAllocatorConfig config)
+        : device_(device), config_(std::move(config))
+    {
+        config_.frame_count = std::max(config_.frame_count, 1u);
+        config_.initial_sets_per_pool = std::max(config_.initial_sets_per_pool, 1u);
+        config_.max_sets_per_pool = std::max(config_.max_sets_per_pool, config_.initial_sets_per_pool);
+    }
+
+    VraDescriptorAllocator::~VraDescriptorAllocator()
+    {
+        thread_pools_.ForEach([this](VraThreadPools &thread_pools)
+                              {
+                                  for (auto &pool_set : thread_pools.pool_sets)
+                                  {
+                                      for (auto pool : pool_set.ready_pools)
+                                          vkDestroyDescriptorPool(device_, pool, nullptr);
+                                      for (auto pool : pool_set.full_pools)
+                                          vkDestroyDescriptorPool(device_, pool, nullptr);
+                                  }
+                              });
+    }
+
+    bool VraDescriptorAllocator::Allocate(VkDescriptorSetLayout layout, VkDescriptorSet &descriptor_set, uint32_t frame_index)
+    {
+        auto &thread_pools = get_thread_pools();
+        uint32_t slot = frame_index == PERSISTENT ? config_.frame_count : frame_index % config_.frame_count;
+        auto &pool_set = thread_pools.pool_sets[slot];
+
+        VkDescriptorSetAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &layout;
+
+        // the second try always runs on a fresh pool
+        for (int attempt = 0; attempt < 2; ++attempt)
+        {
+            alloc_info.descriptorPool = grab_pool(pool_set);
+            if (alloc_info.descriptorPool == VK_NULL_HANDLE)
+                return false;
+
+            VkResult result = vkAllocateDescriptorSets(device_, &alloc_info, &descriptor_set);
+            if (result == VK_SUCCESS)
+                return true;
+
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+            {
+                std::cerr << "VraDescriptorAllocator: failed to allocate descriptor set, VkResult: " << result << std::endl;
+                return false;
+            }
+
+            // retire the exhausted pool and grow
+            pool_set.ready_pools.pop_back();
+            pool_set.full_pools.push_back(alloc_info.descriptorPool);
+        }
+
+        std::cerr << "VraDescriptorAllocator: layout does not fit into an empty pool, check the pool ratios" << std::endl;
+        return false;
+    }
+
+    void VraDescriptorAllocator::ResetFrame(uint32_t frame_index)
+    {
+        uint32_t slot = frame_index % config_.frame_count;
+
+        thread_pools_.ForEach([this, slot](VraThreadPools &thread_pools)
+                              {
+                                  auto &pool_set = thread_pools.pool_sets[slot];
+                                  for (auto pool : pool_set.full_pools)
+                                      pool_set.ready_pools.push_back(pool);
+                                  pool_set.full_pools.clear();
+                                  for (auto pool : pool_set.ready_pools)
+                                      vkResetDescriptorPool(device_, pool, 0);
+                              });
+    }
+
+    VraDescriptorAllocator::VraThreadPools &VraDescriptorAllocator::get_thread_pools()
+    {
+        return *thread_pools_.Get(
+            [this]()
+            {
+                auto thread_pools = std::make_unique<VraThreadPools>();
+                thread_pools->pool_sets.resize(config_.frame_count + 1);
+                for (auto &pool_set : thread_pools->pool_sets)
+                    pool_set.sets_per_pool = config_.initial_sets_per_pool;
+                return thread_pools;
+            });
+    }
+
+    VkDescriptorPool VraDescriptorAllocator::grab_pool(VraPoolSet &pool_set)
+    {
+        if (!pool_set.ready_pools.empty())
+            return pool_set.ready_pools.back();
+
+        VkDescriptorPool pool = create_pool(pool_set.sets_per_pool);
+        if (pool == VK_NULL_HANDLE)
+            return VK_NULL_HANDLE;
+
+        pool_set.sets_per_pool = std::min(
+            static_cast<uint32_t>(std::ceil(pool_set.sets_per_pool * config_.growth_factor)), config_.max_sets_per_pool);
+        pool_set.ready_pools.push_back(pool);
+        return pool;
+    }
+
+    VkDescriptorPool VraDescriptorAllocator::create_pool(uint32_t set_count)
+    {
+        std::vector<VkDescriptorPoolSize> pool_sizes;
+        pool_sizes.reserve(config_.pool_ratios.size());
+        for (const auto &ratio : config_.pool_ratios)
+        {
+            auto count = static_cast<uint32_t>(std::ceil(ratio.ratio * static_cast<float>(set_count)));
+            pool_sizes.push_back({ratio.type, std::max(count, 1u)});
+        }
+
+        VkDescriptorPoolCreateInfo pool_info = {};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.maxSets = set_count;
+        pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        pool_info.pPoolSizes = pool_sizes.data();
+
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        VkResult result = vkCreateDescriptorPool(device_, &pool_info, nullptr, &pool);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraDescriptorAllocator: failed to create descriptor pool, VkResult: " << result << std::endl;
+            return VK_NULL_HANDLE;
+        }
+        pool_count_.fetch_add(1, std::memory_order_relaxed);
+        return pool;
+    }
+
+    // ---------------------------------------
+    // --- Descriptor Cache Implementation ---
+
+    VraDescriptorCache::VraDescriptorCache(VkDevice device, VraDescriptorAllocator &allocator, uint32_t initial_capacity, uint32_t max_age_frames)
+        : device_(device), allocator_(allocator), max_age_frames_(max_age_frames)
+    {
+        uint32_t capacity = 16;
+        while (capacity < initial_capacity)
+            capacity <<= 1;
+
+        auto table = std::make_unique<VraCacheTable>();
+        table->slots = std::make_unique<VraCacheSlot[]>(capacity);
+        table->capacity = capacity;
+        table_.store(table.get(), std::memory_order_release);
+        tables_.push_back(std::move(table));
+    }
+
+    VraDescriptorCache::~VraDescriptorCache()
+    {
+        // sets are owned by the allocator's pools
+        for (auto &[key, update_template] : templates_)
+            vkDestroyDescriptorUpdateTemplate(device_, update_template, nullptr);
+    }
+
+    bool VraDescriptorCache::GetOrCreate(VkDescriptorSetLayout layout,
+                                         const std::vector<VraDescriptorBinding> &bindings,
+                                         VkDescriptorSet &descriptor_set,
+                                         uint64_t current_frame)
+    {
+        uint64_t hash = hash_key(layout, bindings);
+
+        // lock-free fast path
+        if (VraCacheSlot *slot = find(*table_.load(std::memory_order_acquire), hash, layout, bindings))
+        {
+            slot->last_used_frame.store(current_frame, std::memory_order_relaxed);
+            descriptor_set = slot->set;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+
+        // another writer may have inserted it meanwhile
+        VraCacheTable *table = table_.load(std::memory_order_relaxed);
+        if (VraCacheSlot *slot = find(*table, hash, layout, bindings))
+        {
+            slot->last_used_frame.store(current_frame, std::memory_order_relaxed);
+            descriptor_set = slot->set;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+
+        // reuse an evicted set of the same layout before allocating
+        VkDescriptorSet new_set = VK_NULL_HANDLE;
+        auto &recycled = recycled_sets_[layout];
+        if (!recycled.empty())
+        {
+            new_set = recycled.back();
+            recycled.pop_back();
+        }
+        else if (!allocator_.Allocate(layout, new_set))
+        {
+            return false;
+        }
+
+        VkDescriptorUpdateTemplate update_template = get_update_template(layout, bindings);
+        if (update_template == VK_NULL_HANDLE)
+        {
+            recycled.push_back(new_set);
+            return false;
+        }
+        // the template reads VraDescriptorBinding::info with a stride of the whole binding
+        vkUpdateDescriptorSetWithTemplate(device_, new_set, update_template, bindings.data());
+
+        // keep the load factor under 0.7, tombstones included
+        if ((table->used + 1) * 10 > table->capacity * 7)
+        {
+            rehash(table->live * 2 + 1 > table->capacity / 2 ? table->capacity * 2 : table->capacity);
+            table = table_.load(std::memory_order_relaxed);
+        }
+
+        // only empty slots are filled, a concurrent reader never sees a slot change its key
+        uint32_t mask = table->capacity - 1;
+        uint32_t index = static_cast<uint32_t>(hash) & mask;
+        while (table->slots[index].hash.load(std::memory_order_relaxed) != EMPTY_HASH)
+            index = (index + 1) & mask;
+
+        VraCacheSlot &slot = table->slots[index];
+        slot.set = new_set;
+        slot.layout = layout;
+        slot.bindings = bindings;
+        slot.last_used_frame.store(current_frame, std::memory_order_relaxed);
+        slot.hash.store(hash, std::memory_order_release);
+        ++table->used;
+        ++table->live;
+
+        descriptor_set = new_set;
+        return true;
+    }
+
+    void VraDescriptorCache::Tick(uint64_t current_frame, uint64_t completed_frame)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+
+        VraCacheTable &table = *tables_.back();
+
+        // no lookup runs during Tick, so retired tables can go once their last hits are carried over
+        for (size_t t = 0; t + 1 < tables_.size(); ++t)
+        {
+            const VraCacheTable &retired = *tables_[t];
+            for (uint32_t i = 0; i < retired.capacity; ++i)
+            {
+                const VraCacheSlot &old_slot = retired.slots[i];
+                uint64_t hash = old_slot.hash.load(std::memory_order_relaxed);
+                if (hash == EMPTY_HASH || hash == TOMBSTONE_HASH)
+                    continue;
+                if (VraCacheSlot *slot = find(table, hash, old_slot.layout, old_slot.bindings))
+                {
+                    uint64_t last_used = std::max(slot->last_used_frame.load(std::memory_order_relaxed),
+                                                  old_slot.last_used_frame.load(std::memory_order_relaxed));
+                    slot->last_used_frame.store(last_used, std::memory_order_relaxed);
+                }
+            }
+        }
+        if (tables_.size() > 1)
+            tables_.erase(tables_.begin(), tables_.end() - 1);
+
+        for (uint32_t i = 0; i < table.capacity; ++i)
+        {
+            VraCacheSlot &slot = table.slots[i];
+            uint64_t hash = slot.hash.load(std::memory_order_relaxed);
+            if (hash == EMPTY_HASH || hash == TOMBSTONE_HASH)
+                continue;
+
+            uint64_t last_used = slot.last_used_frame.load(std::memory_order_relaxed);
+            if (last_used > completed_frame || current_frame - last_used < max_age_frames_)
+                continue;
+
+            recycled_sets_[slot.layout].push_back(slot.set);
+            slot.hash.store(TOMBSTONE_HASH, std::memory_order_release);
+            --table.live;
+            ++evictions_;
+        }
+    }
+
+    VraDescriptorCacheStatistics VraDescriptorCache::GetStatistics() const
+    {
+        VraDescriptorCacheStatistics statistics{};
+        statistics.hits = hits_.load(std::memory_order_relaxed);
+        statistics.misses = misses_.load(std::memory_order_relaxed);
+        statistics.evictions = evictions_;
+        const VraCacheTable *table = table_.load(std::memory_order_acquire);
+        statistics.live_sets = table->live;
+        statistics.capacity = table->capacity;
+        return statistics;
+    }
+
+    uint64_t VraDescriptorCache::hash_key(VkDescriptorSetLayout layout, const std::vector<VraDescriptorBinding> &bindings)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        hash_append_handle(hash, layout);
+        for (const auto &binding : bindings)
+        {
+            hash_append(hash, binding.binding);
+            hash_append(hash, binding.type);
+            switch (payload_of(binding.type))
+            {
+            case EDescriptorPayload::kImage:
+                hash_append_handle(hash, binding.info.image.sampler);
+                hash_append_handle(hash, binding.info.image.imageView);
+                hash_append(hash, binding.info.image.imageLayout);
+                break;
+            case EDescriptorPayload::kTexelBuffer:
+                hash_append_handle(hash, binding.info.texel_buffer_view);
+                break;
+            case EDescriptorPayload::kBuffer:
+                hash_append_handle(hash, binding.info.buffer.buffer);
+                hash_append(hash, binding.info.buffer.offset);
+                hash_append(hash, binding.info.buffer.range);
+                break;
+            }
+        }
+        // 0 and 1 mark empty and tombstone slots
+        return hash > TOMBSTONE_HASH ? hash : hash + 2;
+    }
+
+    bool VraDescriptorCache::same_key(const VraCacheSlot &slot, VkDescriptorSetLayout layout, const std::vector<VraDescriptorBinding> &bindings)
+    {
+        if (slot.layout != layout || slot.bindings.size() != bindings.size())
+            return false;
+
+        for (size_t i = 0; i < bindings.size(); ++i)
+        {
+            const auto &a = slot.bindings[i];
+            const auto &b = bindings[i];
+            if (a.binding != b.binding || a.type != b.type)
+                return false;
+
+            switch (payload_of(a.type))
+            {
+            case EDescriptorPayload::kImage:
+                if (a.info.image.sampler != b.info.image.sampler || a.info.image.imageView != b.info.image.imageView ||
+                    a.info.image.imageLayout != b.info.image.imageLayout)
+                    return false;
+                break;
+            case EDescriptorPayload::kTexelBuffer:
+                if (a.info.texel_buffer_view != b.info.texel_buffer_view)
+                    return false;
+                break;
+            case EDescriptorPayload::kBuffer:
+                if (a.info.buffer.buffer != b.info.buffer.buffer || a.info.buffer.offset != b.info.buffer.offset ||
+                    a.info.buffer.range != b.info.buffer.range)
+                    return false;
+                break;
+            }
+        }
+        return true;
+    }
+
+    VraDescriptorCache::VraCacheSlot *VraDescriptorCache::find(VraCacheTable &table,
+                                                               uint64_t hash,
+                                                               VkDescriptorSetLayout layout,
+                                                               const std::vector<VraDescriptorBinding> &bindings)
+    {
+        uint32_t mask = table.capacity - 1;
+        uint32_t index = static_cast<uint32_t>(hash) & mask;
+        for (uint32_t probe = 0; probe < table.capacity; ++probe)
+        {
+            VraCacheSlot &slot = table.slots[index];
+            uint64_t slot_hash = slot.hash.load(std::memory_order_acquire);
+            if (slot_hash == EMPTY_HASH)
+                return nullptr;
+            if (slot_hash == hash && same_key(slot, layout, bindings))
+                return &slot;
+            index = (index + 1) & mask;
+        }
+        return nullptr;
+    }
+
+    void VraDescriptorCache::rehash(uint32_t capacity)
+    {
+        const VraCacheTable &old_table = *tables_.back();
+
+        auto table = std::make_unique<VraCacheTable>();
+        table->slots = std::make_unique<VraCacheSlot[]>(capacity);
+        table->capacity = capacity;
+
+        uint32_t mask = capacity - 1;
+        for (uint32_t i = 0; i < old_table.capacity; ++i)
+        {
+            const VraCacheSlot &old_slot = old_table.slots[i];
+            uint64_t hash = old_slot.hash.load(std::memory_order_relaxed);
+            if (hash == EMPTY_HASH || hash == TOMBSTONE_HASH)
+                continue;
+
+            uint32_t index = static_cast<uint32_t>(hash) & mask;
+            while (table->slots[index].hash.load(std::memory_order_relaxed) != EMPTY_HASH)
+                index = (index + 1) & mask;
+
+            VraCacheSlot &slot = table->slots[index];
+            slot.set = old_slot.set;
+            slot.layout = old_slot.layout;
+            slot.bindings = old_slot.bindings;
+            slot.last_used_frame.store(old_slot.last_used_frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            slot.hash.store(hash, std::memory_order_relaxed);
+            ++table->used;
+            ++table->live;
+        }
+
+        // readers holding the old table keep probing it until the next Tick
+        table_.store(table.get(), std::memory_order_release);
+        tables_.push_back(std::move(table));
+    }
+
+    VkDescriptorUpdateTemplate VraDescriptorCache::get_update_template(VkDescriptorSetLayout layout, const std::vector<VraDescriptorBinding> &bindings)
+    {
+        TemplateKey key{layout, {}};
+        key.second.reserve(bindings.size());
+        for (const auto &binding : bindings)
+            key.second.emplace_back(binding.binding, binding.type);
+
+        auto it = templates_.find(key);
+        if (it != templates_.end())
+            return it->second;
+
+        std::vector<VkDescriptorUpdateTemplateEntry> entries;
+        entries.reserve(bindings.size());
+        for (size_t i = 0; i < bindings.size(); ++i)
+        {
+            VkDescriptorUpdateTemplateEntry entry = {};
+            entry.dstBinding = bindings[i].binding;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = 1;
+            entry.descriptorType = bindings[i].type;
+            entry.offset = i * sizeof(VraDescriptorBinding) + offsetof(VraDescriptorBinding, info);
+            entry.stride = sizeof(VraDescriptorBinding);
+            entries.push_back(entry);
+        }
+
+        VkDescriptorUpdateTemplateCreateInfo template_info = {};
+        template_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+        template_info.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+        template_info.pDescriptorUpdateEntries = entries.data();
+        template_info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        template_info.descriptorSetLayout = layout;
+
+        VkDescriptorUpdateTemplate update_template = VK_NULL_HANDLE;
+        VkResult result = vkCreateDescriptorUpdateTemplate(device_, &template_info, nullptr, &update_template);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraDescriptorCache: failed to create descriptor update template, VkResult: " << result << std::endl;
+            return VK_NULL_HANDLE;
+        }
+        templates_.emplace(std::move(key), update_template);
+        return update_template;
+    }
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "_templates/thread_slots.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vra
+{
+    // --- Descriptor Allocator Config ---
+    struct VraDescriptorPoolRatio
+    {
+        VkDescriptorType type;
+        float ratio; // descriptors of this type per set
+    };
+
+    struct VraDescriptorAllocatorConfig
+    {
+        // - Descriptor counts of a pool are ratio * max sets of the pool
+        std::vector<VraDescriptorPoolRatio> pool_ratios = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+            {VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f},
+        };
+
+        // - Pools grow geometrically from initial to max sets
+        uint32_t initial_sets_per_pool = 64;
+        uint32_t max_sets_per_pool = 4096;
+        float growth_factor = 1.5f;
+
+        // - Number of frames in flight, each frame owns pools reset as a whole
+        uint32_t frame_count = 1;
+    };
+
+    /// @brief Growable descriptor allocator.
+    /// @note 1.every thread owns its pools, allocation never takes a lock after the first call of a thread.
+    /// @note 2.sets allocated for a frame slot are released at once by ResetFrame, persistent sets live until destruction.
+    /// @note 3.ResetFrame must not race with allocations of the same frame slot.
+    class VraDescriptorAllocator
+    {
+    public:
+        static constexpr uint32_t PERSISTENT = UINT32_MAX;
+
+        VraDescriptorAllocator() = delete;
+        VraDescriptorAllocator(VkDevice device, VraDescriptorAllocatorConfig config = {});
+        ~VraDescriptorAllocator();
+
+        VraDescriptorAllocator(const VraDescriptorAllocator &) = delete;
+        VraDescriptorAllocator &operator=(const VraDescriptorAllocator &) = delete;
+
+        /// @brief allocate a descriptor set from the calling thread's pools
+        /// @param layout layout of the set
+        /// @param descriptor_set output set
+        /// @param frame_index frame slot the set belongs to, or PERSISTENT
+        /// @return true if succeeded, false if the device is out of memory
+        bool Allocate(VkDescriptorSetLayout layout, VkDescriptorSet &descriptor_set, uint32_t frame_index = PERSISTENT);
+
+        /// @brief reset every thread's pools of a frame slot, call after the frame slot's work has retired
+        void ResetFrame(uint32_t frame_index);
+
+        /// @brief number of descriptor pools created so far
+        uint32_t GetPoolCount() const { return pool_count_.load(std::memory_order_relaxed); }
+
+    private:
+        struct VraPoolSet
+        {
+            std::vector<VkDescriptorPool> ready_pools;
+            std::vector<VkDescriptorPool> full_pools;
+            uint32_t sets_per_pool = 0;
+        };
+
+        struct VraThreadPools
+        {
+            // - Frame slots followed by the persistent slot
+            std::vector<VraPoolSet> pool_sets;
+        };
+
+        VkDevice device_;
+        VraDescriptorAllocatorConfig config_;
+        std::atomic<uint32_t> pool_count_ = 0;
+
+        templates::ThreadSlots<VraThreadPools> thread_pools_;
+
+        /// @brief pools of the calling thread, created on first use
+        VraThreadPools &get_thread_pools();
+
+        /// @brief take a pool with free space, create a grown one if none is left
+        VkDescriptorPool grab_pool(VraPoolSet &pool_set);
+
+        VkDescriptorPool create_pool(uint32_t set_count);
+    };
+
+    // --- Descriptor Cache ---
+
+    /// @brief payload of one descriptor, which member is read depends on the descriptor type
+    union VraDescriptorInfo
+    {
+        VkDescriptorBufferInfo buffer;
+        VkDescriptorImageInfo image;
+        VkBufferView texel_buffer_view;
+    };
+
+    /// @brief one binding of a cached set, descriptorCount is always 1
+    struct VraDescriptorBinding
+    {
+        uint32_t binding = 0;
+        VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        VraDescriptorInfo info{};
+    };
+
+    struct VraDescriptorCacheStatistics
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint32_t live_sets = 0;
+        uint32_t capacity = 0;
+
+        float GetHitRate() const { return hits + misses == 0 ? 0.0f : static_cast<float>(hits) / static_cast<float>(hits + misses); }
+    };
+
+    /// @brief Descriptor set cache keyed by layout and binding contents.
+    /// @note 1.lookups are lock-free and may run on any thread, misses serialize on a writer mutex.
+    /// @note 2.misses are written with vkUpdateDescriptorSetWithTemplate, templates are cached per binding shape.
+    /// @note 3.Tick evicts sets unused for max_age_frames and must not run concurrently with lookups.
+    /// @note 4.evicted sets are recycled for later misses of the same layout instead of being freed.
+    class VraDescriptorCache
+    {
+    public:
+        VraDescriptorCache() = delete;
+        VraDescriptorCache(VkDevice device, VraDescriptorAllocator &allocator, uint32_t initial_capacity = 256, uint32_t max_age_frames = 120);
+        ~VraDescriptorCache();
+
+        VraDescriptorCache(const VraDescriptorCache &) = delete;
+        VraDescriptorCache &operator=(const VraDescriptorCache &) = delete;
+
+        /// @brief find a set with identical contents or build one
+        /// @param layout layout of the set
+        /// @param bindings binding contents, the order is part of the key
+        /// @param descriptor_set output set
+        /// @param current_frame serial of the frame which will use the set
+        /// @return true if succeeded
+        bool GetOrCreate(VkDescriptorSetLayout layout,
+                         const std::vector<VraDescriptorBinding> &bindings,
+                         VkDescriptorSet &descriptor_set,
+                         uint64_t current_frame);
+
+        /// @brief evict sets which have not been used for max_age_frames and are no longer in flight
+        /// @param current_frame serial of the frame being recorded
+        /// @param completed_frame serial of the last frame retired by the GPU
+        void Tick(uint64_t current_frame, uint64_t completed_frame);
+
+        VraDescriptorCacheStatistics GetStatistics() const;
+
+    private:
+        static constexpr uint64_t EMPTY_HASH = 0;
+        static constexpr uint64_t TOMBSTONE_HASH = 1;
+
+        struct VraCacheSlot
+        {
+            // - Published last with release semantics, key fields are immutable once published
+            std::atomic<uint64_t> hash = EMPTY_HASH;
+            std::atomic<uint64_t> last_used_frame = 0;
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+            std::vector<VraDescriptorBinding> bindings;
+        };
+
+        struct VraCacheTable
+        {
+            std::unique_ptr<VraCacheSlot[]> slots;
+            uint32_t capacity = 0; // power of two
+            uint32_t used = 0;     // live and tombstone slots, tombstones are only reclaimed by a rehash
+            uint32_t live = 0;
+        };
+
+        using TemplateKey = std::pair<VkDescriptorSetLayout, std::vector<std::pair<uint32_t, VkDescriptorType>>>;
+
+        VkDevice device_;
+        VraDescriptorAllocator &allocator_;
+        uint32_t max_age_frames_;
+
+        std::atomic<VraCacheTable *> table_;
+        std::vector<std::unique_ptr<VraCacheTable>> tables_; // current table is the last one
+        std::mutex writer_mutex_;
+
+        std::map<TemplateKey, VkDescriptorUpdateTemplate> templates_;
+        std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> recycled_sets_;
+
+        std::atomic<uint64_t> hits_ = 0;
+        std::atomic<uint64_t> misses_ = 0;
+        uint64_t evictions_ = 0;
+
+        static uint64_t hash_key(VkDescriptorSetLayout layout, const std::vector<VraDescriptorBinding> &bindings);
+        static bool same_key(const VraCacheSlot &slot, VkDescriptorSetLayout layout, const std::vector<VraDescriptorBinding> &bindings);
+        static VraCacheSlot *find(VraCacheTable &table, uint64_t hash, VkDescriptorSetLayout layout, const std::vector<VraDescriptorBinding> &bindings);
+
+        /// @brief move live entries into a new table, the old one is freed by the next Tick
+        void rehash(uint32_t capacity);
+
+        VkDescriptorUpdateTemplate get_update_template(VkDescriptorSetLayout layout, const std::vector<VraDescriptorBinding> &bindings);
+    };
+}
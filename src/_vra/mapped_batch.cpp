@@ -0,0 +1,79 @@
+#include "mapped_batch.h"
+#include <algorithm>
+#include <iostream>
+
+namespace vra
+{
+    // -----------------------------------
+    // --- Mapped Batch Implementation ---
+
+    VraMappedBatch::VraMappedBatch(VmaAllocator allocator, VmaAllocation allocation, const VraDataBatcher::VraBatchHandle &batch_handle)
+        : allocator_(allocator), allocation_(allocation), size_(batch_handle.consolidated_data.size()), offsets_(batch_handle.offsets)
+    {
+        VkMemoryPropertyFlags memory_flags = 0;
+        vmaGetAllocationMemoryProperties(allocator_, allocation_, &memory_flags);
+        coherent_ = (memory_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+        VmaAllocationInfo allocation_info = {};
+        vmaGetAllocationInfo(allocator_, allocation_, &allocation_info);
+        if (allocation_info.pMappedData != nullptr)
+        {
+            mapped_data_ = static_cast<uint8_t *>(allocation_info.pMappedData);
+            return;
+        }
+
+        void *mapped_data = nullptr;
+        VkResult result = vmaMapMemory(allocator_, allocation_, &mapped_data);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraMappedBatch: failed to map batch memory, VkResult: " << result << std::endl;
+            return;
+        }
+        mapped_data_ = static_cast<uint8_t *>(mapped_data);
+        owns_mapping_ = true;
+    }
+
+    VraMappedBatch::~VraMappedBatch()
+    {
+        Flush();
+        if (owns_mapping_)
+            vmaUnmapMemory(allocator_, allocation_);
+    }
+
+    void VraMappedBatch::MarkDirty(VkDeviceSize offset, VkDeviceSize size)
+    {
+        if (!coherent_ && size != 0)
+            dirty_ranges_.emplace_back(offset, size);
+    }
+
+    bool VraMappedBatch::Flush()
+    {
+        if (dirty_ranges_.empty())
+            return true;
+
+        // merge overlapping and touching ranges, VMA widens each one to nonCoherentAtomSize
+        std::sort(dirty_ranges_.begin(), dirty_ranges_.end());
+        std::vector<VkDeviceSize> offsets;
+        std::vector<VkDeviceSize> sizes;
+        for (const auto &[offset, size] : dirty_ranges_)
+        {
+            if (!offsets.empty() && offset <= offsets.back() + sizes.back())
+            {
+                sizes.back() = std::max(sizes.back(), offset + size - offsets.back());
+                continue;
+            }
+            offsets.push_back(offset);
+            sizes.push_back(size);
+        }
+        dirty_ranges_.clear();
+
+        std::vector<VmaAllocation> allocations(offsets.size(), allocation_);
+        VkResult result = vmaFlushAllocations(allocator_, static_cast<uint32_t>(allocations.size()), allocations.data(), offsets.data(), sizes.data());
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraMappedBatch: failed to flush dirty ranges, VkResult: " << result << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
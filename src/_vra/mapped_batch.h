@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vra.h"
+#include <vma/vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vra
+{
+    /// @brief Persistently mapped view of a host visible batch buffer.
+    /// @note 1.memory is mapped once, VMA's pointer is reused when the allocation was created with MAPPED_BIT.
+    /// @note 2.views mark their range dirty, Flush sends the merged dirty ranges to VMA in one call.
+    /// @note 3.Flush is a no-op on host coherent memory.
+    /// @note 4.not thread safe.
+    class VraMappedBatch
+    {
+    public:
+        VraMappedBatch() = delete;
+        VraMappedBatch(VmaAllocator allocator, VmaAllocation allocation, const VraDataBatcher::VraBatchHandle &batch_handle);
+        ~VraMappedBatch();
+
+        VraMappedBatch(const VraMappedBatch &) = delete;
+        VraMappedBatch &operator=(const VraMappedBatch &) = delete;
+
+        /// @brief typed write view of a resource inside the batch, the range is marked dirty
+        /// @param id resource id returned by VraDataBatcher::Collect
+        /// @param count number of elements in the view
+        /// @return the view, empty if the resource is unknown or the view would leave the buffer
+        template <typename T>
+        std::span<T> GetView(ResourceId id, size_t count = 1)
+        {
+            auto it = offsets_.find(id);
+            if (mapped_data_ == nullptr || it == offsets_.end() || it->second + sizeof(T) * count > size_)
+                return {};
+
+            MarkDirty(it->second, sizeof(T) * count);
+            return {reinterpret_cast<T *>(mapped_data_ + it->second), count};
+        }
+
+        /// @brief record a range written through GetMappedData
+        void MarkDirty(VkDeviceSize offset, VkDeviceSize size);
+
+        /// @brief flush every dirty range, adjacent and overlapping ranges are merged first
+        /// @return true if succeeded
+        bool Flush();
+
+        void *GetMappedData() const { return mapped_data_; }
+        bool IsCoherent() const { return coherent_; }
+
+    private:
+        VmaAllocator allocator_;
+        VmaAllocation allocation_;
+        uint8_t *mapped_data_ = nullptr;
+        size_t size_ = 0;
+        bool coherent_ = false;
+        bool owns_mapping_ = false; // mapped by us rather than through MAPPED_BIT
+
+        std::unordered_map<ResourceId, size_t> offsets_;
+        std::vector<std::pair<VkDeviceSize, VkDeviceSize>> dirty_ranges_; // offset, size
+    };
+}
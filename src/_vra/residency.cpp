@@ -0,0 +1,122 @@
+#include "residency.h"
+
+namespace vra
+{
+    // ----------------------------------------
+    // --- Residency Manager Implementation ---
+
+    VraResidencyManager::VraResidencyManager(VmaAllocator allocator, VraResidencyConfig config)
+        : allocator_(allocator), config_(config)
+    {
+        const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+        vmaGetMemoryProperties(allocator_, &memory_properties);
+        heap_count_ = memory_properties->memoryHeapCount;
+        vmaGetHeapBudgets(allocator_, budgets_);
+    }
+
+    void VraResidencyManager::Register(ResourceId id, VraResidentResource resource)
+    {
+        Unregister(id);
+        lru_.push_front(id);
+        VraResidencyEntry entry{std::move(resource), completed_frame_, true, lru_.begin()};
+        entries_.emplace(id, std::move(entry));
+    }
+
+    void VraResidencyManager::Unregister(ResourceId id)
+    {
+        auto it = entries_.find(id);
+        if (it == entries_.end())
+            return;
+        lru_.erase(it->second.lru_it);
+        entries_.erase(it);
+    }
+
+    uint32_t VraResidencyManager::GetHeapIndex(VmaAllocation allocation) const
+    {
+        VmaAllocationInfo allocation_info{};
+        vmaGetAllocationInfo(allocator_, allocation, &allocation_info);
+        const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+        vmaGetMemoryProperties(allocator_, &memory_properties);
+        return memory_properties->memoryTypes[allocation_info.memoryType].heapIndex;
+    }
+
+    void VraResidencyManager::Update(uint64_t completed_frame)
+    {
+        completed_frame_ = completed_frame;
+        vmaGetHeapBudgets(allocator_, budgets_);
+
+        for (uint32_t heap_index = 0; heap_index < heap_count_; ++heap_index)
+        {
+            const VmaBudget &budget = budgets_[heap_index];
+            auto eviction_limit = static_cast<VkDeviceSize>(static_cast<double>(budget.budget) * config_.eviction_fraction);
+            if (budget.usage > eviction_limit)
+                evict_until(heap_index, static_cast<VkDeviceSize>(static_cast<double>(budget.budget) * config_.target_fraction));
+        }
+    }
+
+    bool VraResidencyManager::Touch(ResourceId id, uint64_t current_frame)
+    {
+        auto it = entries_.find(id);
+        if (it == entries_.end())
+            return false;
+
+        VraResidencyEntry &entry = it->second;
+        if (!entry.resident)
+        {
+            // reloading into a heap that is still short would only evict it again next frame
+            if (!make_room(entry.resource.heap_index, entry.resource.size, config_.reload_fraction))
+                return false;
+            if (!entry.resource.reload || !entry.resource.reload())
+                return false;
+            entry.resident = true;
+            budgets_[entry.resource.heap_index].usage += entry.resource.size;
+        }
+
+        entry.last_use_frame = current_frame;
+        lru_.splice(lru_.begin(), lru_, entry.lru_it);
+        return true;
+    }
+
+    bool VraResidencyManager::MakeRoom(uint32_t heap_index, VkDeviceSize size)
+    {
+        return make_room(heap_index, size, config_.eviction_fraction);
+    }
+
+    bool VraResidencyManager::IsResident(ResourceId id) const
+    {
+        auto it = entries_.find(id);
+        return it != entries_.end() && it->second.resident;
+    }
+
+    void VraResidencyManager::evict_until(uint32_t heap_index, VkDeviceSize limit)
+    {
+        VmaBudget &budget = budgets_[heap_index];
+
+        // walk from the least recently used end, everything after an in-flight resource is in flight too
+        for (auto lru_it = lru_.rbegin(); lru_it != lru_.rend() && budget.usage > limit; ++lru_it)
+        {
+            VraResidencyEntry &entry = entries_[*lru_it];
+            if (entry.last_use_frame > completed_frame_)
+                break;
+            if (!entry.resident || entry.resource.heap_index != heap_index || !entry.resource.evict)
+                continue;
+
+            if (!entry.resource.evict())
+                continue;
+            entry.resident = false;
+            // vma refreshes the real usage on the next poll, keep a projection until then
+            budget.usage = budget.usage > entry.resource.size ? budget.usage - entry.resource.size : 0;
+        }
+    }
+
+    bool VraResidencyManager::make_room(uint32_t heap_index, VkDeviceSize size, float fraction)
+    {
+        const VmaBudget &budget = budgets_[heap_index];
+        auto limit = static_cast<VkDeviceSize>(static_cast<double>(budget.budget) * fraction);
+        if (budget.usage + size <= limit)
+            return true;
+
+        evict_until(heap_index, limit > size ? limit - size : 0);
+        return budgets_[heap_index].usage + size <= limit;
+    }
+}
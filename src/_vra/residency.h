@@ -0,0 +1,113 @@
+#pragma once
+
+#include "vra.h"
+#include <vma/vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+namespace vra
+{
+    // --- Residency Config ---
+    struct VraResidencyConfig
+    {
+        // - Eviction starts when a heap's usage exceeds this fraction of its budget
+        float eviction_fraction = 0.9f;
+
+        // - Eviction stops once a heap's usage falls under this fraction of its budget
+        float target_fraction = 0.8f;
+
+        // - An evicted resource is reloaded only if the heap's usage stays under this fraction with it,
+        //   the gap to eviction_fraction keeps a reload from triggering the next eviction
+        float reload_fraction = 0.75f;
+    };
+
+    /// @brief VraResidentResource describes a streamable resource owned by the caller.
+    /// @note evict releases the device memory and returns false if it cannot be released right now,
+    /// @note reload re-creates it from a source that stays on the host.
+    struct VraResidentResource
+    {
+        VkDeviceSize size = 0;
+        uint32_t heap_index = 0;
+        std::function<bool()> evict;
+        std::function<bool()> reload;
+    };
+
+    /// @brief Tracks per-resource last-use frames against vma heap budgets and evicts least-recently-used
+    /// @brief resources when a heap runs short, so the application degrades instead of failing allocations.
+    /// @note 1.frames are monotonically increasing serials, completed frame is the last one retired by the GPU.
+    /// @note 2.a resource used by a frame in flight is never evicted.
+    class VraResidencyManager
+    {
+    public:
+        VraResidencyManager() = delete;
+        VraResidencyManager(VmaAllocator allocator, VraResidencyConfig config = {});
+        ~VraResidencyManager() = default;
+
+        VraResidencyManager(const VraResidencyManager &) = delete;
+        VraResidencyManager &operator=(const VraResidencyManager &) = delete;
+
+        // --- Registration ---
+
+        /// @brief register a resident resource
+        /// @param id resource id, usually the one returned by the data batcher
+        /// @param resource size, heap and evict/reload hooks of the resource
+        void Register(ResourceId id, VraResidentResource resource);
+
+        /// @brief unregister a resource without evicting it
+        void Unregister(ResourceId id);
+
+        /// @brief heap index backing an allocation, used to fill VraResidentResource::heap_index
+        uint32_t GetHeapIndex(VmaAllocation allocation) const;
+
+        // --- Frame Driven Processing ---
+
+        /// @brief poll heap budgets and evict idle resources of heaps over the eviction fraction
+        /// @param completed_frame serial of the last frame retired by the GPU
+        void Update(uint64_t completed_frame);
+
+        /// @brief mark a resource as used by the current frame, reload it on demand
+        /// @param current_frame serial of the frame being recorded
+        /// @return true if the resource is resident and can be used by this frame,
+        /// @return false if it stays evicted because it does not fit under the reload fraction
+        bool Touch(ResourceId id, uint64_t current_frame);
+
+        /// @brief evict idle resources until size bytes fit into the heap's budget
+        /// @return true if the allocation is expected to fit
+        bool MakeRoom(uint32_t heap_index, VkDeviceSize size);
+
+        // --- Statistics ---
+
+        const VmaBudget &GetHeapBudget(uint32_t heap_index) const { return budgets_[heap_index]; }
+        uint32_t GetHeapCount() const { return heap_count_; }
+        bool IsResident(ResourceId id) const;
+
+    private:
+        struct VraResidencyEntry
+        {
+            VraResidentResource resource;
+            uint64_t last_use_frame = 0;
+            bool resident = true;
+            std::list<ResourceId>::iterator lru_it;
+        };
+
+        VmaAllocator allocator_;
+        VraResidencyConfig config_;
+
+        uint32_t heap_count_ = 0;
+        VmaBudget budgets_[VK_MAX_MEMORY_HEAPS]{};
+        uint64_t completed_frame_ = 0;
+
+        // - Front is the most recently used
+        std::list<ResourceId> lru_;
+        std::unordered_map<ResourceId, VraResidencyEntry> entries_;
+
+        /// @brief evict idle resources of one heap until its projected usage is under limit
+        void evict_until(uint32_t heap_index, VkDeviceSize limit);
+
+        /// @brief evict idle resources until size bytes fit under fraction of the heap's budget
+        bool make_room(uint32_t heap_index, VkDeviceSize size, float fraction);
+    };
+}
@@ -0,0 +1,83 @@
+#include "staging_ring.h"
+#include <algorithm>
+#include <iostream>
+
+namespace vra
+{
+    // -----------------------------------
+    // --- Staging Ring Implementation ---
+
+    VraStagingRing::VraStagingRing(VmaAllocator allocator, VraStagingRingConfig config)
+        : allocator_(allocator), config_(config)
+    {
+        // a size multiple of the alignment keeps aligned positions aligned after wrapping
+        config_.alignment = std::max<VkDeviceSize>(config_.alignment, 1);
+        config_.size = (config_.size + config_.alignment - 1) / config_.alignment * config_.alignment;
+    }
+
+    VraStagingRing::~VraStagingRing()
+    {
+        if (buffer_ != VK_NULL_HANDLE)
+            vmaDestroyBuffer(allocator_, buffer_, allocation_);
+    }
+
+    bool VraStagingRing::Create()
+    {
+        VkBufferCreateInfo buffer_info = {};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size = config_.size;
+        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocation_create_info = {};
+        allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+        allocation_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        VmaAllocationInfo allocation_info = {};
+        VkResult result = vmaCreateBuffer(allocator_, &buffer_info, &allocation_create_info, &buffer_, &allocation_, &allocation_info);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraStagingRing: failed to create ring buffer, VkResult: " << result << std::endl;
+            return false;
+        }
+        mapped_data_ = allocation_info.pMappedData;
+        return true;
+    }
+
+    VkDeviceSize VraStagingRing::Allocate(VkDeviceSize size, VkDeviceSize &offset)
+    {
+        VkDeviceSize aligned_head = (head_ + config_.alignment - 1) / config_.alignment * config_.alignment;
+        VkDeviceSize used = aligned_head - tail_;
+        if (size == 0 || used >= config_.size)
+            return 0;
+
+        // contiguous space ends either at the end of the buffer or at the tail
+        offset = aligned_head % config_.size;
+        VkDeviceSize contiguous = std::min(config_.size - offset, config_.size - used);
+        VkDeviceSize granted = std::min(size, contiguous);
+        head_ = aligned_head + granted;
+        return granted;
+    }
+
+    void VraStagingRing::Flush(VkDeviceSize offset, VkDeviceSize size)
+    {
+        vmaFlushAllocation(allocator_, allocation_, offset, size);
+    }
+
+    void VraStagingRing::Retire(uint64_t value)
+    {
+        if (head_ == retired_head_)
+            return;
+        retired_chunks_.push_back({head_, value});
+        retired_head_ = head_;
+    }
+
+    void VraStagingRing::Recycle(uint64_t completed_value)
+    {
+        while (!retired_chunks_.empty() && retired_chunks_.front().value <= completed_value)
+        {
+            tail_ = retired_chunks_.front().end;
+            retired_chunks_.pop_front();
+        }
+    }
+}
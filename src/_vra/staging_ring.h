@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vma/vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+
+namespace vra
+{
+    // --- Staging Ring Config ---
+    struct VraStagingRingConfig
+    {
+        // - Total host visible memory of the ring, rounded up to the alignment
+        VkDeviceSize size = 64ull * 1024 * 1024;
+
+        // - Alignment of every allocation inside the ring
+        VkDeviceSize alignment = 16;
+    };
+
+    /// @brief Fixed size, persistently mapped staging buffer used as a ring.
+    /// @brief Space is handed out in contiguous chunks and recycled once the transfer reading it completes.
+    /// @note 1.allocations may be shorter than requested, callers copy large uploads chunk by chunk.
+    /// @note 2.everything allocated since the previous Retire completes with the value given to Retire.
+    /// @note 3.not thread safe, owned by the upload manager.
+    class VraStagingRing
+    {
+    public:
+        VraStagingRing() = delete;
+        VraStagingRing(VmaAllocator allocator, VraStagingRingConfig config = {});
+        ~VraStagingRing();
+
+        VraStagingRing(const VraStagingRing &) = delete;
+        VraStagingRing &operator=(const VraStagingRing &) = delete;
+
+        /// @brief create and map the ring buffer
+        /// @return true if succeeded
+        bool Create();
+
+        /// @brief reserve up to size contiguous bytes
+        /// @param size bytes wanted
+        /// @param offset output offset of the reserved bytes inside the ring buffer
+        /// @return bytes reserved, 0 if the ring is full
+        VkDeviceSize Allocate(VkDeviceSize size, VkDeviceSize &offset);
+
+        /// @brief make host writes visible to the device, a no-op on coherent memory
+        void Flush(VkDeviceSize offset, VkDeviceSize size);
+
+        /// @brief tag every allocation since the previous Retire with the timeline value of the transfer reading it
+        void Retire(uint64_t value);
+
+        /// @brief release the space of transfers whose value has been reached
+        void Recycle(uint64_t completed_value);
+
+        /// @return value of the oldest retired transfer still holding space, 0 if there is none
+        uint64_t GetOldestPendingValue() const { return retired_chunks_.empty() ? 0 : retired_chunks_.front().value; }
+
+        VkBuffer GetBuffer() const { return buffer_; }
+        void *GetMappedData(VkDeviceSize offset) const { return static_cast<uint8_t *>(mapped_data_) + offset; }
+        VkDeviceSize GetSize() const { return config_.size; }
+        VkDeviceSize GetUsedSize() const { return head_ - tail_; }
+
+    private:
+        struct VraRetiredChunk
+        {
+            VkDeviceSize end; // ring position right after the chunk
+            uint64_t value;
+        };
+
+        VmaAllocator allocator_;
+        VraStagingRingConfig config_;
+
+        VkBuffer buffer_ = VK_NULL_HANDLE;
+        VmaAllocation allocation_ = VK_NULL_HANDLE;
+        void *mapped_data_ = nullptr;
+
+        // - Monotonic positions, the buffer offset of a position is position % size
+        VkDeviceSize head_ = 0;
+        VkDeviceSize tail_ = 0;
+        VkDeviceSize retired_head_ = 0;
+        std::deque<VraRetiredChunk> retired_chunks_;
+    };
+}
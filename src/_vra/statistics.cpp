@@ -0,0 +1,204 @@
+#include "statistics.h"
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <iostream>
+
+namespace vra
+{
+    namespace
+    {
+        const char *to_string(VraDataMemoryPattern pattern)
+        {
+            switch (pattern)
+            {
+            case VraDataMemoryPattern::GPU_Only:
+                return "GPU_Only";
+            case VraDataMemoryPattern::CPU_GPU:
+                return "CPU_GPU";
+            case VraDataMemoryPattern::GPU_CPU:
+                return "GPU_CPU";
+            case VraDataMemoryPattern::SOC:
+                return "SOC";
+            case VraDataMemoryPattern::Stream_Ring:
+                return "Stream_Ring";
+            default:
+                return "Default";
+            }
+        }
+
+        const char *to_string(VraDataUpdateRate update_rate)
+        {
+            switch (update_rate)
+            {
+            case VraDataUpdateRate::Frequent:
+                return "Frequent";
+            case VraDataUpdateRate::RarelyOrNever:
+                return "RarelyOrNever";
+            default:
+                return "Default";
+            }
+        }
+
+        void fill_heap_statistics(const VmaDetailedStatistics &detailed, VraHeapStatistics &heap)
+        {
+            heap.block_count = detailed.statistics.blockCount;
+            heap.allocation_count = detailed.statistics.allocationCount;
+            heap.block_bytes = detailed.statistics.blockBytes;
+            heap.allocation_bytes = detailed.statistics.allocationBytes;
+            heap.unused_range_count = detailed.unusedRangeCount;
+            heap.largest_unused_range = detailed.unusedRangeCount == 0 ? 0 : detailed.unusedRangeSizeMax;
+            heap.fragmentation = CalculateFragmentation(detailed);
+        }
+
+        nlohmann::json heap_to_json(const VraHeapStatistics &heap)
+        {
+            return {
+                {"index", heap.heap_index},
+                {"device_local", heap.device_local},
+                {"size", heap.heap_size},
+                {"budget", heap.budget},
+                {"usage", heap.usage},
+                {"block_count", heap.block_count},
+                {"allocation_count", heap.allocation_count},
+                {"block_bytes", heap.block_bytes},
+                {"allocation_bytes", heap.allocation_bytes},
+                {"unused_range_count", heap.unused_range_count},
+                {"largest_unused_range", heap.largest_unused_range},
+                {"fragmentation", heap.fragmentation},
+            };
+        }
+    }
+
+    // -------------------------------------------
+    // --- Statistics Reporter Implementation ---
+
+    VraStatisticsReporter::VraStatisticsReporter(VmaAllocator allocator, VraStatisticsConfig config)
+        : allocator_(allocator), config_(std::move(config))
+    {
+    }
+
+    void VraStatisticsReporter::TrackBatch(const BatchId &batch_id,
+                                           const VraDataBatcher::VraBatchHandle &batch_handle,
+                                           VkDeviceSize allocation_bytes)
+    {
+        VraBatchStatistics statistics;
+        statistics.batch_id = batch_id;
+        statistics.memory_pattern = batch_handle.data_desc.GetMemoryPattern();
+        statistics.update_rate = batch_handle.data_desc.GetUpdateRate();
+        statistics.item_count = batch_handle.offsets.size();
+        statistics.buffer_bytes = batch_handle.consolidated_data.size();
+        statistics.padding_bytes = batch_handle.padding_bytes;
+        statistics.payload_bytes = statistics.buffer_bytes - statistics.padding_bytes;
+        statistics.allocation_bytes = allocation_bytes;
+        batches_[batch_id] = statistics;
+    }
+
+    void VraStatisticsReporter::UntrackBatch(const BatchId &batch_id)
+    {
+        batches_.erase(batch_id);
+    }
+
+    VraMemorySnapshot VraStatisticsReporter::Capture(uint64_t frame) const
+    {
+        VraMemorySnapshot snapshot;
+        snapshot.frame = frame;
+
+        const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+        vmaGetMemoryProperties(allocator_, &memory_properties);
+
+        VmaTotalStatistics total_statistics = {};
+        vmaCalculateStatistics(allocator_, &total_statistics);
+
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS] = {};
+        vmaGetHeapBudgets(allocator_, budgets);
+
+        for (uint32_t i = 0; i < memory_properties->memoryHeapCount; ++i)
+        {
+            VraHeapStatistics heap;
+            heap.heap_index = i;
+            heap.device_local = (memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+            heap.heap_size = memory_properties->memoryHeaps[i].size;
+            heap.budget = budgets[i].budget;
+            heap.usage = budgets[i].usage;
+            fill_heap_statistics(total_statistics.memoryHeap[i], heap);
+            snapshot.heaps.push_back(heap);
+        }
+        fill_heap_statistics(total_statistics.total, snapshot.total);
+
+        snapshot.batches.reserve(batches_.size());
+        for (const auto &[batch_id, batch] : batches_)
+            snapshot.batches.push_back(batch);
+
+        char *stats_string = nullptr;
+        vmaBuildStatsString(allocator_, &stats_string, config_.include_detailed_map ? VK_TRUE : VK_FALSE);
+        if (stats_string != nullptr)
+        {
+            snapshot.vma_stats = stats_string;
+            vmaFreeStatsString(allocator_, stats_string);
+        }
+        return snapshot;
+    }
+
+    std::string VraStatisticsReporter::ToJson(const VraMemorySnapshot &snapshot) const
+    {
+        nlohmann::json document;
+        document["frame"] = snapshot.frame;
+        document["total"] = heap_to_json(snapshot.total);
+
+        document["heaps"] = nlohmann::json::array();
+        for (const auto &heap : snapshot.heaps)
+            document["heaps"].push_back(heap_to_json(heap));
+
+        document["batches"] = nlohmann::json::array();
+        for (const auto &batch : snapshot.batches)
+        {
+            document["batches"].push_back({
+                {"id", batch.batch_id},
+                {"memory_pattern", to_string(batch.memory_pattern)},
+                {"update_rate", to_string(batch.update_rate)},
+                {"items", batch.item_count},
+                {"payload_bytes", batch.payload_bytes},
+                {"padding_bytes", batch.padding_bytes},
+                {"buffer_bytes", batch.buffer_bytes},
+                {"allocation_bytes", batch.allocation_bytes},
+                {"alignment_waste", batch.allocation_bytes > batch.buffer_bytes ? batch.allocation_bytes - batch.buffer_bytes : 0},
+            });
+        }
+
+        // VMA's own document is embedded as an object so the snapshot stays one json tree,
+        // a string it failed to parse is kept as a string, a discarded value would not serialize
+        if (!snapshot.vma_stats.empty())
+        {
+            nlohmann::json vma_document = nlohmann::json::parse(snapshot.vma_stats, nullptr, false);
+            if (vma_document.is_discarded())
+            {
+                std::cerr << "VraStatisticsReporter: VMA stats string is not valid json, embedded as a string" << std::endl;
+                document["vma"] = snapshot.vma_stats;
+            }
+            else
+            {
+                document["vma"] = std::move(vma_document);
+            }
+        }
+        return document.dump(2);
+    }
+
+    bool VraStatisticsReporter::Dump(uint64_t frame) const
+    {
+        std::string path = config_.output_directory + "/vra_memory_" + std::to_string(frame) + ".json";
+        std::ofstream file(path);
+        if (!file.is_open())
+        {
+            std::cerr << "VraStatisticsReporter: failed to open " << path << std::endl;
+            return false;
+        }
+        file << ToJson(Capture(frame));
+        return file.good();
+    }
+
+    void VraStatisticsReporter::Tick(uint64_t frame)
+    {
+        if (config_.dump_interval_frames != 0 && frame % config_.dump_interval_frames == 0)
+            Dump(frame);
+    }
+}
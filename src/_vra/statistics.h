@@ -0,0 +1,107 @@
+#pragma once
+
+#include "vra.h"
+#include <vma/vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vra
+{
+    // --- Statistics Config ---
+    struct VraStatisticsConfig
+    {
+        // - Directory json snapshots are written to, files are named vra_memory_<frame>.json
+        std::string output_directory = ".";
+
+        // - Write a snapshot every N frames from Tick, 0 only dumps on demand
+        uint32_t dump_interval_frames = 0;
+
+        // - Embed VMA's detailed map (every block and allocation) into the snapshot
+        bool include_detailed_map = false;
+    };
+
+    /// @brief memory spent by one batch
+    struct VraBatchStatistics
+    {
+        BatchId batch_id;
+        VraDataMemoryPattern memory_pattern = VraDataMemoryPattern::Default;
+        VraDataUpdateRate update_rate = VraDataUpdateRate::Default;
+        size_t item_count = 0;
+        VkDeviceSize payload_bytes = 0;    // bytes of collected data
+        VkDeviceSize padding_bytes = 0;    // bytes inserted between items to satisfy offset alignment
+        VkDeviceSize buffer_bytes = 0;     // size of the batch buffer
+        VkDeviceSize allocation_bytes = 0; // size of the VMA allocation backing the buffer, 0 if not known
+    };
+
+    /// @brief memory spent in one heap
+    struct VraHeapStatistics
+    {
+        uint32_t heap_index = 0;
+        bool device_local = false;
+        VkDeviceSize heap_size = 0;
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0;
+        uint32_t block_count = 0;
+        uint32_t allocation_count = 0;
+        VkDeviceSize block_bytes = 0;
+        VkDeviceSize allocation_bytes = 0;
+        uint32_t unused_range_count = 0;
+        VkDeviceSize largest_unused_range = 0;
+
+        // - CalculateFragmentation of the heap, the same figure the defragmenter's threshold is compared to
+        float fragmentation = 0.0f;
+    };
+
+    struct VraMemorySnapshot
+    {
+        uint64_t frame = 0;
+        std::vector<VraHeapStatistics> heaps;
+        std::vector<VraBatchStatistics> batches;
+        VraHeapStatistics total;
+        std::string vma_stats; // VMA's json stats string
+    };
+
+    /// @brief Aggregates VMA statistics with VRA batch metadata and writes json snapshots.
+    /// @note 1.batches are tracked by the owner, the reporter keeps a summary, not the batch data.
+    /// @note 2.not thread safe, expected to be driven by the render thread.
+    class VraStatisticsReporter
+    {
+    public:
+        VraStatisticsReporter() = delete;
+        VraStatisticsReporter(VmaAllocator allocator, VraStatisticsConfig config = {});
+        ~VraStatisticsReporter() = default;
+
+        // --- Batch Tracking ---
+
+        /// @brief record the layout of a batch, tracking the same id again replaces it
+        /// @param batch_id id of the batch
+        /// @param batch_handle batch result of VraDataBatcher::Batch
+        /// @param allocation_bytes size of the allocation backing the batch buffer
+        void TrackBatch(const BatchId &batch_id, const VraDataBatcher::VraBatchHandle &batch_handle, VkDeviceSize allocation_bytes = 0);
+        void UntrackBatch(const BatchId &batch_id);
+
+        // --- Snapshot ---
+
+        /// @brief gather the current statistics
+        /// @param frame frame serial stored in the snapshot
+        VraMemorySnapshot Capture(uint64_t frame) const;
+
+        /// @return the snapshot as a json document
+        std::string ToJson(const VraMemorySnapshot &snapshot) const;
+
+        /// @brief capture and write a snapshot
+        /// @return true if the file was written
+        bool Dump(uint64_t frame) const;
+
+        /// @brief dump a snapshot every dump_interval_frames frames
+        void Tick(uint64_t frame);
+
+    private:
+        VmaAllocator allocator_;
+        VraStatisticsConfig config_;
+        std::map<BatchId, VraBatchStatistics> batches_;
+    };
+}
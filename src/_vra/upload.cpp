@@ -0,0 +1,306 @@
+#include "upload.h"
+#include <cstring>
+#include <iostream>
+
+namespace vra
+{
+    // -------------------------------------
+    // --- Upload Manager Implementation ---
+
+    VraUploadManager::VraUploadManager(VkDevice device, VmaAllocator allocator, VraUploadManagerConfig config)
+        : device_(device), config_(config), staging_ring_(allocator, config.staging_ring)
+    {
+    }
+
+    VraUploadManager::~VraUploadManager()
+    {
+        if (timeline_semaphore_ != VK_NULL_HANDLE)
+        {
+            Wait(GetLastSubmittedValue());
+            Collect();
+            vkDestroySemaphore(device_, timeline_semaphore_, nullptr);
+        }
+        if (command_pool_ != VK_NULL_HANDLE)
+            vkDestroyCommandPool(device_, command_pool_, nullptr);
+    }
+
+    bool VraUploadManager::Create()
+    {
+        if (!staging_ring_.Create())
+            return false;
+
+        VkCommandPoolCreateInfo pool_info = {};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        pool_info.queueFamilyIndex = config_.transfer_queue_family;
+        VkResult result = vkCreateCommandPool(device_, &pool_info, nullptr, &command_pool_);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraUploadManager: failed to create command pool, VkResult: " << result << std::endl;
+            return false;
+        }
+
+        VkSemaphoreTypeCreateInfo type_info = {};
+        type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphore_info = {};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext = &type_info;
+        result = vkCreateSemaphore(device_, &semaphore_info, nullptr, &timeline_semaphore_);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraUploadManager: failed to create timeline semaphore, VkResult: " << result << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool VraUploadManager::Enqueue(const VraBufferUpload &upload)
+    {
+        if (upload.dst_buffer == VK_NULL_HANDLE || upload.data == nullptr || upload.size == 0)
+        {
+            std::cerr << "VraUploadManager: invalid upload" << std::endl;
+            return false;
+        }
+
+        // stream the data through the ring, one region per contiguous chunk
+        const auto *src = static_cast<const uint8_t *>(upload.data);
+        VkDeviceSize staged = 0;
+        while (staged < upload.size)
+        {
+            VkDeviceSize src_offset = 0;
+            VkDeviceSize chunk_size = staging_ring_.Allocate(upload.size - staged, src_offset);
+            if (chunk_size == 0)
+            {
+                if (!make_room())
+                    return false;
+                continue;
+            }
+
+            std::memcpy(staging_ring_.GetMappedData(src_offset), src + staged, chunk_size);
+            queued_regions_.push_back({upload.dst_buffer,
+                                       upload.dst_offset + staged,
+                                       src_offset,
+                                       chunk_size,
+                                       upload.dst_stage_mask,
+                                       upload.dst_access_mask});
+            staged += chunk_size;
+        }
+        return true;
+    }
+
+    uint64_t VraUploadManager::Submit()
+    {
+        if (queued_regions_.empty())
+            return 0;
+
+        VraSubmission submission{next_value_, VK_NULL_HANDLE};
+
+        for (const auto &region : queued_regions_)
+            staging_ring_.Flush(region.src_offset, region.size);
+
+        VkCommandBufferAllocateInfo command_buffer_info = {};
+        command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        command_buffer_info.commandPool = command_pool_;
+        command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        command_buffer_info.commandBufferCount = 1;
+        VkResult result = vkAllocateCommandBuffers(device_, &command_buffer_info, &submission.command_buffer);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraUploadManager: failed to allocate upload command buffer, VkResult: " << result << std::endl;
+            return abort_submit(VK_NULL_HANDLE);
+        }
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        result = vkBeginCommandBuffer(submission.command_buffer, &begin_info);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraUploadManager: failed to begin upload command buffer, VkResult: " << result << std::endl;
+            return abort_submit(submission.command_buffer);
+        }
+
+        for (const auto &region : queued_regions_)
+        {
+            VkBufferCopy copy = {region.src_offset, region.dst_offset, region.size};
+            vkCmdCopyBuffer(submission.command_buffer, staging_ring_.GetBuffer(), region.dst_buffer, 1, &copy);
+        }
+
+        // release the destination ranges to the graphics family
+        if (needs_ownership_transfer())
+        {
+            std::vector<VkBufferMemoryBarrier2> release_barriers;
+            release_barriers.reserve(queued_regions_.size());
+            for (const auto &region : queued_regions_)
+            {
+                VkBufferMemoryBarrier2 barrier = {};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+                barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+                barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+                barrier.srcQueueFamilyIndex = config_.transfer_queue_family;
+                barrier.dstQueueFamilyIndex = config_.graphics_queue_family;
+                barrier.buffer = region.dst_buffer;
+                barrier.offset = region.dst_offset;
+                barrier.size = region.size;
+                release_barriers.push_back(barrier);
+            }
+
+            VkDependencyInfo dependency_info = {};
+            dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency_info.bufferMemoryBarrierCount = static_cast<uint32_t>(release_barriers.size());
+            dependency_info.pBufferMemoryBarriers = release_barriers.data();
+            vkCmdPipelineBarrier2(submission.command_buffer, &dependency_info);
+        }
+        result = vkEndCommandBuffer(submission.command_buffer);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraUploadManager: failed to end upload command buffer, VkResult: " << result << std::endl;
+            return abort_submit(submission.command_buffer);
+        }
+
+        VkCommandBufferSubmitInfo command_buffer_submit_info = {};
+        command_buffer_submit_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        command_buffer_submit_info.commandBuffer = submission.command_buffer;
+
+        VkSemaphoreSubmitInfo signal_info = {};
+        signal_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        signal_info.semaphore = timeline_semaphore_;
+        signal_info.value = submission.value;
+        signal_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+        VkSubmitInfo2 submit_info = {};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        submit_info.commandBufferInfoCount = 1;
+        submit_info.pCommandBufferInfos = &command_buffer_submit_info;
+        submit_info.signalSemaphoreInfoCount = 1;
+        submit_info.pSignalSemaphoreInfos = &signal_info;
+        result = vkQueueSubmit2(config_.transfer_queue, 1, &submit_info, VK_NULL_HANDLE);
+        if (result != VK_SUCCESS)
+        {
+            std::cerr << "VraUploadManager: failed to submit uploads, VkResult: " << result << std::endl;
+            return abort_submit(submission.command_buffer);
+        }
+
+        ++next_value_;
+        staging_ring_.Retire(submission.value);
+        in_flight_.push_back(submission);
+        pending_acquires_.insert(pending_acquires_.end(), queued_regions_.begin(), queued_regions_.end());
+        pending_acquire_value_ = submission.value;
+        queued_regions_.clear();
+        return submission.value;
+    }
+
+    uint64_t VraUploadManager::RecordAcquireBarriers(VkCommandBuffer command_buffer, uint64_t current_serial)
+    {
+        if (pending_acquires_.empty())
+            return 0;
+
+        // same family: the semaphore wait alone makes the copies visible
+        if (needs_ownership_transfer())
+        {
+            std::vector<VkBufferMemoryBarrier2> acquire_barriers;
+            acquire_barriers.reserve(pending_acquires_.size());
+            for (const auto &region : pending_acquires_)
+            {
+                VkBufferMemoryBarrier2 barrier = {};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+                barrier.dstStageMask = region.dst_stage_mask;
+                barrier.dstAccessMask = region.dst_access_mask;
+                barrier.srcQueueFamilyIndex = config_.transfer_queue_family;
+                barrier.dstQueueFamilyIndex = config_.graphics_queue_family;
+                barrier.buffer = region.dst_buffer;
+                barrier.offset = region.dst_offset;
+                barrier.size = region.size;
+                acquire_barriers.push_back(barrier);
+            }
+
+            VkDependencyInfo dependency_info = {};
+            dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependency_info.bufferMemoryBarrierCount = static_cast<uint32_t>(acquire_barriers.size());
+            dependency_info.pBufferMemoryBarriers = acquire_barriers.data();
+            vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+        }
+
+        // an acquire that never runs leaves the buffer with the transfer family, an abandoned frame hands them back
+        recorded_acquires_ = std::move(pending_acquires_);
+        recorded_serial_ = current_serial;
+        pending_acquires_.clear();
+        return pending_acquire_value_;
+    }
+
+    void VraUploadManager::AbortAcquireBarriers(uint64_t serial)
+    {
+        if (recorded_acquires_.empty() || recorded_serial_ != serial)
+            return;
+
+        // the value waited on only grows, it still covers the releases of these regions
+        pending_acquires_.insert(pending_acquires_.begin(), recorded_acquires_.begin(), recorded_acquires_.end());
+        recorded_acquires_.clear();
+    }
+
+    void VraUploadManager::Collect()
+    {
+        if (in_flight_.empty())
+            return;
+
+        uint64_t completed_value = 0;
+        vkGetSemaphoreCounterValue(device_, timeline_semaphore_, &completed_value);
+        staging_ring_.Recycle(completed_value);
+        while (!in_flight_.empty() && in_flight_.front().value <= completed_value)
+        {
+            vkFreeCommandBuffers(device_, command_pool_, 1, &in_flight_.front().command_buffer);
+            in_flight_.pop_front();
+        }
+    }
+
+    bool VraUploadManager::IsComplete(uint64_t value) const
+    {
+        uint64_t completed_value = 0;
+        vkGetSemaphoreCounterValue(device_, timeline_semaphore_, &completed_value);
+        return completed_value >= value;
+    }
+
+    bool VraUploadManager::Wait(uint64_t value, uint64_t timeout) const
+    {
+        if (value == 0)
+            return true;
+
+        VkSemaphoreWaitInfo wait_info = {};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &timeline_semaphore_;
+        wait_info.pValues = &value;
+        return vkWaitSemaphores(device_, &wait_info, timeout) == VK_SUCCESS;
+    }
+
+    bool VraUploadManager::make_room()
+    {
+        // the ring may be full of chunks nobody has submitted yet
+        if (!queued_regions_.empty() && Submit() == 0)
+            return false;
+
+        uint64_t oldest_value = staging_ring_.GetOldestPendingValue();
+        if (oldest_value == 0 || !Wait(oldest_value))
+        {
+            std::cerr << "VraUploadManager: staging ring is full and no transfer can free it" << std::endl;
+            return false;
+        }
+        Collect();
+        return true;
+    }
+
+    uint64_t VraUploadManager::abort_submit(VkCommandBuffer command_buffer)
+    {
+        if (command_buffer != VK_NULL_HANDLE)
+            vkFreeCommandBuffers(device_, command_pool_, 1, &command_buffer);
+
+        // nothing reads the dropped chunks, they are free once earlier transfers finish
+        staging_ring_.Retire(GetLastSubmittedValue());
+        staging_ring_.Recycle(0);
+        queued_regions_.clear();
+        return 0;
+    }
+}
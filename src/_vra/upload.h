@@ -0,0 +1,137 @@
+#pragma once
+
+#include "staging_ring.h"
+#include <vma/vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace vra
+{
+    // --- Upload Manager Config ---
+    struct VraUploadManagerConfig
+    {
+        VkQueue transfer_queue = VK_NULL_HANDLE;
+        uint32_t transfer_queue_family = 0;
+
+        // - Family that consumes the uploaded buffers, ownership is transferred to it when it differs
+        uint32_t graphics_queue_family = 0;
+
+        // - Host visible staging memory, uploads larger than the ring are streamed through it in chunks
+        VraStagingRingConfig staging_ring;
+    };
+
+    /// @brief VraBufferUpload describes one host to buffer copy.
+    struct VraBufferUpload
+    {
+        VkBuffer dst_buffer = VK_NULL_HANDLE;
+        VkDeviceSize dst_offset = 0;
+        const void *data = nullptr;
+        VkDeviceSize size = 0;
+
+        // - Stages and accesses of the first use on the graphics queue
+        VkPipelineStageFlags2 dst_stage_mask = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
+        VkAccessFlags2 dst_access_mask = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT;
+    };
+
+    /// @brief Batches buffer uploads and submits them on a dedicated transfer queue.
+    /// @note 1.completion is tracked by one timeline semaphore, every Submit signals the next value.
+    /// @note 2.buffers are released by the transfer family and acquired by the graphics family (QFOT).
+    /// @note 3.staging memory comes from a fixed size ring, chunks are recycled once their value is reached.
+    /// @note 4.Enqueue blocks on the oldest transfer when the ring is full.
+    /// @note 5.not thread safe, uploads are expected from the render thread.
+    class VraUploadManager
+    {
+    public:
+        VraUploadManager() = delete;
+        VraUploadManager(VkDevice device, VmaAllocator allocator, VraUploadManagerConfig config);
+        ~VraUploadManager();
+
+        VraUploadManager(const VraUploadManager &) = delete;
+        VraUploadManager &operator=(const VraUploadManager &) = delete;
+
+        /// @brief create the command pool and the timeline semaphore
+        /// @return true if succeeded
+        bool Create();
+
+        // --- Upload ---
+
+        /// @brief queue an upload, the data is copied into the staging ring so the caller may release it right away
+        /// @note 1.if the ring fills up, queued uploads are submitted and the oldest transfer is waited on
+        /// @return true if succeeded
+        bool Enqueue(const VraBufferUpload &upload);
+
+        /// @brief record and submit every queued upload in one batch
+        /// @return timeline value signaled when the batch completes, 0 if nothing was queued or submission failed
+        uint64_t Submit();
+
+        /// @brief record ownership acquisition of every submitted buffer not acquired yet
+        /// @param command_buffer graphics command buffer, it must wait for the returned value
+        /// @param current_serial serial of the frame recording command_buffer
+        /// @return timeline value the graphics submit has to wait on, 0 if nothing was acquired
+        uint64_t RecordAcquireBarriers(VkCommandBuffer command_buffer, uint64_t current_serial);
+
+        /// @brief queue the acquisitions recorded into a frame that was never submitted again for the next one
+        /// @param serial serial of the abandoned frame, nothing happens if they were recorded into another one
+        void AbortAcquireBarriers(uint64_t serial);
+
+        // --- Completion ---
+
+        /// @brief recycle staging memory and free command buffers of completed submissions
+        void Collect();
+
+        bool IsComplete(uint64_t value) const;
+        bool Wait(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+
+        VkSemaphore GetTimelineSemaphore() const { return timeline_semaphore_; }
+        uint64_t GetLastSubmittedValue() const { return next_value_ - 1; }
+
+    private:
+        struct VraStagingRegion
+        {
+            VkBuffer dst_buffer;
+            VkDeviceSize dst_offset;
+            VkDeviceSize src_offset;
+            VkDeviceSize size;
+            VkPipelineStageFlags2 dst_stage_mask;
+            VkAccessFlags2 dst_access_mask;
+        };
+
+        struct VraSubmission
+        {
+            uint64_t value;
+            VkCommandBuffer command_buffer;
+        };
+
+        VkDevice device_;
+        VraUploadManagerConfig config_;
+        VraStagingRing staging_ring_;
+
+        VkCommandPool command_pool_ = VK_NULL_HANDLE;
+        VkSemaphore timeline_semaphore_ = VK_NULL_HANDLE;
+        uint64_t next_value_ = 1;
+
+        // - Uploads already copied into the ring, waiting for Submit
+        std::vector<VraStagingRegion> queued_regions_;
+
+        // - Released by the transfer queue, waiting for the graphics queue to acquire them
+        std::vector<VraStagingRegion> pending_acquires_;
+        uint64_t pending_acquire_value_ = 0;
+
+        // - Acquired by the last frame that recorded any, queued again if that frame is abandoned
+        std::vector<VraStagingRegion> recorded_acquires_;
+        uint64_t recorded_serial_ = 0;
+
+        std::deque<VraSubmission> in_flight_;
+
+        /// @brief submit queued uploads and wait for the oldest transfer to free ring space
+        bool make_room();
+
+        /// @brief drop queued uploads whose submit failed, free the command buffer if one was allocated
+        /// @return 0, the value Submit reports on failure
+        uint64_t abort_submit(VkCommandBuffer command_buffer);
+
+        bool needs_ownership_transfer() const { return config_.transfer_queue_family != config_.graphics_queue_family; }
+    };
+}
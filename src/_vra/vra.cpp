@@ -139,6 +139,7 @@ namespace vra
                 if (padding_needed > 0)
                 {
                     batch.consolidated_data.insert(batch.consolidated_data.end(), padding_needed, (uint8_t)0); // Pad with zeros
+                    batch.padding_bytes += padding_needed;
                 }
 
                 batch.offsets[id] = aligned_offset_for_item; // Store the correctly aligned offset
@@ -208,6 +209,7 @@ namespace vra
                 if (padding_needed > 0)
                 {
                     batch.consolidated_data.insert(batch.consolidated_data.end(), padding_needed, (uint8_t)0); // Pad with zeros
+                    batch.padding_bytes += padding_needed;
                 }
 
                 batch.offsets[id] = aligned_offset_for_item; // Store the correctly aligned offset
@@ -232,13 +234,16 @@ namespace vra
             return false;
         }
 
-        // store buffer data
+        // store buffer data into the calling thread's list
         id = resource_id_generator_.GenerateID();
         VraDataHandle data_handle;
         data_handle.id = id;
         data_handle.data_desc = desc;
         data_handle.data = data;
-        data_handles_.push_back(data_handle);
+
+        auto &shard = get_collect_shard();
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.data_handles.push_back(data_handle);
 
         return true;
     }
@@ -246,6 +251,7 @@ namespace vra
     std::map<BatchId, VraDataBatcher::VraBatchHandle> VraDataBatcher::Batch()
     {
         ClearBatch();
+        merge_collect_shards();
 
         // Optional: Estimate sizes and reserve capacity
         for (const auto &data_handle : data_handles_)
@@ -315,6 +321,11 @@ namespace vra
 
     void VraDataBatcher::Clear()
     {
+        collect_shards_.ForEach([](VraCollectShard &shard)
+                                {
+                                    std::lock_guard<std::mutex> shard_lock(shard.mutex);
+                                    shard.data_handles.clear();
+                                });
         data_handles_.clear();
         ClearBatch();
     }
@@ -394,6 +405,29 @@ namespace vra
         }
     }
 
+    VraDataBatcher::VraCollectShard &VraDataBatcher::get_collect_shard()
+    {
+        return *collect_shards_.Get([] { return std::make_unique<VraCollectShard>(); });
+    }
+
+    void VraDataBatcher::merge_collect_shards()
+    {
+        size_t merged_begin = data_handles_.size();
+        collect_shards_.ForEach([this](VraCollectShard &shard)
+                                {
+                                    std::lock_guard<std::mutex> shard_lock(shard.mutex);
+                                    data_handles_.insert(data_handles_.end(), shard.data_handles.begin(), shard.data_handles.end());
+                                    shard.data_handles.clear();
+                                });
+        if (merged_begin == data_handles_.size())
+            return;
+
+        // ids are unique, so the order only depends on the order ids were generated in
+        auto by_id = [](const VraDataHandle &lhs, const VraDataHandle &rhs) { return lhs.id < rhs.id; };
+        std::sort(data_handles_.begin() + merged_begin, data_handles_.end(), by_id);
+        std::inplace_merge(data_handles_.begin(), data_handles_.begin() + merged_begin, data_handles_.end(), by_id);
+    }
+
     
 
     // -------------------------------------
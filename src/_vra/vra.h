@@ -1,6 +1,11 @@
 #pragma once
 
 #include "pool.h"
+#include "bindless.h"
+#include "defragmenter.h"
+#include "descriptor.h"
+#include "upload.h"
+#include "_templates/thread_slots.h"
 #include <vma/vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
 #include <vector>
@@ -16,6 +21,7 @@
 #include <iostream>
 #include <atomic>
 #include <memory>
+#include <mutex>
 
 namespace vra
 {
@@ -151,6 +157,7 @@ namespace vra
             std::vector<uint8_t> consolidated_data;
             std::unordered_map<ResourceId, size_t> offsets;
             VraDataDesc data_desc;
+            size_t padding_bytes = 0; // bytes inserted between items for offset alignment
 
             void Clear()
             {
@@ -158,6 +165,7 @@ namespace vra
                 consolidated_data.clear();
                 offsets.clear();
                 data_desc = VraDataDesc{};
+                padding_bytes = 0;
             }
         };
 
@@ -176,16 +184,19 @@ namespace vra
         /// @param data_desc Description of the buffer data (usage, memory pattern, etc.).
         /// @param data Raw data pointer and size. The pointer pData_ must remain valid until Execute is called.
         /// @return True if collected successfully, false if ID already exists or max count reached.
+        /// @note 1.thread safe, every thread appends to its own list, the lists are merged by Batch.
         bool Collect(VraDataDesc data_desc, VraRawData data, ResourceId& id);
 
         /// @brief processes all collected buffer data, grouping them by memory pattern
         /// @return a map of batch id and batch handle
-        /// @note 1.this function is not thread safe.
-        /// @note 2.batch result as a screenshot will be flushed and cleared after batching.
-        /// @note 3.collected data still remains, no need to collect again.
+        /// @note 1.this function is not thread safe, Collect calls racing with it may land in this batch or the next.
+        /// @note 2.data collected by different threads is merged in ResourceId order, the result is deterministic.
+        /// @note 3.batch result as a screenshot will be flushed and cleared after batching.
+        /// @note 4.collected data still remains, no need to collect again.
         std::map<BatchId, VraBatchHandle> Batch();
 
         /// @brief clear all collected data and grouped data
+        /// @note 1.this function is not thread safe.
         void Clear();
 
         // --- Batcher Registration ---
@@ -235,6 +246,13 @@ namespace vra
             VraRawData data;
         };
 
+        /// @brief VraCollectShard is the list of data collected by one thread, drained into data_handles_ by Batch.
+        struct VraCollectShard
+        {
+            std::mutex mutex; // only contended while Batch or Clear drains the shard
+            std::vector<VraDataHandle> data_handles;
+        };
+
         // --- Vulkan Native Objects Cache ---
         
         VkPhysicalDevice physical_device_handle_;
@@ -243,7 +261,11 @@ namespace vra
         // --- Buffer specific storage ---
 
         static constexpr size_t MAX_BUFFER_COUNT = 4096;
-        std::vector<VraDataHandle> data_handles_;
+        std::vector<VraDataHandle> data_handles_; // merged data, sorted by resource id
+
+        // --- Concurrent Collection ---
+
+        templates::ThreadSlots<VraCollectShard> collect_shards_;
 
         // --- Resource Id ---
         
@@ -258,39 +280,12 @@ namespace vra
 
         /// @brief register default grouping strategies
         void RegisterDefaultBatcher();
-    };
-
-    class VraDescriptorAllocator
-    {
-        VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
-        VkDevice device_ = VK_NULL_HANDLE;
 
-        // constructor
-        VraDescriptorAllocator(VkDevice device)
-            : device_(device)
-        {
-        }
+        /// @brief list of the calling thread, created on first use
+        VraCollectShard &get_collect_shard();
 
-        // --- Helper methods ---
-
-        // --- Descriptor methods ---
-        VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout)
-        {
-            VkDescriptorSetAllocateInfo alloc_info = {};
-            alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-            alloc_info.descriptorPool = descriptor_pool_;
-            alloc_info.descriptorSetCount = 1;
-            alloc_info.pSetLayouts = &layout;
-
-            VkDescriptorSet descriptor_set;
-            VkResult result = vkAllocateDescriptorSets(device_, &alloc_info, &descriptor_set);
-            if (result != VK_SUCCESS)
-            {
-                throw std::runtime_error("Failed to allocate descriptor set!");
-            }
-
-            return descriptor_set;
-        }
+        /// @brief move every thread's collected data into data_handles_ and restore resource id order
+        void merge_collect_shards();
     };
 
     class VRA
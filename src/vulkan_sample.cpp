@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <filesystem>
 #include <iostream>
 #include <thread>
 
@@ -47,6 +48,40 @@ void VulkanSample::GetVertexIndexData(std::vector<gltf::PerDrawCallData> per_dra
 void VulkanSample::GetMeshList(const std::vector<gltf::PerMeshData>& mesh_list)
 {
     mesh_list_ = mesh_list;
+
+    // flatten the primitives so the draw list can be partitioned across recording threads
+    draw_list_.clear();
+    draw_raster_states_.clear();
+    draw_mesh_indices_.clear();
+    mesh_residency_.clear();
+    mesh_residency_.resize(mesh_list_.size());
+    for (uint32_t mesh_index = 0; mesh_index < mesh_list_.size(); ++mesh_index)
+    {
+        auto& mesh_indices = mesh_residency_[mesh_index].indices;
+        for (const auto& primitive : mesh_list_[mesh_index].primitives)
+        {
+            if (static_cast<size_t>(primitive.first_index) + primitive.index_count > indices_.size())
+            {
+                Logger::LogError("Primitive of mesh " + mesh_list_[mesh_index].name + " indexes past the index data");
+                continue;
+            }
+
+            // each mesh gets its own index buffer, its primitives are packed back to back in it
+            auto first_index = static_cast<uint32_t>(mesh_indices.size());
+            mesh_indices.insert(mesh_indices.end(),
+                                indices_.begin() + primitive.first_index,
+                                indices_.begin() + primitive.first_index + primitive.index_count);
+
+            // material data is not loaded yet, every primitive uses the default raster state
+            draw_raster_states_.push_back(SVulkanRasterState{});
+            draw_mesh_indices_.push_back(mesh_index);
+            draw_list_.push_back({.indexCount    = primitive.index_count,
+                                  .instanceCount = 1,
+                                  .firstIndex    = first_index,
+                                  .vertexOffset  = 0,
+                                  .firstInstance = 0});
+        }
+    }
 }
 
 VulkanSample::~VulkanSample()
@@ -54,6 +89,13 @@ VulkanSample::~VulkanSample()
     // 等待设备空闲，确保没有正在进行的操作
     vkDeviceWaitIdle(comm_vk_logical_device_);
 
+    // stop recompiling before anything it reports to goes away
+    vk_shader_watcher_.reset();
+
+    // everything still waiting for deferred deletion is unused once the device is idle
+    vra_deletion_queue_.reset();
+    destroy_retired_swapchains(true);
+
     // 销毁深度资源
     if (depth_image_view_ != VK_NULL_HANDLE)
     {
@@ -74,21 +116,28 @@ VulkanSample::~VulkanSample()
     }
 
     // 销毁描述符相关资源
-    if (descriptor_pool_ != VK_NULL_HANDLE)
+    if (vra_descriptor_cache_ != nullptr)
     {
-        vkDestroyDescriptorPool(comm_vk_logical_device_, descriptor_pool_, nullptr);
-        descriptor_pool_ = VK_NULL_HANDLE;
+        auto statistics = vra_descriptor_cache_->GetStatistics();
+        Logger::LogInfo("Descriptor cache hit rate: " + std::to_string(statistics.GetHitRate()) + " (" +
+                        std::to_string(statistics.hits) + " hits, " + std::to_string(statistics.misses) + " misses, " +
+                        std::to_string(statistics.evictions) + " evictions)");
     }
+    vra_bindless_table_.reset();
+    vra_descriptor_cache_.reset();
+    vra_descriptor_allocator_.reset();
 
-    if (descriptor_set_layout_ != VK_NULL_HANDLE)
-    {
-        vkDestroyDescriptorSetLayout(comm_vk_logical_device_, descriptor_set_layout_, nullptr);
-        descriptor_set_layout_ = VK_NULL_HANDLE;
-    }
+    vk_set_layout_cache_.reset();
+    descriptor_set_layout_ = VK_NULL_HANDLE;
 
     
 
     // destroy vma relatives
+    vra_statistics_reporter_.reset();
+    vra_upload_manager_.reset();
+    uniform_mapped_batch_.reset();
+    vra_residency_manager_.reset();
+    vra_defragmenter_.reset();
     if (uniform_buffer_ != VK_NULL_HANDLE)
     {
         vmaDestroyBuffer(vma_allocator_, uniform_buffer_, uniform_buffer_allocation_);
@@ -99,10 +148,13 @@ VulkanSample::~VulkanSample()
         vmaDestroyBuffer(vma_allocator_, test_local_buffer_, test_local_buffer_allocation_);
         test_local_buffer_ = VK_NULL_HANDLE;
     }
-    if (test_staging_buffer_ != VK_NULL_HANDLE)
+    for (auto& mesh : mesh_residency_)
     {
-        vmaDestroyBuffer(vma_allocator_, test_staging_buffer_, test_staging_buffer_allocation_);
-        test_staging_buffer_ = VK_NULL_HANDLE;
+        if (mesh.index_buffer != VK_NULL_HANDLE)
+        {
+            vmaDestroyBuffer(vma_allocator_, mesh.index_buffer, mesh.allocation);
+            mesh.index_buffer = VK_NULL_HANDLE;
+        }
     }
     if (vma_allocator_ != VK_NULL_HANDLE)
     {
@@ -120,12 +172,12 @@ VulkanSample::~VulkanSample()
 
     // release unique pointer
 
-    vk_shader_helper_.reset();
+    vk_shader_library_.reset();
     vk_window_helper_.reset();
-    vk_renderpass_helper_.reset();
-    vk_pipeline_helper_.reset();
-    vk_frame_buffer_helper_.reset();
-    vk_command_buffer_helper_.reset();
+    vk_pipeline_library_.reset();
+    vk_pipeline_cache_.reset();
+    vk_parallel_recorder_.reset();
+    vk_command_allocator_.reset();
     vk_synchronization_helper_.reset();
 
     // destroy comm test data
@@ -188,7 +240,15 @@ void VulkanSample::initialize_vulkan()
         throw std::runtime_error("Failed to create Vulkan vra and vma objects.");
     }
 
-    create_drawcall_list_buffer();
+    if (!create_shaders())
+    {
+        throw std::runtime_error("Failed to create Vulkan shaders.");
+    }
+
+    if (!create_drawcall_list_buffer())
+    {
+        throw std::runtime_error("Failed to create Vulkan drawcall list buffer.");
+    }
 
     if (!create_uniform_buffers())
     {
@@ -205,9 +265,9 @@ void VulkanSample::initialize_vulkan()
         throw std::runtime_error("Failed to create Vulkan pipeline.");
     }
 
-    if (!create_frame_buffer())
+    if (!create_depth_resources())
     {
-        throw std::runtime_error("Failed to create Vulkan frame buffer.");
+        throw std::runtime_error("Failed to create depth resources.");
     }
 
     if (!create_command_pool())
@@ -215,11 +275,6 @@ void VulkanSample::initialize_vulkan()
         throw std::runtime_error("Failed to create Vulkan command pool.");
     }
 
-    if (!allocate_per_frame_command_buffer())
-    {
-        throw std::runtime_error("Failed to allocate Vulkan command buffer.");
-    }
-
     if (!create_synchronization_objects())
     {
         throw std::runtime_error("Failed to create Vulkan synchronization objects.");
@@ -264,6 +319,10 @@ void VulkanSample::Run()
 
     Uint64 last_time = SDL_GetTicks();
     float delta_time = 0.0F;
+    last_draw_time_  = std::chrono::steady_clock::now();
+
+    // the event loop stalls while the window is dragged on some platforms, exposed frames are drawn from the watch then
+    SDL_AddEventWatch(live_resize_event_watch, this);
 
     // main loop
     while (engine_state_ != EWindowState::kStopped)
@@ -300,8 +359,9 @@ void VulkanSample::Run()
         // process keyboard input to update camera
         process_keyboard_input(delta_time);
 
-        // do not draw if we are minimized
-        if (render_state_ == ERenderState::kFalse)
+        // do not draw if we are minimized, unless the window was exposed and needs its contents back
+        bool redraw = redraw_request_.exchange(false);
+        if (render_state_ == ERenderState::kFalse && !redraw)
         {
             // throttle the speed to avoid the endless spinning
             constexpr auto kSleepDurationMs = 100;
@@ -309,17 +369,10 @@ void VulkanSample::Run()
             continue;
         }
 
-        if (resize_request_)
-        {
-            resize_swapchain();
-        }
-
-        // update the view matrix
-        update_uniform_buffer(frame_index_);
-
         // render a frame
         Draw();
     }
+    SDL_RemoveEventWatch(live_resize_event_watch, this);
 
     // wait until the GPU is completely idle before cleaning up
     vkDeviceWaitIdle(comm_vk_logical_device_);
@@ -342,6 +395,12 @@ void VulkanSample::process_input(SDL_Event& event)
             Logger::LogInfo(camera_.focus_constraint_enabled_ ? "Focus constraint enabled"
                                                               : "Focus constraint disabled");
         }
+        // Dump a memory statistics snapshot with 'M' key
+        if (event.key.key == SDLK_M)
+        {
+            if (vra_statistics_reporter_->Dump(frame_serial_))
+                Logger::LogInfo("Memory statistics dumped for frame " + std::to_string(frame_serial_));
+        }
     }
 
     // mouse button down event
@@ -616,7 +675,16 @@ void VulkanSample::process_mouse_scroll(float yoffset)
 // Main render loop
 void VulkanSample::Draw()
 {
+    drawing_ = true;
+    track_frame_time();
+
+    if (resize_request_)
+    {
+        resize_swapchain();
+    }
+    reload_shaders();
     draw_frame();
+    drawing_ = false;
 }
 
 // -------------------------------------
@@ -628,12 +696,7 @@ void VulkanSample::generate_frame_structs()
     output_frames_.resize(engine_config_.frame_count);
     for (int i = 0; i < engine_config_.frame_count; ++i)
     {
-        output_frames_[i].image_index                  = i;
-        output_frames_[i].queue_id                     = "graphic_queue";
-        output_frames_[i].command_buffer_id            = "graphic_command_buffer_" + std::to_string(i);
-        output_frames_[i].image_available_semaphore_id = "image_available_semaphore_" + std::to_string(i);
-        output_frames_[i].render_finished_semaphore_id = "render_finished_semaphore_" + std::to_string(i);
-        output_frames_[i].fence_id                     = "in_flight_fence_" + std::to_string(i);
+        output_frames_[i].image_index = i;
     }
 }
 
@@ -669,12 +732,28 @@ bool VulkanSample::create_surface()
 bool VulkanSample::create_physical_device()
 {
     // vulkan 1.3 features - 用于检查硬件支持
+    VkPhysicalDeviceVulkan12Features features_12{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    // descriptor indexing for the bindless resource table
+    features_12.descriptorIndexing                           = VK_TRUE;
+    features_12.runtimeDescriptorArray                       = VK_TRUE;
+    features_12.descriptorBindingPartiallyBound              = VK_TRUE;
+    features_12.descriptorBindingUpdateUnusedWhilePending    = VK_TRUE;
+    features_12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features_12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features_12.shaderSampledImageArrayNonUniformIndexing    = VK_TRUE;
+    features_12.shaderStorageBufferArrayNonUniformIndexing   = VK_TRUE;
+    // timeline semaphore for the upload manager
+    features_12.timelineSemaphore = VK_TRUE;
+
     VkPhysicalDeviceVulkan13Features features_13{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
     features_13.synchronization2 = VK_TRUE;
+    // render pass and framebuffer free rendering
+    features_13.dynamicRendering = VK_TRUE;
 
     auto physical_device_chain = common::physicaldevice::create_physical_device_context(comm_vk_instance_) |
                                  common::physicaldevice::set_surface(vk_window_helper_->GetSurface()) |
                                  common::physicaldevice::require_api_version(1, 3, 0) |
+                                 common::physicaldevice::require_features_12(features_12) |
                                  common::physicaldevice::require_features_13(features_13) |
                                  common::physicaldevice::require_queue(VK_QUEUE_GRAPHICS_BIT, 1, true) |
                                  common::physicaldevice::prefer_discrete_gpu() |
@@ -697,8 +776,40 @@ bool VulkanSample::create_physical_device()
 
 bool VulkanSample::create_logical_device()
 {
+    // optional extensions, each one is only enabled when the device reports its feature
+    // graphics pipeline library links pipeline variants from prebuilt parts, monolithic compiles without it
+    // vertex input and blend enable dynamic state let one pipeline cover more materials
+    query_optional_device_features();
+    std::vector<const char*> optional_extensions;
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipeline_library_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT};
+    pipeline_library_features.graphicsPipelineLibrary = VK_TRUE;
+    if (graphics_pipeline_library_supported_)
+    {
+        optional_extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        optional_extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    }
+    VkPhysicalDeviceVertexInputDynamicStateFeaturesEXT vertex_input_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VERTEX_INPUT_DYNAMIC_STATE_FEATURES_EXT};
+    vertex_input_features.vertexInputDynamicState = VK_TRUE;
+    if (dynamic_state_config_.vertex_input)
+    {
+        optional_extensions.push_back(VK_EXT_VERTEX_INPUT_DYNAMIC_STATE_EXTENSION_NAME);
+    }
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamic_state_3_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT};
+    dynamic_state_3_features.extendedDynamicState3ColorBlendEnable = VK_TRUE;
+    if (dynamic_state_config_.color_blend_enable)
+    {
+        optional_extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+    }
+
     auto device_chain = common::logicaldevice::create_logical_device_context(comm_vk_physical_device_context_) |
                         common::logicaldevice::require_extensions({VK_KHR_SWAPCHAIN_EXTENSION_NAME}) |
+                        common::logicaldevice::require_extensions(optional_extensions) |
+                        common::logicaldevice::add_p_next(graphics_pipeline_library_supported_ ? &pipeline_library_features : nullptr) |
+                        common::logicaldevice::add_p_next(dynamic_state_config_.vertex_input ? &vertex_input_features : nullptr) |
+                        common::logicaldevice::add_p_next(dynamic_state_config_.color_blend_enable ? &dynamic_state_3_features : nullptr) |
                         common::logicaldevice::add_graphics_queue("main_graphics", vk_window_helper_->GetSurface()) |
                         common::logicaldevice::add_transfer_queue("upload") |
                         common::logicaldevice::validate_device_configuration() |
@@ -715,10 +826,60 @@ bool VulkanSample::create_logical_device()
     comm_vk_logical_device_         = comm_vk_logical_device_context_.vk_logical_device_;
     comm_vk_graphics_queue_ = common::logicaldevice::get_queue(comm_vk_logical_device_context_, "main_graphics");
     comm_vk_transfer_queue_ = common::logicaldevice::get_queue(comm_vk_logical_device_context_, "upload");
+    dynamic_state_functions_ = SVulkanDynamicStateFunctions::Load(comm_vk_logical_device_, dynamic_state_config_);
     std::cout << "Successfully created Vulkan logical device." << '\n';
     return true;
 }
 
+void VulkanSample::query_optional_device_features()
+{
+    uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(comm_vk_physical_device_, nullptr, &extension_count, nullptr);
+    std::vector<VkExtensionProperties> extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(comm_vk_physical_device_, nullptr, &extension_count, extensions.data());
+
+    auto has_extension = [&extensions](const char* name)
+    {
+        return std::ranges::any_of(extensions,
+                                   [name](const VkExtensionProperties& extension)
+                                   { return std::string_view(name) == extension.extensionName; });
+    };
+
+    // feature structs are only chained for extensions the device has
+    VkPhysicalDeviceFeatures2 features2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipeline_library_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT};
+    VkPhysicalDeviceVertexInputDynamicStateFeaturesEXT vertex_input_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VERTEX_INPUT_DYNAMIC_STATE_FEATURES_EXT};
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamic_state_3_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT};
+    bool has_pipeline_library =
+        has_extension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) && has_extension(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    bool has_vertex_input    = has_extension(VK_EXT_VERTEX_INPUT_DYNAMIC_STATE_EXTENSION_NAME);
+    bool has_dynamic_state_3 = has_extension(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+    if (has_pipeline_library)
+    {
+        pipeline_library_features.pNext = features2.pNext;
+        features2.pNext                  = &pipeline_library_features;
+    }
+    if (has_vertex_input)
+    {
+        vertex_input_features.pNext = features2.pNext;
+        features2.pNext             = &vertex_input_features;
+    }
+    if (has_dynamic_state_3)
+    {
+        dynamic_state_3_features.pNext = features2.pNext;
+        features2.pNext                = &dynamic_state_3_features;
+    }
+    vkGetPhysicalDeviceFeatures2(comm_vk_physical_device_, &features2);
+
+    graphics_pipeline_library_supported_ = has_pipeline_library && pipeline_library_features.graphicsPipelineLibrary == VK_TRUE;
+    dynamic_state_config_.vertex_input   = has_vertex_input && vertex_input_features.vertexInputDynamicState == VK_TRUE;
+    dynamic_state_config_.color_blend_enable =
+        has_dynamic_state_3 && dynamic_state_3_features.extendedDynamicState3ColorBlendEnable == VK_TRUE;
+}
+
 bool VulkanSample::create_swapchain()
 {
     // create swapchain
@@ -728,6 +889,7 @@ bool VulkanSample::create_swapchain()
         common::swapchain::set_surface_format(VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) |
         common::swapchain::set_present_mode(VK_PRESENT_MODE_FIFO_KHR) | 
         common::swapchain::set_image_count(2, 3) |
+        common::swapchain::set_old_swapchain(comm_vk_swapchain_) |
         common::swapchain::set_desired_extent(static_cast<uint32_t>(engine_config_.window_config.width),
                                               static_cast<uint32_t>(engine_config_.window_config.height)) |
         common::swapchain::query_surface_support() | 
@@ -767,8 +929,6 @@ bool VulkanSample::create_swapchain()
 
 bool VulkanSample::create_command_pool()
 {
-    vk_command_buffer_helper_ = std::make_unique<VulkanCommandBufferHelper>();
-
     auto queue_family_index =
         common::logicaldevice::find_optimal_queue_family(comm_vk_logical_device_context_, VK_QUEUE_GRAPHICS_BIT);
     if (!queue_family_index.has_value())
@@ -776,7 +936,17 @@ bool VulkanSample::create_command_pool()
         std::cerr << "Failed to find any suitable graphics queue family." << '\n';
         return false;
     }
-    return vk_command_buffer_helper_->CreateCommandPool(comm_vk_logical_device_, queue_family_index.value());
+
+    // one transient pool per thread and frame slot, reset as a whole instead of per command buffer
+    vk_command_allocator_ = std::make_unique<VulkanCommandAllocator>(
+        comm_vk_logical_device_,
+        SVulkanCommandAllocatorConfig{.queue_family_index = queue_family_index.value(),
+                                      .frame_count        = engine_config_.frame_count});
+
+    // worker threads record large draw lists into secondaries allocated from their own pools
+    vk_parallel_recorder_ = std::make_unique<VulkanParallelRecorder>(*vk_command_allocator_,
+                                                                     SVulkanParallelRecorderConfig{.thread_count = 0});
+    return vk_parallel_recorder_->Initialize();
 }
 
 bool VulkanSample::create_uniform_buffers()
@@ -806,85 +976,79 @@ bool VulkanSample::create_uniform_buffers()
     allocation_create_info.usage                   = VMA_MEMORY_USAGE_AUTO;
     allocation_create_info.flags = vra_data_batcher_->GetSuggestVmaMemoryFlags(vra::VraDataMemoryPattern::CPU_GPU,
                                                                                vra::VraDataUpdateRate::Frequent);
-    allocation_create_info.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    return Logger::LogWithVkResult(vmaCreateBuffer(vma_allocator_,
-                                                   &uniform_buffer_create_info,
-                                                   &allocation_create_info,
-                                                   &uniform_buffer_,
-                                                   &uniform_buffer_allocation_,
-                                                   &uniform_buffer_allocation_info_),
-                                   "Failed to create uniform buffer",
-                                   "Succeeded in creating uniform buffer");
+    allocation_create_info.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT; // non-coherent memory is flushed by the mapped batch
+    if (!Logger::LogWithVkResult(vmaCreateBuffer(vma_allocator_,
+                                                 &uniform_buffer_create_info,
+                                                 &allocation_create_info,
+                                                 &uniform_buffer_,
+                                                 &uniform_buffer_allocation_,
+                                                 &uniform_buffer_allocation_info_),
+                                 "Failed to create uniform buffer",
+                                 "Succeeded in creating uniform buffer"))
+    {
+        return false;
+    }
+
+    vra_statistics_reporter_->TrackBatch(vra::VraBuiltInBatchIds::CPU_GPU_Frequently,
+                                         uniform_batch_handle_[vra::VraBuiltInBatchIds::CPU_GPU_Frequently],
+                                         uniform_buffer_allocation_info_.size);
+
+    // mapped once for the lifetime of the buffer
+    uniform_mapped_batch_ = std::make_unique<vra::VraMappedBatch>(
+        vma_allocator_, uniform_buffer_allocation_, uniform_batch_handle_[vra::VraBuiltInBatchIds::CPU_GPU_Frequently]);
+    return uniform_mapped_batch_->GetMappedData() != nullptr;
 }
 
 bool VulkanSample::create_and_write_descriptor_relatives()
 {
-    // create descriptor pool
+    // create descriptor allocator, pools grow on demand and per-frame pools are reset with their frame
     VkDescriptorType dynamic_uniform_buffer_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 
-    VkDescriptorPoolSize pool_size{};
-    pool_size.type            = dynamic_uniform_buffer_type;
-    pool_size.descriptorCount = 1;
-
-    VkDescriptorPoolCreateInfo pool_info{};
-    pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    pool_info.poolSizeCount = 1;
-    pool_info.pPoolSizes    = &pool_size;
-    pool_info.maxSets       = 1;
+    vra::VraDescriptorAllocatorConfig descriptor_allocator_config{};
+    descriptor_allocator_config.frame_count = engine_config_.frame_count;
+    vra_descriptor_allocator_ =
+        std::make_unique<vra::VraDescriptorAllocator>(comm_vk_logical_device_, descriptor_allocator_config);
+    vra_descriptor_cache_ = std::make_unique<vra::VraDescriptorCache>(comm_vk_logical_device_, *vra_descriptor_allocator_);
 
-    if (!Logger::LogWithVkResult(vkCreateDescriptorPool(comm_vk_logical_device_, &pool_info, nullptr, &descriptor_pool_),
-                                 "Failed to create descriptor pool",
-                                 "Succeeded in creating descriptor pool"))
+    // create bindless resource table, bound as set 1 next to the per-draw set
+    vra_bindless_table_ = std::make_unique<vra::VraBindlessTable>(comm_vk_logical_device_, comm_vk_physical_device_);
+    if (!vra_bindless_table_->Create())
+    {
+        Logger::LogError("Failed to create bindless resource table");
         return false;
+    }
 
-    // create descriptor set layout
-
-    VkDescriptorSetLayoutBinding layout_binding{};
-    layout_binding.binding         = 0;
-    layout_binding.descriptorType  = dynamic_uniform_buffer_type;
-    layout_binding.descriptorCount = 1;
-    layout_binding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
-
-    VkDescriptorSetLayoutCreateInfo layout_info{};
-    layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layout_info.bindingCount = 1;
-    layout_info.pBindings    = &layout_binding;
-
-    if (!Logger::LogWithVkResult(
-            vkCreateDescriptorSetLayout(comm_vk_logical_device_, &layout_info, nullptr, &descriptor_set_layout_),
-            "Failed to create descriptor set layout",
-            "Succeeded in creating descriptor set layout"))
+    // create descriptor set layout from the shaders, uniform buffers are bound with dynamic offsets
+    // set 1 is the bindless table, its layout comes from the table itself
+    std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> set_layouts;
+    if (!VulkanShaderReflection::MergeSetLayouts({vertex_shader_reflection_, fragment_shader_reflection_},
+                                                 set_layouts,
+                                                 SVulkanSetLayoutOptions{.dynamic_uniform_buffers = true}))
         return false;
 
-    // allocate descriptor set
-
-    VkDescriptorSetAllocateInfo alloc_info{};
-    alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    alloc_info.descriptorPool     = descriptor_pool_;
-    alloc_info.descriptorSetCount = 1;
-    alloc_info.pSetLayouts        = &descriptor_set_layout_;
-
-    if (!Logger::LogWithVkResult(vkAllocateDescriptorSets(comm_vk_logical_device_, &alloc_info, &descriptor_set_),
-                                 "Failed to allocate descriptor set",
-                                 "Succeeded in allocating descriptor set"))
+    vk_set_layout_cache_   = std::make_unique<VulkanDescriptorSetLayoutCache>(comm_vk_logical_device_);
+    descriptor_set_layout_ = vk_set_layout_cache_->GetOrCreate(set_layouts[0]);
+    if (descriptor_set_layout_ == VK_NULL_HANDLE)
         return false;
 
-    // write descriptor set
-    VkDescriptorBufferInfo buffer_info{};
-    buffer_info.buffer = uniform_buffer_;
-    buffer_info.offset = 0;
-    buffer_info.range  = sizeof(SMvpMatrix);
+    // the uniform block the shader declares has to match the host side struct
+    if (!check_uniform_block(*vertex_shader_reflection_))
+        return false;
 
-    VkWriteDescriptorSet descriptor_write{};
-    descriptor_write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptor_write.dstSet          = descriptor_set_;
-    descriptor_write.dstBinding      = 0;
-    descriptor_write.dstArrayElement = 0;
-    descriptor_write.descriptorType  = dynamic_uniform_buffer_type;
-    descriptor_write.descriptorCount = 1;
-    descriptor_write.pBufferInfo     = &buffer_info;
+    // allocate and write descriptor set through the cache, identical bindings share one set
+    vra::VraDescriptorBinding uniform_binding{};
+    uniform_binding.binding            = 0;
+    uniform_binding.type               = dynamic_uniform_buffer_type;
+    uniform_binding.info.buffer.buffer = uniform_buffer_;
+    uniform_binding.info.buffer.offset = 0;
+    uniform_binding.info.buffer.range  = sizeof(SMvpMatrix);
+    descriptor_bindings_               = {uniform_binding};
 
-    vkUpdateDescriptorSets(comm_vk_logical_device_, 1, &descriptor_write, 0, nullptr);
+    if (!vra_descriptor_cache_->GetOrCreate(descriptor_set_layout_, descriptor_bindings_, descriptor_set_, frame_serial_))
+    {
+        Logger::LogError("Failed to allocate descriptor set");
+        return false;
+    }
 
     return true;
 }
@@ -894,6 +1058,9 @@ bool VulkanSample::create_vma_vra_objects()
     // vra and vma members
     vra_data_batcher_ = std::make_unique<vra::VraDataBatcher>(comm_vk_physical_device_);
 
+    // objects released while frames are in flight are destroyed once the frame timeline passes them
+    vra_deletion_queue_ = std::make_unique<vra::VraDeletionQueue>();
+
     VmaAllocatorCreateInfo allocator_create_info = {};
     allocator_create_info.flags                  = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
     allocator_create_info.vulkanApiVersion       = VK_API_VERSION_1_3;
@@ -901,9 +1068,52 @@ bool VulkanSample::create_vma_vra_objects()
     allocator_create_info.device                 = comm_vk_logical_device_;
     allocator_create_info.instance               = comm_vk_instance_;
 
-    return Logger::LogWithVkResult(vmaCreateAllocator(&allocator_create_info, &vma_allocator_),
-                                   "Failed to create Vulkan vra and vma objects",
-                                   "Succeeded in creating Vulkan vra and vma objects");
+    if (!Logger::LogWithVkResult(vmaCreateAllocator(&allocator_create_info, &vma_allocator_),
+                                 "Failed to create Vulkan vra and vma objects",
+                                 "Succeeded in creating Vulkan vra and vma objects"))
+    {
+        return false;
+    }
+
+    // online defragmentation, copies are recorded into the frame command buffers
+    vra_defragmenter_ = std::make_unique<vra::VraDefragmenter>(comm_vk_logical_device_, vma_allocator_);
+    vra_defragmenter_->SetReportCallback(
+        [](const vra::VraDefragmentationReport& report)
+        {
+            Logger::LogInfo("Defragmentation finished: fragmentation " + std::to_string(report.fragmentation_before) +
+                            " -> " + std::to_string(report.fragmentation_after) + ", " +
+                            std::to_string(report.stats.bytesMoved) + " bytes moved, " +
+                            std::to_string(report.stats.bytesFreed) + " bytes freed, " +
+                            std::to_string(report.stats.allocationsMoved) + " allocations moved in " +
+                            std::to_string(report.passes) + " passes");
+        });
+
+    // budget driven residency, idle resources are evicted before allocations start failing
+    vra_residency_manager_ = std::make_unique<vra::VraResidencyManager>(vma_allocator_);
+
+    // memory statistics, dumped on demand with the M key
+    vra_statistics_reporter_ = std::make_unique<vra::VraStatisticsReporter>(vma_allocator_);
+
+    // uploads run on the transfer queue, ownership moves to the graphics family afterwards
+    auto transfer_queue_family = common::logicaldevice::find_queue_family_by_name(comm_vk_logical_device_context_, "upload");
+    auto graphics_queue_family =
+        common::logicaldevice::find_queue_family_by_name(comm_vk_logical_device_context_, "main_graphics");
+    if (!transfer_queue_family.has_value() || !graphics_queue_family.has_value())
+    {
+        Logger::LogError("Failed to find queue families for the upload manager");
+        return false;
+    }
+    vra::VraUploadManagerConfig upload_config{};
+    upload_config.transfer_queue        = comm_vk_transfer_queue_;
+    upload_config.transfer_queue_family = transfer_queue_family.value();
+    upload_config.graphics_queue_family = graphics_queue_family.value();
+    vra_upload_manager_ = std::make_unique<vra::VraUploadManager>(comm_vk_logical_device_, vma_allocator_, upload_config);
+    if (!vra_upload_manager_->Create())
+    {
+        Logger::LogError("Failed to create upload manager");
+        return false;
+    }
+    return true;
 }
 
 // 查找支持的深度格式
@@ -1018,110 +1228,136 @@ bool VulkanSample::create_depth_resources()
     return true;
 }
 
-bool VulkanSample::create_frame_buffer()
+bool VulkanSample::create_shaders()
 {
-    // 创建深度资源
-    if (!create_depth_resources())
+    // every shader the sample uses is read in one batch, modules are keyed by their code so duplicates share one
+    vk_shader_library_ = std::make_unique<VulkanShaderLibrary>(comm_vk_logical_device_);
+
+    std::filesystem::path shader_directory =
+        std::filesystem::path(engine_config_.general_config.working_directory) / "src" / "shader";
+    vertex_shader_path_              = shader_directory / "gltf.vert.spv";
+    fragment_shader_path_            = shader_directory / "gltf.frag.spv";
+    std::string vertex_shader_path   = vertex_shader_path_.string();
+    std::string fragment_shader_path = fragment_shader_path_.string();
+    std::vector<SVulkanShaderConfig> configs = {
+        {.shader_type = EShaderType::kVertexShader, .shader_path = vertex_shader_path.c_str()},
+        {.shader_type = EShaderType::kFragmentShader, .shader_path = fragment_shader_path.c_str()}};
+
+    std::vector<uint64_t> keys;
+    if (!vk_shader_library_->LoadShaders(configs, keys))
     {
-        throw std::runtime_error("Failed to create depth resources.");
+        return false;
     }
+    vertex_shader_key_   = keys[0];
+    fragment_shader_key_ = keys[1];
 
-    // 创建帧缓冲
-    SVulkanFrameBufferConfig framebuffer_config(
-        comm_vk_swapchain_context_.swapchain_info_.extent_, 
-        comm_vk_swapchain_context_.swapchain_image_views_, 
-        depth_image_view_);
-
-    vk_frame_buffer_helper_ = std::make_unique<VulkanFrameBufferHelper>(comm_vk_logical_device_, framebuffer_config);
+    // descriptor and vertex input layouts are derived from the modules instead of written by hand
+    vertex_shader_reflection_   = vk_shader_library_->GetReflection(vertex_shader_key_);
+    fragment_shader_reflection_ = vk_shader_library_->GetReflection(fragment_shader_key_);
 
-    return vk_frame_buffer_helper_->CreateFrameBuffer(vk_renderpass_helper_->GetRenderpass());
+    // edited GLSL is recompiled and swapped in while running, the app works without it
+    vk_shader_watcher_ = std::make_unique<VulkanShaderWatcher>(SVulkanShaderWatcherConfig{.shader_directory = shader_directory.string()});
+    if (!vk_shader_watcher_->Start())
+    {
+        Logger::LogWarning("Shader hot reload disabled");
+        vk_shader_watcher_.reset();
+    }
+    return true;
 }
 
 bool VulkanSample::create_pipeline()
 {
-    // create shader
-    vk_shader_helper_ = std::make_unique<VulkanShaderHelper>(comm_vk_logical_device_);
+    // dynamic rendering, the pipeline only knows the attachment formats
+    depth_format_ = find_supported_depth_format();
 
-    std::vector<SVulkanShaderConfig> configs;
-    std::string shader_path = engine_config_.general_config.working_directory + "src\\shader\\";
-    // std::string vertex_shader_path = shader_path + "triangle.vert.spv";
-    // std::string fragment_shader_path = shader_path + "triangle.frag.spv";
-    std::string vertex_shader_path   = shader_path + "gltf.vert.spv";
-    std::string fragment_shader_path = shader_path + "gltf.frag.spv";
-    configs.push_back({.shader_type = EShaderType::kVertexShader, .shader_path = vertex_shader_path.c_str()});
-    configs.push_back({.shader_type = EShaderType::kFragmentShader, .shader_path = fragment_shader_path.c_str()});
+    SVulkanPipelineConfig pipeline_config =
+        make_pipeline_config(vertex_shader_key_, fragment_shader_key_, test_vertex_input_attributes_);
 
-    for (const auto& config : configs)
+    // pipelines compiled by earlier launches are reused from the on-disk cache
+    auto cache_path    = std::filesystem::path(engine_config_.general_config.working_directory) / "pipeline_cache.bin";
+    vk_pipeline_cache_ = std::make_unique<VulkanPipelineCache>(
+        comm_vk_logical_device_,
+        comm_vk_physical_device_,
+        SVulkanPipelineCacheConfig{.cache_path = cache_path.string(), .save_interval_frames = 1800});
+    if (!vk_pipeline_cache_->Initialize())
     {
-        std::vector<uint32_t> shader_code;
-        if (!vk_shader_helper_->ReadShaderCode(config.shader_path, shader_code))
-        {
-            Logger::LogError("Failed to read shader code from " + std::string(config.shader_path));
-            return false;
-        }
+        return false;
+    }
 
-        if (!vk_shader_helper_->CreateShaderModule(comm_vk_logical_device_, shader_code, config.shader_type))
-        {
-            Logger::LogError("Failed to create shader module for " + std::string(config.shader_path));
-            return false;
-        }
+    // variants compile on a worker thread, or link from library parts, the fallback is drawn with until they are ready
+    vk_pipeline_library_ = std::make_unique<VulkanPipelineLibrary>(
+        comm_vk_logical_device_,
+        vk_pipeline_cache_->GetPipelineCache(),
+        SVulkanPipelineLibraryConfig{.thread_count                  = 1,
+                                     .use_graphics_pipeline_library = graphics_pipeline_library_supported_});
+    if (!vk_pipeline_library_->Initialize())
+    {
+        return false;
     }
 
-    // create renderpass
-    SVulkanRenderpassConfig renderpass_config{};
-    renderpass_config.color_format = comm_vk_swapchain_context_.swapchain_info_.surface_format_.format;
-    renderpass_config.depth_format = VK_FORMAT_D32_SFLOAT;  // TODO: Make configurable
-    renderpass_config.sample_count = VK_SAMPLE_COUNT_1_BIT; // TODO: Make configurable
-    vk_renderpass_helper_            = std::make_unique<VulkanRenderpassHelper>(renderpass_config);
-    if (!vk_renderpass_helper_->CreateRenderpass(comm_vk_logical_device_))
+    auto start_time = std::chrono::steady_clock::now();
+    pipeline_key_   = vk_pipeline_library_->SetFallback(pipeline_config);
+    if (pipeline_key_ == VulkanPipelineLibrary::INVALID_KEY)
     {
         return false;
     }
+    auto creation_time_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    Logger::LogInfo("Pipeline creation took " + std::to_string(creation_time_ms) + " ms with a " +
+                    (vk_pipeline_cache_->IsWarm() ? "warm" : "cold") + " pipeline cache");
+    return true;
+}
 
-    // create pipeline
+SVulkanPipelineConfig VulkanSample::make_pipeline_config(uint64_t vertex_shader_key,
+                                                       uint64_t fragment_shader_key,
+                                                       const std::vector<VkVertexInputAttributeDescription>& vertex_attributes) const
+{
     SVulkanPipelineConfig pipeline_config;
     pipeline_config.swap_chain_extent = comm_vk_swapchain_context_.swapchain_info_.extent_;
     pipeline_config.shader_module_map = {
-        {EShaderType::kVertexShader, vk_shader_helper_->GetShaderModule(EShaderType::kVertexShader)},
-        {EShaderType::kFragmentShader, vk_shader_helper_->GetShaderModule(EShaderType::kFragmentShader)}};
-    pipeline_config.renderpass = vk_renderpass_helper_->GetRenderpass();
+        {EShaderType::kVertexShader, vk_shader_library_->GetModule(vertex_shader_key)},
+        {EShaderType::kFragmentShader, vk_shader_library_->GetModule(fragment_shader_key)}};
+    // feature branches are compiled out per variant, a shader only receives the constants it declares
+    const std::map<std::string, uint32_t> shader_features = {{"use_vertex_color", VK_FALSE}, {"alpha_mask", VK_FALSE}};
+    pipeline_config.specialization_constants = {
+        {EShaderType::kVertexShader, vk_shader_library_->Specialize(vertex_shader_key, shader_features)},
+        {EShaderType::kFragmentShader, vk_shader_library_->Specialize(fragment_shader_key, shader_features)}};
+    pipeline_config.color_attachment_formats = {comm_vk_swapchain_context_.swapchain_info_.surface_format_.format};
+    pipeline_config.depth_attachment_format  = depth_format_;
     // pipeline_config.vertex_input_binding_description =
     // vertex_input_binding_description_;
     // pipeline_config.vertex_input_attribute_descriptions =
     // {vertex_input_attribute_position_, vertex_input_attribute_color_};
     pipeline_config.vertex_input_binding_description    = test_vertex_input_binding_description_;
-    pipeline_config.vertex_input_attribute_descriptions = test_vertex_input_attributes_;
+    pipeline_config.vertex_input_attribute_descriptions = vertex_attributes;
     pipeline_config.descriptor_set_layouts.push_back(descriptor_set_layout_);
-    vk_pipeline_helper_ = std::make_unique<VulkanPipelineHelper>(pipeline_config);
-    return vk_pipeline_helper_->CreatePipeline(comm_vk_logical_device_);
-}
-
-bool VulkanSample::allocate_per_frame_command_buffer()
-{
-    for (int i = 0; i < engine_config_.frame_count; ++i)
-    {
-        if (!vk_command_buffer_helper_->AllocateCommandBuffer(
-                {.command_buffer_level = VK_COMMAND_BUFFER_LEVEL_PRIMARY, .command_buffer_count = 1},
-                output_frames_[i].command_buffer_id))
-        {
-            Logger::LogError("Failed to allocate command buffer for frame " + std::to_string(i));
-            return false;
-        }
-    }
-    return true;
+    pipeline_config.descriptor_set_layouts.push_back(vra_bindless_table_->GetDescriptorSetLayout());
+    pipeline_config.push_constant_ranges = VulkanShaderReflection::MergePushConstantRanges(
+        {vk_shader_library_->GetReflection(vertex_shader_key), vk_shader_library_->GetReflection(fragment_shader_key)});
+    // raster state per material is set while recording, the vertex layout and blend enable too where supported
+    pipeline_config.dynamic_raster_state = true;
+    pipeline_config.dynamic_vertex_input = dynamic_state_config_.vertex_input;
+    pipeline_config.dynamic_blend_enable = dynamic_state_config_.color_blend_enable;
+    return pipeline_config;
 }
 
 bool VulkanSample::create_synchronization_objects()
 {
     vk_synchronization_helper_ = std::make_unique<VulkanSynchronizationHelper>(comm_vk_logical_device_);
-    // create synchronization objects
+
+    // frame pacing, every graphics submit signals its frame serial
+    frame_timeline_semaphore_ = vk_synchronization_helper_->CreateTimelineSemaphore(0, "frame_timeline_semaphore");
+    if (!frame_timeline_semaphore_.IsValid())
+        return false;
+
+    // binary semaphores are still required by acquire and present
     for (int i = 0; i < engine_config_.frame_count; ++i)
     {
-        if (!vk_synchronization_helper_->CreateVkSemaphore(output_frames_[i].image_available_semaphore_id))
-            return false;
-        if (!vk_synchronization_helper_->CreateVkSemaphore(output_frames_[i].render_finished_semaphore_id))
-            return false;
-        if (!vk_synchronization_helper_->CreateFence(output_frames_[i].fence_id))
+        auto& frame = output_frames_[i];
+        frame.image_available_semaphore =
+            vk_synchronization_helper_->CreateVkSemaphore("image_available_semaphore_" + std::to_string(i));
+        frame.render_finished_semaphore =
+            vk_synchronization_helper_->CreateVkSemaphore("render_finished_semaphore_" + std::to_string(i));
+        if (!frame.image_available_semaphore.IsValid() || !frame.render_finished_semaphore.IsValid())
             return false;
     }
     return true;
@@ -1134,20 +1370,17 @@ bool VulkanSample::create_synchronization_objects()
 void VulkanSample::draw_frame()
 {
     // get current resource
-    auto current_fence_id                     = output_frames_[frame_index_].fence_id;
-    auto current_image_available_semaphore_id = output_frames_[frame_index_].image_available_semaphore_id;
-    auto current_render_finished_semaphore_id = output_frames_[frame_index_].render_finished_semaphore_id;
-    auto current_command_buffer_id            = output_frames_[frame_index_].command_buffer_id;
-    auto current_queue_id                     = output_frames_[frame_index_].queue_id;
-
-    // wait for last frame to finish
-    if (!vk_synchronization_helper_->WaitForFence(current_fence_id))
+    const auto& current_frame = output_frames_[frame_index_];
+
+    // wait for the frame that last used this slot, frame N - frame_count
+    uint64_t next_serial = frame_serial_ + 1;
+    if (next_serial > engine_config_.frame_count &&
+        !vk_synchronization_helper_->WaitForTimeline(frame_timeline_semaphore_, next_serial - engine_config_.frame_count))
         return;
 
     // get semaphores
-    auto* image_available_semaphore = vk_synchronization_helper_->GetSemaphore(current_image_available_semaphore_id);
-    auto* render_finished_semaphore = vk_synchronization_helper_->GetSemaphore(current_render_finished_semaphore_id);
-    auto* in_flight_fence           = vk_synchronization_helper_->GetFence(current_fence_id);
+    auto* image_available_semaphore = vk_synchronization_helper_->GetSemaphore(current_frame.image_available_semaphore);
+    auto* render_finished_semaphore = vk_synchronization_helper_->GetSemaphore(current_frame.render_finished_semaphore);
 
     // acquire next image
     uint32_t image_index    = 0;
@@ -1168,47 +1401,79 @@ void VulkanSample::draw_frame()
         return;
     }
 
-    // reset fence before submitting
-    if (!vk_synchronization_helper_->ResetFence(current_fence_id))
-        return;
+    // the timeline counter is the last frame retired by the GPU, at least N - frame_count after the wait above
+    frame_serial_     = next_serial;
+    completed_serial_ = vk_synchronization_helper_->GetTimelineValue(frame_timeline_semaphore_);
+    vra_deletion_queue_->Collect(completed_serial_);
+    destroy_retired_swapchains(false);
+    vra_descriptor_allocator_->ResetFrame(frame_index_);
+    vk_command_allocator_->ResetFrame(frame_index_);
+    vra_descriptor_cache_->Tick(frame_serial_, completed_serial_);
+    vra_bindless_table_->Flush(completed_serial_);
+    vra_residency_manager_->Update(completed_serial_);
+    vra_upload_manager_->Collect();
+    vra_statistics_reporter_->Tick(frame_serial_);
+    vk_pipeline_cache_->Tick(frame_serial_);
 
     // record command buffer
-    if (!vk_command_buffer_helper_->ResetCommandBuffer(current_command_buffer_id))
-        return;
-    if (!record_command(image_index, current_command_buffer_id))
+    auto* command_buffer = vk_command_allocator_->Allocate(frame_index_);
+    if (command_buffer == VK_NULL_HANDLE || !record_command(image_index, command_buffer))
+    {
+        abandon_frame(image_available_semaphore);
         return;
+    }
 
     // submit command buffer
     VkCommandBufferSubmitInfo command_buffer_submit_info{};
     command_buffer_submit_info.sType         = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
-    command_buffer_submit_info.commandBuffer = vk_command_buffer_helper_->GetCommandBuffer(current_command_buffer_id);
-
-    VkSemaphoreSubmitInfo wait_semaphore_info{};
-    wait_semaphore_info.sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-    wait_semaphore_info.semaphore = image_available_semaphore;
-    wait_semaphore_info.value     = 1;
-
-    VkSemaphoreSubmitInfo signal_semaphore_info{};
-    signal_semaphore_info.sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-    signal_semaphore_info.semaphore = render_finished_semaphore;
-    signal_semaphore_info.value     = 1;
+    command_buffer_submit_info.commandBuffer = command_buffer;
+
+    VkSemaphoreSubmitInfo wait_semaphore_infos[2]{};
+    wait_semaphore_infos[0].sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    wait_semaphore_infos[0].semaphore = image_available_semaphore;
+    wait_semaphore_infos[0].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    uint32_t wait_semaphore_count     = 1;
+
+    // the ownership acquire recorded in this command buffer must be ordered after the release by a semaphore,
+    // a host observation of the value is not a dependency, the wait costs nothing once the value is signalled
+    if (pending_upload_value_ != 0)
+    {
+        wait_semaphore_infos[1].sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        wait_semaphore_infos[1].semaphore = vra_upload_manager_->GetTimelineSemaphore();
+        wait_semaphore_infos[1].value     = pending_upload_value_;
+        wait_semaphore_infos[1].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        wait_semaphore_count              = 2;
+    }
+
+    // binary semaphores ignore the value, the timeline one retires this frame
+    VkSemaphoreSubmitInfo signal_semaphore_infos[2]{};
+    signal_semaphore_infos[0].sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal_semaphore_infos[0].semaphore = render_finished_semaphore;
+    signal_semaphore_infos[0].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    signal_semaphore_infos[1].sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal_semaphore_infos[1].semaphore = vk_synchronization_helper_->GetSemaphore(frame_timeline_semaphore_);
+    signal_semaphore_infos[1].value     = frame_serial_;
+    signal_semaphore_infos[1].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 
     VkSubmitInfo2 submit_info{};
     submit_info.sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
     submit_info.commandBufferInfoCount   = 1;
     submit_info.pCommandBufferInfos      = &command_buffer_submit_info;
-    submit_info.waitSemaphoreInfoCount   = 1;
-    submit_info.pWaitSemaphoreInfos      = &wait_semaphore_info;
-    submit_info.signalSemaphoreInfoCount = 1;
-    submit_info.pSignalSemaphoreInfos    = &signal_semaphore_info;
-    if (!Logger::LogWithVkResult(
-            vkQueueSubmit2(comm_vk_graphics_queue_, 1, &submit_info, in_flight_fence),
-            "Failed to submit command buffer",
-            "Succeeded in submitting command buffer"))
-    {
+    submit_info.waitSemaphoreInfoCount   = wait_semaphore_count;
+    submit_info.pWaitSemaphoreInfos      = wait_semaphore_infos;
+    submit_info.signalSemaphoreInfoCount = 2;
+    submit_info.pSignalSemaphoreInfos    = signal_semaphore_infos;
+    VkResult submit_result = vkQueueSubmit2(comm_vk_graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
+    if (submit_result != VK_SUCCESS)
+    {
+        Logger::LogWithVkResult(submit_result, "Failed to submit command buffer", "Succeeded in submitting command buffer");
+        abandon_frame(image_available_semaphore);
         return;
     }
 
+    // the serial is submitted, the slot is free again once it retires, whatever the present returns
+    frame_index_ = (frame_index_ + 1) % engine_config_.frame_count;
+
     // present the image
     VkPresentInfoKHR present_info{};
     present_info.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1218,6 +1483,10 @@ void VulkanSample::draw_frame()
     present_info.pSwapchains        = &comm_vk_swapchain_;
     present_info.pImageIndices      = &image_index;
     VkResult present_result = vkQueuePresentKHR(comm_vk_graphics_queue_, &present_info);
+    if ((present_result == VK_SUCCESS || present_result == VK_SUBOPTIMAL_KHR) && first_present_serial_ == 0)
+    {
+        first_present_serial_ = frame_serial_;
+    }
     if (present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR)
     {
         resize_request_ = true;
@@ -1228,84 +1497,377 @@ void VulkanSample::draw_frame()
         Logger::LogWithVkResult(present_result, "Failed to present image", "Succeeded in presenting image");
         return;
     }
-
-    // update frame index
-    frame_index_ = (frame_index_ + 1) % engine_config_.frame_count;
 }
 
-void VulkanSample::resize_swapchain()
+void VulkanSample::abandon_frame(VkSemaphore image_available_semaphore)
 {
-    // wait for the device to be idle
-    vkDeviceWaitIdle(comm_vk_logical_device_);
+    // frame_serial_ is already handed out, later waits for it and teardown must not block forever,
+    // an empty batch consumes the acquire semaphore and signals the serial in submission order
+    VkSemaphoreSubmitInfo wait_semaphore_info{};
+    wait_semaphore_info.sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    wait_semaphore_info.semaphore = image_available_semaphore;
+    wait_semaphore_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 
-    // destroy old vulkan objects
+    VkSemaphoreSubmitInfo signal_semaphore_info{};
+    signal_semaphore_info.sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal_semaphore_info.semaphore = vk_synchronization_helper_->GetSemaphore(frame_timeline_semaphore_);
+    signal_semaphore_info.value     = frame_serial_;
+    signal_semaphore_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 
-    for (auto *image_view : comm_vk_swapchain_context_.swapchain_image_views_)
+    VkSubmitInfo2 submit_info{};
+    submit_info.sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submit_info.waitSemaphoreInfoCount   = 1;
+    submit_info.pWaitSemaphoreInfos      = &wait_semaphore_info;
+    submit_info.signalSemaphoreInfoCount = 1;
+    submit_info.pSignalSemaphoreInfos    = &signal_semaphore_info;
+    VkResult submit_result = vkQueueSubmit2(comm_vk_graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
+    if (submit_result != VK_SUCCESS)
     {
-        vkDestroyImageView(comm_vk_logical_device_, image_view, nullptr);
+        Logger::LogWithVkResult(submit_result, "Failed to submit an empty batch for an abandoned frame", "Succeeded in submitting an empty batch for an abandoned frame");
     }
-    // Note: Don't destroy swapchain images as they are owned by the swapchain
-    vkDestroySwapchainKHR(comm_vk_logical_device_, comm_vk_swapchain_, nullptr);
-    vk_frame_buffer_helper_.reset();
+
+    // the serial retires without the recorded work, copies and ownership acquires it held are recorded again next frame
+    vra_defragmenter_->AbortRecordedPass(frame_serial_);
+    vra_upload_manager_->AbortAcquireBarriers(frame_serial_);
+
+    // the slot's semaphores are reused once the serial retires, like a presented frame
+    frame_index_ = (frame_index_ + 1) % engine_config_.frame_count;
+
+    // the image stays acquired without a present, recreating the swapchain gives it back
+    resize_request_ = true;
+}
+
+void VulkanSample::resize_swapchain()
+{
+    // the last submitted frame is the last one rendering to the old image views and depth,
+    // they are destroyed once the frame timeline passes it instead of draining the device
+    auto* device               = comm_vk_logical_device_;
+    auto old_image_views       = comm_vk_swapchain_context_.swapchain_image_views_;
+    auto* old_depth_image_view = depth_image_view_;
+    auto* old_depth_image      = depth_image_;
+    auto* old_depth_memory     = depth_memory_;
+    vra_deletion_queue_->Enqueue(frame_serial_,
+                                 [=]()
+                                 {
+                                     for (auto* image_view : old_image_views)
+                                     {
+                                         vkDestroyImageView(device, image_view, nullptr);
+                                     }
+                                     vkDestroyImageView(device, old_depth_image_view, nullptr);
+                                     vkDestroyImage(device, old_depth_image, nullptr);
+                                     vkFreeMemory(device, old_depth_memory, nullptr);
+                                 });
+    // Note: Don't destroy swapchain images as they are owned by the swapchain,
+    // the swapchain itself may still be presenting them after the frame retires
+    retired_swapchains_.push_back(comm_vk_swapchain_);
+    first_present_serial_ = 0;
+    depth_image_view_ = VK_NULL_HANDLE;
+    depth_image_      = VK_NULL_HANDLE;
+    depth_memory_     = VK_NULL_HANDLE;
 
     // reset window size
     auto current_extent     = vk_window_helper_->GetCurrentWindowExtent();
     engine_config_.window_config.width  = current_extent.width;
     engine_config_.window_config.height = current_extent.height;
 
-    // create new swapchain
+    // create new swapchain, it retires the old one passed as oldSwapchain
     if (!create_swapchain())
     {
         throw std::runtime_error("Failed to create Vulkan swap chain.");
     }
 
-    // recreate framebuffers
-    if (!create_frame_buffer())
+    // recreate depth, no framebuffers are needed with dynamic rendering
+    if (!create_depth_resources())
+    {
+        throw std::runtime_error("Failed to create depth resources.");
+    }
+
+    resize_request_          = false;
+    resize_report_countdown_ = kResizeReportFrames;
+}
+
+void VulkanSample::destroy_retired_swapchains(bool device_idle)
+{
+    // a present waits on its frame's work, once a frame presented on the current swapchain and frame_count frames
+    // after it have retired, the presentation engine has moved on from the images of the replaced ones
+    bool presents_retired =
+        first_present_serial_ != 0 && completed_serial_ >= first_present_serial_ + engine_config_.frame_count;
+    if (retired_swapchains_.empty() || (!device_idle && !presents_retired))
+        return;
+
+    for (auto* swapchain : retired_swapchains_)
+    {
+        vkDestroySwapchainKHR(comm_vk_logical_device_, swapchain, nullptr);
+    }
+    retired_swapchains_.clear();
+}
+
+void VulkanSample::track_frame_time()
+{
+    auto now            = std::chrono::steady_clock::now();
+    float frame_time_ms = std::chrono::duration<float, std::milli>(now - last_draw_time_).count();
+    last_draw_time_     = now;
+
+    if (resize_report_countdown_ == 0)
+    {
+        steady_frame_time_ms_ = steady_frame_time_ms_ == 0.0F ? frame_time_ms
+                                                              : steady_frame_time_ms_ * 0.95F + frame_time_ms * 0.05F;
+        return;
+    }
+
+    // a continuous drag keeps restarting the countdown, the peak covers the whole drag
+    resize_peak_frame_time_ms_ = std::max(resize_peak_frame_time_ms_, frame_time_ms);
+    if (--resize_report_countdown_ == 0)
+    {
+        Logger::LogInfo("Swapchain recreation: peak frame time " + std::to_string(resize_peak_frame_time_ms_) +
+                        " ms, steady frame time " + std::to_string(steady_frame_time_ms_) + " ms");
+        resize_peak_frame_time_ms_ = 0.0F;
+    }
+}
+
+bool VulkanSample::check_uniform_block(const SVulkanShaderReflection& reflection) const
+{
+    for (const auto& binding : reflection.bindings)
+    {
+        if (binding.set == 0 && binding.binding == 0 && binding.block_size != sizeof(SMvpMatrix))
+        {
+            Logger::LogError("Uniform block " + binding.name + " is " + std::to_string(binding.block_size) +
+                             " bytes, SMvpMatrix is " + std::to_string(sizeof(SMvpMatrix)));
+            return false;
+        }
+    }
+    return true;
+}
+
+void VulkanSample::reload_shaders()
+{
+    // fast linked variants replaced by their relink may still be read by the last submitted frame
+    retire_pipelines(vk_pipeline_library_->TakeRetiredPipelines());
+
+    // the reloaded variant replaces the drawn one at a frame boundary once it is ready, until then the previous one draws
+    if (pending_shader_reload_)
+    {
+        if (vk_pipeline_library_->IsReady(pending_shader_reload_->pipeline_key))
+        {
+            retire_shader(vertex_shader_key_);
+            retire_shader(fragment_shader_key_);
+            pipeline_key_                 = pending_shader_reload_->pipeline_key;
+            vertex_shader_key_            = pending_shader_reload_->vertex_shader_key;
+            fragment_shader_key_          = pending_shader_reload_->fragment_shader_key;
+            vertex_shader_reflection_     = vk_shader_library_->GetReflection(vertex_shader_key_);
+            fragment_shader_reflection_   = vk_shader_library_->GetReflection(fragment_shader_key_);
+            test_vertex_input_attributes_ = std::move(pending_shader_reload_->vertex_attributes);
+            pending_shader_reload_.reset();
+            // the drawn variant stands in for variants still compiling, the previous fallback can be released with its shaders
+            vk_pipeline_library_->PromoteFallback(pipeline_key_);
+            Logger::LogInfo("Swapped in reloaded shaders");
+        }
+        else if (vk_pipeline_library_->HasFailed(pending_shader_reload_->pipeline_key))
+        {
+            retire_shader(pending_shader_reload_->vertex_shader_key);
+            retire_shader(pending_shader_reload_->fragment_shader_key);
+            pending_shader_reload_.reset();
+            Logger::LogError("Reloaded shaders failed to build a pipeline, keeping the previous one");
+        }
+    }
+    collect_retired_shaders();
+
+    if (vk_shader_watcher_ == nullptr)
+        return;
+    auto changed_shaders = vk_shader_watcher_->TakeChangedShaders();
+    if (changed_shaders.empty())
+        return;
+
+    // a reload started earlier but not swapped in yet is superseded
+    uint64_t vertex_shader_key   = pending_shader_reload_ ? pending_shader_reload_->vertex_shader_key : vertex_shader_key_;
+    uint64_t fragment_shader_key = pending_shader_reload_ ? pending_shader_reload_->fragment_shader_key : fragment_shader_key_;
+    for (const auto& path : changed_shaders)
+    {
+        bool is_vertex_shader = path.filename() == vertex_shader_path_.filename();
+        if (!is_vertex_shader && path.filename() != fragment_shader_path_.filename())
+            continue; // not used by the pipeline
+
+        std::vector<uint32_t> shader_code;
+        if (!VulkanShaderHelper::ReadShaderCode(path.string().c_str(), shader_code))
+            continue;
+        uint64_t key = vk_shader_library_->AddShader(
+            is_vertex_shader ? EShaderType::kVertexShader : EShaderType::kFragmentShader, shader_code);
+        if (key == VulkanShaderLibrary::INVALID_KEY)
+        {
+            Logger::LogError("Failed to load reloaded shader " + path.filename().string());
+            continue;
+        }
+        (is_vertex_shader ? vertex_shader_key : fragment_shader_key) = key;
+    }
+
+    // the scene's descriptor sets, push constants and vertex buffers stay as they are, the reloaded shaders have to fit
+    // the live pipeline layout, rejected shaders are retired unless something still draws with them
+    auto reject = [&](const std::string& message)
+    {
+        Logger::LogError(message);
+        retire_shader(vertex_shader_key);
+        retire_shader(fragment_shader_key);
+    };
+    const auto* vertex_reflection   = vk_shader_library_->GetReflection(vertex_shader_key);
+    const auto* fragment_reflection = vk_shader_library_->GetReflection(fragment_shader_key);
+    std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> set_layouts;
+    std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> live_set_layouts;
+    if (!VulkanShaderReflection::MergeSetLayouts({vertex_reflection, fragment_reflection},
+                                                 set_layouts,
+                                                 SVulkanSetLayoutOptions{.dynamic_uniform_buffers = true}) ||
+        !VulkanShaderReflection::MergeSetLayouts({vertex_shader_reflection_, fragment_shader_reflection_},
+                                                 live_set_layouts,
+                                                 SVulkanSetLayoutOptions{.dynamic_uniform_buffers = true}) ||
+        vk_set_layout_cache_->GetOrCreate(set_layouts[0]) != descriptor_set_layout_)
+    {
+        reject("Reloaded shaders change the descriptor set layout, restart to pick them up");
+        return;
+    }
+    // set 1 is the bindless table, its layout is fixed, stages reading it do not matter
+    auto same_bindings = [](const std::vector<VkDescriptorSetLayoutBinding>& lhs, const std::vector<VkDescriptorSetLayoutBinding>& rhs)
+    {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                          [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+                          {
+                              return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+                                     a.descriptorCount == b.descriptorCount;
+                          });
+    };
+    if (!same_bindings(set_layouts[1], live_set_layouts[1]) || set_layouts.upper_bound(1) != set_layouts.end())
+    {
+        reject("Reloaded shaders change the bindless set or declare more sets, restart to pick them up");
+        return;
+    }
+    if (!check_uniform_block(*vertex_reflection) || !check_uniform_block(*fragment_reflection))
+    {
+        reject("Reloaded shaders no longer match SMvpMatrix, keeping the previous ones");
+        return;
+    }
+    auto push_constant_ranges      = VulkanShaderReflection::MergePushConstantRanges({vertex_reflection, fragment_reflection});
+    auto live_push_constant_ranges = VulkanShaderReflection::MergePushConstantRanges({vertex_shader_reflection_, fragment_shader_reflection_});
+    if (!std::equal(push_constant_ranges.begin(), push_constant_ranges.end(),
+                    live_push_constant_ranges.begin(), live_push_constant_ranges.end(),
+                    [](const VkPushConstantRange& a, const VkPushConstantRange& b)
+                    { return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size; }))
+    {
+        reject("Reloaded shaders change the push constant ranges, restart to pick them up");
+        return;
+    }
+    std::vector<VkVertexInputAttributeDescription> vertex_attributes;
+    if (!VulkanShaderReflection::SelectVertexAttributes(*vertex_reflection, available_vertex_attributes_, vertex_attributes))
+    {
+        reject("Reloaded vertex shader reads attributes gltf::Vertex does not provide");
+        return;
+    }
+
+    if (pending_shader_reload_)
+    {
+        retire_shader(pending_shader_reload_->vertex_shader_key);
+        retire_shader(pending_shader_reload_->fragment_shader_key);
+    }
+
+    // compiled on a pipeline library worker through the pipeline cache, unchanged code resolves to an existing variant
+    SShaderReload reload;
+    reload.pipeline_key        = vk_pipeline_library_->Request(make_pipeline_config(vertex_shader_key, fragment_shader_key, vertex_attributes));
+    reload.vertex_shader_key   = vertex_shader_key;
+    reload.fragment_shader_key = fragment_shader_key;
+    reload.vertex_attributes   = std::move(vertex_attributes);
+    pending_shader_reload_     = std::move(reload);
+}
+
+void VulkanSample::retire_shader(uint64_t shader_key)
+{
+    if (shader_key != VulkanShaderLibrary::INVALID_KEY)
+        retiring_shader_keys_.push_back(shader_key);
+}
+
+void VulkanSample::collect_retired_shaders()
+{
+    std::vector<uint64_t> waiting;
+    for (uint64_t shader_key : retiring_shader_keys_)
+    {
+        // released already, or drawn with again after all, the swap that replaces it retires it again
+        bool in_use = shader_key == vertex_shader_key_ || shader_key == fragment_shader_key_ ||
+                      (pending_shader_reload_ && (shader_key == pending_shader_reload_->vertex_shader_key ||
+                                                  shader_key == pending_shader_reload_->fragment_shader_key));
+        VkShaderModule module = vk_shader_library_->GetModule(shader_key);
+        if (module == VK_NULL_HANDLE || in_use)
+            continue;
+
+        // compiles still running may read the module, it is tried again next frame
+        std::vector<std::unique_ptr<VulkanPipelineHelper>> released;
+        if (!vk_pipeline_library_->ReleaseShaderModule(module, released))
+        {
+            waiting.push_back(shader_key);
+            continue;
+        }
+        retire_pipelines(std::move(released));
+        vk_shader_library_->Release(shader_key);
+        auto* device = comm_vk_logical_device_;
+        vra_deletion_queue_->Enqueue(frame_serial_, [device, module]() { vkDestroyShaderModule(device, module, nullptr); });
+    }
+    retiring_shader_keys_ = std::move(waiting);
+}
+
+void VulkanSample::retire_pipelines(std::vector<std::unique_ptr<VulkanPipelineHelper>> pipelines)
+{
+    // the last submitted frame may still use them, deleters have to be copyable so ownership moves into a shared_ptr
+    for (auto& pipeline : pipelines)
     {
-        throw std::runtime_error("Failed to create Vulkan frame buffer.");
+        std::shared_ptr<VulkanPipelineHelper> retired = std::move(pipeline);
+        vra_deletion_queue_->Enqueue(frame_serial_, [retired]() mutable { retired.reset(); });
     }
+}
 
-    resize_request_ = false;
+bool VulkanSample::live_resize_event_watch(void* userdata, SDL_Event* event)
+{
+    // the watch runs inside SDL_PollEvent and possibly on another thread, it only draws on the main thread
+    // and never while a Draw is already in progress, otherwise the main loop picks the redraw up
+    auto* sample = static_cast<VulkanSample*>(userdata);
+    if (event->type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED)
+    {
+        sample->resize_request_ = true;
+    }
+    if (event->type == SDL_EVENT_WINDOW_EXPOSED)
+    {
+        if (SDL_IsMainThread() && !sample->drawing_ && sample->render_state_ == ERenderState::kTrue)
+        {
+            sample->Draw();
+        }
+        else
+        {
+            sample->redraw_request_ = true;
+        }
+    }
+    return true;
 }
 
-bool VulkanSample::record_command(uint32_t image_index, const std::string& command_buffer_id)
+bool VulkanSample::record_command(uint32_t image_index, VkCommandBuffer command_buffer)
 {
-    // 更新当前帧的 Uniform Buffer
-    update_uniform_buffer(image_index);
+    // 更新当前帧的 Uniform Buffer, the previous frame of this slot has retired
+    update_uniform_buffer(frame_index_);
 
     // begin command recording
-    if (!vk_command_buffer_helper_->BeginCommandBufferRecording(command_buffer_id,
-                                                             VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
-        return false;
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VkResult begin_result = vkBeginCommandBuffer(command_buffer, &begin_info);
+    if (begin_result != VK_SUCCESS)
+        return Logger::LogWithVkResult(begin_result, "Failed to begin command buffer", "Succeeded in beginning command buffer");
+
+    // reload evicted meshes on demand, a mesh that does not fit is not drawn this frame
+    for (uint32_t mesh_index = 0; mesh_index < mesh_residency_.size(); ++mesh_index)
+    {
+        mesh_residency_[mesh_index].drawable = vra_residency_manager_->Touch(mesh_index, frame_serial_);
+    }
+
+    // take ownership of buffers uploaded by the transfer queue, the submit waits for the upload to finish
+    pending_upload_value_ = vra_upload_manager_->RecordAcquireBarriers(command_buffer, frame_serial_);
 
-    // collect needed objects
-    auto *command_buffer = vk_command_buffer_helper_->GetCommandBuffer(command_buffer_id);
-
-    // 从暂存缓冲区复制到本地缓冲区
-    VkBufferCopy buffer_copy_info{};
-    buffer_copy_info.srcOffset = 0;
-    buffer_copy_info.dstOffset = 0;
-    buffer_copy_info.size      = test_staging_buffer_allocation_info_.size;
-    vkCmdCopyBuffer(command_buffer, test_staging_buffer_, test_local_buffer_, 1, &buffer_copy_info);
-
-    // 设置内存屏障以确保复制完成
-    VkBufferMemoryBarrier2 buffer_memory_barrier{};
-    buffer_memory_barrier.sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
-    buffer_memory_barrier.srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
-    buffer_memory_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
-    buffer_memory_barrier.dstStageMask  = VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT;
-    buffer_memory_barrier.dstAccessMask = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
-    buffer_memory_barrier.buffer        = test_local_buffer_;
-    buffer_memory_barrier.offset        = 0;
-    buffer_memory_barrier.size          = VK_WHOLE_SIZE;
-
-    VkDependencyInfo dependency_info{};
-    dependency_info.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-    dependency_info.bufferMemoryBarrierCount = 1;
-    dependency_info.pBufferMemoryBarriers    = &buffer_memory_barrier;
-    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
-
-    // begin renderpass
+    // advance online defragmentation, may swap test_local_buffer_ through its relocation callback
+    vra_defragmenter_->Tick(command_buffer, frame_serial_, completed_serial_);
+
+    // clear values of the color and depth attachments
     VkClearValue clear_color     = {};
     clear_color.color.float32[0] = 0.1F;
     clear_color.color.float32[1] = 0.1F;
@@ -1316,32 +1878,172 @@ bool VulkanSample::record_command(uint32_t image_index, const std::string& comma
     clear_values[0].color        = {{0.1F, 0.1F, 0.1F, 1.0F}};
     clear_values[1].depthStencil = {.depth = 1.0F, .stencil = 0}; // 设置深度清除值为1.0（远面）
 
-    VkRenderPassBeginInfo renderpass_info{};
-    renderpass_info.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderpass_info.renderPass        = vk_renderpass_helper_->GetRenderpass();
-    renderpass_info.framebuffer       = (*vk_frame_buffer_helper_->GetFramebuffers())[image_index];
-    renderpass_info.renderArea.offset = {.x = 0, .y = 0};
-    renderpass_info.renderArea.extent = comm_vk_swapchain_context_.swapchain_info_.extent_;
-    renderpass_info.clearValueCount   = 2;
-    renderpass_info.pClearValues      = clear_values;
+    // swapchain image to color attachment, its previous contents are discarded
+    auto* swapchain_image = comm_vk_swapchain_context_.swapchain_images_[image_index];
+    auto depth_aspect     = depth_format_ == VK_FORMAT_D32_SFLOAT
+                                ? VkImageAspectFlags{VK_IMAGE_ASPECT_DEPTH_BIT}
+                                : VkImageAspectFlags{VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT};
+    VkImageMemoryBarrier2 attachment_barriers[2]{};
+    attachment_barriers[0].sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    attachment_barriers[0].srcStageMask     = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    attachment_barriers[0].srcAccessMask    = VK_ACCESS_2_NONE;
+    attachment_barriers[0].dstStageMask     = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    attachment_barriers[0].dstAccessMask    = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+    attachment_barriers[0].oldLayout        = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment_barriers[0].newLayout        = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachment_barriers[0].image            = swapchain_image;
+    attachment_barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    // depth is shared by every frame in flight, wait for the previous frame's depth writes before clearing it
+    attachment_barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    attachment_barriers[1].srcStageMask =
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    attachment_barriers[1].srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    attachment_barriers[1].dstStageMask =
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    attachment_barriers[1].dstAccessMask =
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    attachment_barriers[1].oldLayout        = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment_barriers[1].newLayout        = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    attachment_barriers[1].image            = depth_image_;
+    attachment_barriers[1].subresourceRange = {depth_aspect, 0, 1, 0, 1};
+
+    VkDependencyInfo attachment_dependency{};
+    attachment_dependency.sType                   = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    attachment_dependency.imageMemoryBarrierCount = 2;
+    attachment_dependency.pImageMemoryBarriers    = attachment_barriers;
+    vkCmdPipelineBarrier2(command_buffer, &attachment_dependency);
+
+    // attachments are described per frame, nothing has to be rebuilt when the swapchain changes
+    VkRenderingAttachmentInfo color_attachment{};
+    color_attachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    color_attachment.imageView   = comm_vk_swapchain_context_.swapchain_image_views_[image_index];
+    color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    color_attachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    color_attachment.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment.clearValue  = clear_values[0];
+
+    VkRenderingAttachmentInfo depth_attachment{};
+    depth_attachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depth_attachment.imageView   = depth_image_view_;
+    depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depth_attachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depth_attachment.storeOp     = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.clearValue  = clear_values[1];
+
+    VkRenderingInfo rendering_info{};
+    rendering_info.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    rendering_info.renderArea.offset    = {.x = 0, .y = 0};
+    rendering_info.renderArea.extent    = comm_vk_swapchain_context_.swapchain_info_.extent_;
+    rendering_info.layerCount           = 1;
+    rendering_info.colorAttachmentCount = 1;
+    rendering_info.pColorAttachments    = &color_attachment;
+    rendering_info.pDepthAttachment     = &depth_attachment;
+
+    // bind descriptor set, a cache hit unless the bindings changed, the previous set is kept on failure
+    if (!vra_descriptor_cache_->GetOrCreate(descriptor_set_layout_, descriptor_bindings_, descriptor_set_, frame_serial_))
+        Logger::LogError("Failed to get descriptor set from cache");
+
+    // a variant still compiling resolves to the fallback pipeline, never stalls the frame
+    active_pipeline_ = vk_pipeline_library_->Get(pipeline_key_);
+
+    // large draw lists are split across worker threads, each recording a secondary command buffer
+    auto draw_count      = static_cast<uint32_t>(draw_list_.size());
+    bool record_parallel = vk_parallel_recorder_->GetPartitionCount(draw_count) > 1;
+    if (record_parallel)
+    {
+        rendering_info.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+        vkCmdBeginRendering(command_buffer, &rendering_info);
+
+        VkFormat color_format = comm_vk_swapchain_context_.swapchain_info_.surface_format_.format;
+        VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info{};
+        inheritance_rendering_info.sType                   = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        inheritance_rendering_info.colorAttachmentCount    = 1;
+        inheritance_rendering_info.pColorAttachmentFormats = &color_format;
+        inheritance_rendering_info.depthAttachmentFormat   = depth_format_;
+        inheritance_rendering_info.rasterizationSamples    = VK_SAMPLE_COUNT_1_BIT;
+
+        VkCommandBufferInheritanceInfo inheritance_info{};
+        inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance_info.pNext = &inheritance_rendering_info;
+        if (!vk_parallel_recorder_->Record(frame_index_,
+                                           inheritance_info,
+                                           draw_count,
+                                           [this](VkCommandBuffer secondary, uint32_t first_draw, uint32_t count)
+                                           { record_draws(secondary, first_draw, count); },
+                                           secondary_command_buffers_))
+        {
+            Logger::LogError("Failed to record secondary command buffers");
+            vkCmdEndRendering(command_buffer);
+            vkEndCommandBuffer(command_buffer);
+            return false;
+        }
+        vkCmdExecuteCommands(command_buffer,
+                             static_cast<uint32_t>(secondary_command_buffers_.size()),
+                             secondary_command_buffers_.data());
+    }
+    else
+    {
+        vkCmdBeginRendering(command_buffer, &rendering_info);
+        record_draws(command_buffer, 0, draw_count);
+    }
+
+    // end rendering
+    vkCmdEndRendering(command_buffer);
+
+    // color attachment to present, the render finished semaphore covers the write
+    VkImageMemoryBarrier2 present_barrier{};
+    present_barrier.sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    present_barrier.srcStageMask     = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    present_barrier.srcAccessMask    = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+    present_barrier.dstStageMask     = VK_PIPELINE_STAGE_2_NONE;
+    present_barrier.dstAccessMask    = VK_ACCESS_2_NONE;
+    present_barrier.oldLayout        = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    present_barrier.newLayout        = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    present_barrier.image            = swapchain_image;
+    present_barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    VkDependencyInfo present_dependency{};
+    present_dependency.sType                   = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    present_dependency.imageMemoryBarrierCount = 1;
+    present_dependency.pImageMemoryBarriers    = &present_barrier;
+    vkCmdPipelineBarrier2(command_buffer, &present_dependency);
+
+    // end command recording
+    VkResult end_result = vkEndCommandBuffer(command_buffer);
+    if (end_result != VK_SUCCESS)
+        return Logger::LogWithVkResult(end_result, "Failed to end command buffer", "Succeeded in ending command buffer");
+    return true;
+}
 
-    vkCmdBeginRenderPass(command_buffer, &renderpass_info, VK_SUBPASS_CONTENTS_INLINE);
+void VulkanSample::record_draws(VkCommandBuffer command_buffer, uint32_t first_draw, uint32_t draw_count)
+{
+    // every command goes through the state cache, which drops binds and dynamic state that would not change anything
+    VulkanCommandStateCache state_cache(command_buffer, dynamic_state_functions_);
 
     // bind pipeline
-    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_pipeline_helper_->GetPipeline());
+    state_cache.BindPipeline(*active_pipeline_);
 
-    // bind descriptor set
-    auto offset =
-        uniform_batch_handle_[vra::VraBuiltInBatchIds::CPU_GPU_Frequently].offsets[uniform_buffer_id_[frame_index_]];
-    auto dynamic_offset = static_cast<uint32_t>(offset);
+    // bind descriptor sets, maps are only read through const lookups since this runs on worker threads
+    const auto& uniform_batch = uniform_batch_handle_.find(vra::VraBuiltInBatchIds::CPU_GPU_Frequently)->second;
+    auto dynamic_offset       = static_cast<uint32_t>(uniform_batch.offsets.at(uniform_buffer_id_[frame_index_]));
     vkCmdBindDescriptorSets(command_buffer,
                             VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            vk_pipeline_helper_->GetPipelineLayout(),
+                            active_pipeline_->GetPipelineLayout(),
                             0,
                             1,
                             &descriptor_set_,
                             1,
                             &dynamic_offset);
+    auto* bindless_set = vra_bindless_table_->GetDescriptorSet();
+    vkCmdBindDescriptorSets(command_buffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            active_pipeline_->GetPipelineLayout(),
+                            1,
+                            1,
+                            &bindless_set,
+                            0,
+                            nullptr);
 
     // dynamic state update
     VkViewport viewport{};
@@ -1351,50 +2053,37 @@ bool VulkanSample::record_command(uint32_t image_index, const std::string& comma
     viewport.height   = static_cast<float>(comm_vk_swapchain_context_.swapchain_info_.extent_.height);
     viewport.minDepth = 0.0F;
     viewport.maxDepth = 1.0F;
-    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    state_cache.SetViewport(viewport);
 
     VkRect2D scissor{};
     scissor.offset = {.x=0, .y=0};
     scissor.extent = comm_vk_swapchain_context_.swapchain_info_.extent_;
-    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    state_cache.SetScissor(scissor);
+
+    if (draw_count == 0)
+    {
+        return;
+    }
 
     // 绑定顶点和索引缓冲区
-    vkCmdBindVertexBuffers(
-        command_buffer,
-        0,
-        1,
-        &test_local_buffer_,
-        &test_local_host_batch_handle_[vra::VraBuiltInBatchIds::GPU_Only].offsets[test_vertex_buffer_id_]);
-    vkCmdBindIndexBuffer(
-        command_buffer,
-        test_local_buffer_,
-        test_local_host_batch_handle_[vra::VraBuiltInBatchIds::GPU_Only].offsets[test_index_buffer_id_],
-        VK_INDEX_TYPE_UINT32);
-
-    // 遍历每个 mesh 进行绘制
-    for (const auto& mesh : mesh_list_)
-    {
-        // 遍历该 mesh 的所有图元进行绘制
-        // if (std::strcmp(mesh.name.c_str(), "arch_stones_02") != 0) {
-        //     continue;
-        // }
-        for (const auto & primitive : mesh.primitives)
+    const auto& local_batch = test_local_host_batch_handle_.find(vra::VraBuiltInBatchIds::GPU_Only)->second;
+    state_cache.SetVertexInput(test_vertex_input_binding_description_, test_vertex_input_attributes_);
+    state_cache.BindVertexBuffer(test_local_buffer_, local_batch.offsets.at(test_vertex_buffer_id_));
+
+    // 绘制当前范围内的图元, primitives of meshes that are not resident are skipped
+    for (uint32_t i = first_draw; i < first_draw + draw_count; ++i)
+    {
+        const auto& mesh = mesh_residency_[draw_mesh_indices_[i]];
+        if (!mesh.drawable)
         {
-            // 绘制当前图元
-            vkCmdDrawIndexed(command_buffer,
-                             primitive.index_count, // 使用实际的索引数量
-                             1,
-                             primitive.first_index, // 使用实际的索引偏移量
-                             0,
-                             0);
+            continue;
         }
-    }
-
-    // end renderpass
-    vkCmdEndRenderPass(command_buffer);
+        state_cache.BindIndexBuffer(mesh.index_buffer, 0, VK_INDEX_TYPE_UINT32);
 
-    // end command recording
-    return vk_command_buffer_helper_->EndCommandBufferRecording(command_buffer_id);
+        const auto& draw = draw_list_[i];
+        state_cache.SetRasterState(draw_raster_states_[i]);
+        vkCmdDrawIndexed(command_buffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+    }
 }
 
 void VulkanSample::update_uniform_buffer(uint32_t current_frame_index)
@@ -1420,21 +2109,15 @@ void VulkanSample::update_uniform_buffer(uint32_t current_frame_index)
     // reverse the Y-axis in Vulkan's NDC coordinate system
     mvp_matrices_[current_frame_index].projection[1][1] *= -1;
 
-    // map vulkan host memory to update the uniform buffer
-    uniform_buffer_mapped_data_ = nullptr;
-    vmaMapMemory(vma_allocator_, uniform_buffer_allocation_, &uniform_buffer_mapped_data_);
-
-    // get the offset of the current frame in the uniform buffer
-    auto offset = uniform_batch_handle_[vra::VraBuiltInBatchIds::CPU_GPU_Frequently]
-                      .offsets[uniform_buffer_id_[current_frame_index]];
-    uint8_t* data_location = static_cast<uint8_t*>(uniform_buffer_mapped_data_) + offset;
-
-    // copy the data to the mapped memory
-    memcpy(data_location, &mvp_matrices_[current_frame_index], sizeof(SMvpMatrix));
-
-    // unmap the memory
-    vmaUnmapMemory(vma_allocator_, uniform_buffer_allocation_);
-    uniform_buffer_mapped_data_ = nullptr;
+    // write through the persistent mapping, flushed only if the memory is not coherent
+    auto mvp_view = uniform_mapped_batch_->GetView<SMvpMatrix>(uniform_buffer_id_[current_frame_index]);
+    if (mvp_view.empty())
+    {
+        Logger::LogError("Failed to get uniform buffer view");
+        return;
+    }
+    mvp_view[0] = mvp_matrices_[current_frame_index];
+    uniform_mapped_batch_->Flush();
 }
 
 // add a function to focus on an object
@@ -1458,124 +2141,207 @@ void VulkanSample::focus_on_object(const glm::vec3& object_position, float targe
     camera_.yaw     = glm::degrees(atan2(front.z, front.x));
 }
 
-void VulkanSample::create_drawcall_list_buffer()
+bool VulkanSample::create_drawcall_list_buffer()
 {
     vra::VraRawData vertex_buffer_data{.pData_ = vertices_.data(), .size_ = sizeof(gltf::Vertex) * vertices_.size()};
-    vra::VraRawData index_buffer_data{.pData_ = indices_.data(), .size_ = sizeof(uint32_t) * indices_.size()};
 
     // 顶点缓冲区创建信息
     VkBufferCreateInfo vertex_buffer_create_info{};
     vertex_buffer_create_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    vertex_buffer_create_info.usage       = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vertex_buffer_create_info.usage       = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                      VK_BUFFER_USAGE_TRANSFER_SRC_BIT; // source of defragmentation copies
     vertex_buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     vra::VraDataDesc vertex_buffer_desc{
         vra::VraDataMemoryPattern::GPU_Only, vra::VraDataUpdateRate::RarelyOrNever, vertex_buffer_create_info};
 
-    // 索引缓冲区创建信息
-    VkBufferCreateInfo index_buffer_create_info{};
-    index_buffer_create_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    index_buffer_create_info.usage       = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-    index_buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    vra::VraDataDesc index_buffer_desc{
-        vra::VraDataMemoryPattern::GPU_Only, vra::VraDataUpdateRate::RarelyOrNever, index_buffer_create_info};
-
-    // 暂存缓冲区创建信息
-    VkBufferCreateInfo staging_buffer_create_info{};
-    staging_buffer_create_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    staging_buffer_create_info.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    staging_buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    vra::VraDataDesc staging_vertex_buffer_desc{
-        vra::VraDataMemoryPattern::CPU_GPU, vra::VraDataUpdateRate::RarelyOrNever, staging_buffer_create_info};
-    vra::VraDataDesc staging_index_buffer_desc{
-        vra::VraDataMemoryPattern::CPU_GPU, vra::VraDataUpdateRate::RarelyOrNever, staging_buffer_create_info};
-
     if (!vra_data_batcher_->Collect(vertex_buffer_desc, vertex_buffer_data, test_vertex_buffer_id_))
     {
         Logger::LogError("Failed to collect vertex buffer data");
-        return;
-    }
-    if (!vra_data_batcher_->Collect(index_buffer_desc, index_buffer_data, test_index_buffer_id_))
-    {
-        Logger::LogError("Failed to collect index buffer data");
-        return;
-    }
-    if (!vra_data_batcher_->Collect(staging_vertex_buffer_desc, vertex_buffer_data, test_staging_vertex_buffer_id_))
-    {
-        Logger::LogError("Failed to collect staging vertex buffer data");
-        return;
+        return false;
     }
-    if (!vra_data_batcher_->Collect(staging_index_buffer_desc, index_buffer_data, test_staging_index_buffer_id_))
+    // 执行批处理
+    test_local_host_batch_handle_ = vra_data_batcher_->Batch();
+
+    // 创建本地缓冲区并上传数据, every mesh reads the shared vertex data so it stays resident
+    if (!create_local_buffer())
     {
-        Logger::LogError("Failed to collect staging index buffer data");
-        return;
+        Logger::LogError("Failed to create local buffer");
+        return false;
     }
 
-    // 执行批处理
-    test_local_host_batch_handle_ = vra_data_batcher_->Batch();
+    // the indices are streamed per mesh, LRU eviction picks among the meshes the frames stopped drawing
+    for (uint32_t mesh_index = 0; mesh_index < mesh_residency_.size(); ++mesh_index)
+    {
+        auto& mesh = mesh_residency_[mesh_index];
+        if (mesh.indices.empty())
+        {
+            continue;
+        }
+        if (!create_mesh_index_buffer(mesh_index))
+        {
+            Logger::LogError("Failed to create index buffer of mesh " + mesh_list_[mesh_index].name);
+            return false;
+        }
 
-    // 创建本地缓冲区
-    auto test_local_buffer_create_info =
-        test_local_host_batch_handle_[vra::VraBuiltInBatchIds::GPU_Only].data_desc.GetBufferCreateInfo();
-    VmaAllocationCreateInfo allocation_create_info{};
-    allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
-    vmaCreateBuffer(vma_allocator_,
-                    &test_local_buffer_create_info,
-                    &allocation_create_info,
-                    &test_local_buffer_,
-                    &test_local_buffer_allocation_,
-                    &test_local_buffer_allocation_info_);
-
-    // 创建暂存缓冲区
-    auto test_host_buffer_create_info =
-        test_local_host_batch_handle_[vra::VraBuiltInBatchIds::CPU_GPU_Rarely].data_desc.GetBufferCreateInfo();
-    VmaAllocationCreateInfo staging_allocation_create_info{};
-    staging_allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
-    staging_allocation_create_info.flags = vra_data_batcher_->GetSuggestVmaMemoryFlags(
-        vra::VraDataMemoryPattern::CPU_GPU, vra::VraDataUpdateRate::RarelyOrNever);
-    vmaCreateBuffer(vma_allocator_,
-                    &test_host_buffer_create_info,
-                    &staging_allocation_create_info,
-                    &test_staging_buffer_,
-                    &test_staging_buffer_allocation_,
-                    &test_staging_buffer_allocation_info_);
-
-    // 复制数据到暂存缓冲区
-    auto consolidate_data = test_local_host_batch_handle_[vra::VraBuiltInBatchIds::CPU_GPU_Rarely].consolidated_data;
-    void* data = nullptr;
-    vmaInvalidateAllocation(vma_allocator_, test_staging_buffer_allocation_, 0, VK_WHOLE_SIZE);
-    vmaMapMemory(vma_allocator_, test_staging_buffer_allocation_, &data);
-    memcpy(data, consolidate_data.data(), consolidate_data.size());
-    vmaUnmapMemory(vma_allocator_, test_staging_buffer_allocation_);
-    vmaFlushAllocation(vma_allocator_, test_staging_buffer_allocation_, 0, VK_WHOLE_SIZE);
+        VmaAllocationInfo allocation_info{};
+        vmaGetAllocationInfo(vma_allocator_, mesh.allocation, &allocation_info);
+        vra_residency_manager_->Register(mesh_index,
+                                         vra::VraResidentResource{
+                                             .size       = allocation_info.size,
+                                             .heap_index = vra_residency_manager_->GetHeapIndex(mesh.allocation),
+                                             .evict      = [this, mesh_index]() { return destroy_mesh_index_buffer(mesh_index); },
+                                             .reload     = [this, mesh_index]() { return create_mesh_index_buffer(mesh_index); },
+                                         });
+    }
 
     // 设置顶点输入绑定描述
     test_vertex_input_binding_description_.binding   = 0;
     test_vertex_input_binding_description_.stride    = sizeof(gltf::Vertex);
     test_vertex_input_binding_description_.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    // 设置顶点属性描述
-    test_vertex_input_attributes_.clear();
+    // 设置顶点属性描述, every attribute gltf::Vertex provides, the vertex shader picks what it reads
+    std::vector<VkVertexInputAttributeDescription>& vertex_attributes = available_vertex_attributes_;
+    vertex_attributes.clear();
 
     // 使用更安全的偏移量计算，确保 offsetof 计算正确
     // position
-    test_vertex_input_attributes_.push_back(VkVertexInputAttributeDescription{
+    vertex_attributes.push_back(VkVertexInputAttributeDescription{
         .location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(gltf::Vertex, position)});
     // color
-    test_vertex_input_attributes_.push_back(VkVertexInputAttributeDescription{
+    vertex_attributes.push_back(VkVertexInputAttributeDescription{
         .location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(gltf::Vertex, color)});
     // normal
-    test_vertex_input_attributes_.push_back(VkVertexInputAttributeDescription{
+    vertex_attributes.push_back(VkVertexInputAttributeDescription{
         .location = 2, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(gltf::Vertex, normal)});
     // tangent
-    test_vertex_input_attributes_.push_back(
+    vertex_attributes.push_back(
         VkVertexInputAttributeDescription{.location = 3,
                                           .binding  = 0,
                                           .format   = VK_FORMAT_R32G32B32A32_SFLOAT,
                                           .offset   = offsetof(gltf::Vertex, tangent)});
     // uv0
-    test_vertex_input_attributes_.push_back(VkVertexInputAttributeDescription{
+    vertex_attributes.push_back(VkVertexInputAttributeDescription{
         .location = 4, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(gltf::Vertex, uv0)});
     // uv1
-    test_vertex_input_attributes_.push_back(VkVertexInputAttributeDescription{
+    vertex_attributes.push_back(VkVertexInputAttributeDescription{
         .location = 5, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(gltf::Vertex, uv1)});
+
+    // attributes the shader never reads are dropped, they would only cost fetch bandwidth
+    if (!VulkanShaderReflection::SelectVertexAttributes(*vertex_shader_reflection_, vertex_attributes, test_vertex_input_attributes_))
+    {
+        Logger::LogError("Vertex shader reads attributes gltf::Vertex does not provide");
+        return false;
+    }
+    Logger::LogInfo("Vertex shader reads " + std::to_string(test_vertex_input_attributes_.size()) + " of " +
+                    std::to_string(vertex_attributes.size()) + " vertex attributes");
+    return true;
+}
+
+bool VulkanSample::create_local_buffer()
+{
+    auto test_local_buffer_create_info =
+        test_local_host_batch_handle_[vra::VraBuiltInBatchIds::GPU_Only].data_desc.GetBufferCreateInfo();
+    VmaAllocationCreateInfo allocation_create_info{};
+    allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+    if (!Logger::LogWithVkResult(vmaCreateBuffer(vma_allocator_,
+                                                 &test_local_buffer_create_info,
+                                                 &allocation_create_info,
+                                                 &test_local_buffer_,
+                                                 &test_local_buffer_allocation_,
+                                                 &test_local_buffer_allocation_info_),
+                                 "Failed to create local buffer",
+                                 "Succeeded in creating local buffer"))
+    {
+        return false;
+    }
+
+    // the local buffer is movable, the defragmenter hands back a new handle bound to the new location
+    vra_defragmenter_->RegisterBuffer(test_local_buffer_,
+                                      test_local_buffer_allocation_,
+                                      test_local_buffer_create_info,
+                                      [this](const vra::VraRelocation& relocation)
+                                      {
+                                          // the allocation handle stays, its memory and offset changed with the move
+                                          test_local_buffer_ = relocation.new_buffer;
+                                          vmaGetAllocationInfo(vma_allocator_, relocation.allocation, &test_local_buffer_allocation_info_);
+                                      });
+    vra_statistics_reporter_->TrackBatch(vra::VraBuiltInBatchIds::GPU_Only,
+                                         test_local_host_batch_handle_[vra::VraBuiltInBatchIds::GPU_Only],
+                                         test_local_buffer_allocation_info_.size);
+
+    // upload once on the transfer queue, the first frame recording after it acquires the buffer
+    const auto& consolidated_data = test_local_host_batch_handle_[vra::VraBuiltInBatchIds::GPU_Only].consolidated_data;
+    vra::VraBufferUpload upload{};
+    upload.dst_buffer = test_local_buffer_;
+    upload.data       = consolidated_data.data();
+    upload.size       = consolidated_data.size();
+    if (!vra_upload_manager_->Enqueue(upload) || vra_upload_manager_->Submit() == 0)
+    {
+        Logger::LogError("Failed to upload local buffer");
+        destroy_local_buffer();
+        return false;
+    }
+    return true;
+}
+
+bool VulkanSample::destroy_local_buffer()
+{
+    // a buffer in the middle of a defragmentation pass is kept until the pass finishes
+    if (!vra_defragmenter_->UnregisterBuffer(test_local_buffer_allocation_))
+        return false;
+
+    // the current frame may still read it
+    vra_deletion_queue_->EnqueueBuffer(frame_serial_, vma_allocator_, test_local_buffer_, test_local_buffer_allocation_);
+    vra_statistics_reporter_->UntrackBatch(vra::VraBuiltInBatchIds::GPU_Only);
+    test_local_buffer_            = VK_NULL_HANDLE;
+    test_local_buffer_allocation_ = VK_NULL_HANDLE;
+    return true;
+}
+
+bool VulkanSample::create_mesh_index_buffer(uint32_t mesh_index)
+{
+    auto& mesh = mesh_residency_[mesh_index];
+
+    // 索引缓冲区创建信息
+    VkBufferCreateInfo index_buffer_create_info{};
+    index_buffer_create_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    index_buffer_create_info.size        = sizeof(uint32_t) * mesh.indices.size();
+    index_buffer_create_info.usage       = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    index_buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VmaAllocationCreateInfo allocation_create_info{};
+    allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+    if (!Logger::LogWithVkResult(vmaCreateBuffer(vma_allocator_,
+                                                 &index_buffer_create_info,
+                                                 &allocation_create_info,
+                                                 &mesh.index_buffer,
+                                                 &mesh.allocation,
+                                                 nullptr),
+                                 "Failed to create mesh index buffer",
+                                 "Succeeded in creating mesh index buffer"))
+    {
+        return false;
+    }
+
+    // uploaded on the transfer queue, the frame reloading the mesh acquires it before drawing
+    vra::VraBufferUpload upload{};
+    upload.dst_buffer = mesh.index_buffer;
+    upload.data       = mesh.indices.data();
+    upload.size       = index_buffer_create_info.size;
+    if (!vra_upload_manager_->Enqueue(upload) || vra_upload_manager_->Submit() == 0)
+    {
+        Logger::LogError("Failed to upload mesh index buffer");
+        destroy_mesh_index_buffer(mesh_index);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanSample::destroy_mesh_index_buffer(uint32_t mesh_index)
+{
+    // the current frame may still read it
+    auto& mesh = mesh_residency_[mesh_index];
+    vra_deletion_queue_->EnqueueBuffer(frame_serial_, vma_allocator_, mesh.index_buffer, mesh.allocation);
+    mesh.index_buffer = VK_NULL_HANDLE;
+    mesh.allocation   = VK_NULL_HANDLE;
+    return true;
 }
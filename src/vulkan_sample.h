@@ -9,17 +9,29 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <memory>
+#include <optional>
 
 #include "_gltf/gltf_data.h"
-#include "_old/vulkan_commandbuffer.h"
-#include "_old/vulkan_framebuffer.h"
+#include "_old/vulkan_command_allocator.h"
+#include "_old/vulkan_parallel_recorder.h"
 #include "_old/vulkan_pipeline.h"
-#include "_old/vulkan_renderpass.h"
+#include "_old/vulkan_pipeline_cache.h"
+#include "_old/vulkan_pipeline_library.h"
+#include "_old/vulkan_command_state.h"
+#include "_old/vulkan_shader_library.h"
+#include "_old/vulkan_shader_watcher.h"
 #include "_old/vulkan_shader.h"
 #include "_old/vulkan_synchronization.h"
 #include "_old/vulkan_window.h"
 #include "_templates/common.h"
+#include "_vra/deletion.h"
+#include "_vra/mapped_batch.h"
+#include "_vra/residency.h"
+#include "_vra/statistics.h"
 #include "_vra/vra.h"
 #include "utility/config_reader.h"
 
@@ -56,11 +68,26 @@ struct SEngineConfig
 struct SOutputFrame
 {
     uint32_t image_index;
-    std::string queue_id;
-    std::string command_buffer_id;
-    std::string image_available_semaphore_id;
-    std::string render_finished_semaphore_id;
-    std::string fence_id;
+    SVulkanSemaphoreHandle image_available_semaphore;
+    SVulkanSemaphoreHandle render_finished_semaphore;
+};
+
+// shaders reloaded from disk, swapped in with their pipeline once it is ready
+struct SShaderReload
+{
+    uint64_t pipeline_key        = VulkanPipelineLibrary::INVALID_KEY;
+    uint64_t vertex_shader_key   = VulkanShaderLibrary::INVALID_KEY;
+    uint64_t fragment_shader_key = VulkanShaderLibrary::INVALID_KEY;
+    std::vector<VkVertexInputAttributeDescription> vertex_attributes;
+};
+
+// indices of one mesh in a buffer of their own, the unit of residency, evicted and reloaded as a whole
+struct SMeshResidency
+{
+    std::vector<uint32_t> indices; // host copy, the index buffer is uploaded from it again after an eviction
+    VkBuffer index_buffer    = VK_NULL_HANDLE;
+    VmaAllocation allocation = VK_NULL_HANDLE;
+    bool drawable            = false; // resident for the frame being recorded, set before its draws are recorded
 };
 
 struct SMvpMatrix
@@ -145,7 +172,26 @@ private:
 #define FRAME_INDEX_TO_UNIFORM_BUFFER_ID(frame_index) (frame_index + 4)
     // engine members
     uint8_t frame_index_ = 0;
-    bool resize_request_ = false;
+    uint64_t frame_serial_     = 0; // serial of the frame being recorded, starts from 1
+    uint64_t completed_serial_ = 0; // serial of the last frame retired by the GPU
+    SVulkanSemaphoreHandle frame_timeline_semaphore_; // graphics queue timeline, signaled with the frame serial
+    // set from the SDL event watch as well, which may run on any thread
+    std::atomic<bool> resize_request_{false};
+    std::atomic<bool> redraw_request_{false};
+    bool drawing_ = false; // main thread only, keeps the event watch from nesting a Draw inside another
+
+    // frame times around swapchain recreation, the peak is reported once resizing settles
+    std::chrono::steady_clock::time_point last_draw_time_;
+    float steady_frame_time_ms_      = 0.0F; // moving average outside of resizes
+    float resize_peak_frame_time_ms_ = 0.0F;
+    uint32_t resize_report_countdown_ = 0;   // frames left until the peak is reported
+    static constexpr uint32_t kResizeReportFrames = 60;
+
+    // swapchains replaced by a resize, the frame timeline says nothing about presents still reading their images,
+    // they are destroyed frame_count frames after the first present on the current swapchain
+    std::vector<VkSwapchainKHR> retired_swapchains_;
+    uint64_t first_present_serial_ = 0; // serial of the first frame presented on the current swapchain, 0 until then
+
     EWindowState engine_state_;
     ERenderState render_state_;
     SEngineConfig engine_config_;
@@ -154,6 +200,10 @@ private:
 
     // mesh data members
     std::vector<gltf::PerMeshData> mesh_list_;
+    std::vector<VkDrawIndexedIndirectCommand> draw_list_; // every primitive of mesh_list_, in draw order
+    std::vector<SVulkanRasterState> draw_raster_states_;  // raster state of each entry of draw_list_
+    std::vector<uint32_t> draw_mesh_indices_;             // mesh of each entry of draw_list_
+    std::vector<SMeshResidency> mesh_residency_;          // one per entry of mesh_list_, registered under its index
     std::unordered_map<std::string, std::vector<vra::ResourceId>> mesh_vertex_resource_ids_;
     std::unordered_map<std::string, std::vector<vra::ResourceId>> mesh_index_resource_ids_;
     std::unordered_map<std::string, std::vector<VkDeviceSize>> mesh_vertex_offsets_;
@@ -162,44 +212,64 @@ private:
     // vra and vma members
     VmaAllocator vma_allocator_;
     VmaAllocation local_buffer_allocation_;
-    VmaAllocation staging_buffer_allocation_;
     VmaAllocation uniform_buffer_allocation_;
     VmaAllocationInfo local_buffer_allocation_info_;
-    VmaAllocationInfo staging_buffer_allocation_info_;
     VmaAllocationInfo uniform_buffer_allocation_info_;
 
     std::unique_ptr<vra::VraDataBatcher> vra_data_batcher_;
+    std::unique_ptr<vra::VraDefragmenter> vra_defragmenter_;
+    std::unique_ptr<vra::VraResidencyManager> vra_residency_manager_;
+    std::unique_ptr<vra::VraDescriptorAllocator> vra_descriptor_allocator_;
+    std::unique_ptr<vra::VraDescriptorCache> vra_descriptor_cache_;
+    std::unique_ptr<vra::VraBindlessTable> vra_bindless_table_;
+    std::unique_ptr<vra::VraUploadManager> vra_upload_manager_;
+    std::unique_ptr<vra::VraStatisticsReporter> vra_statistics_reporter_;
+    std::unique_ptr<vra::VraDeletionQueue> vra_deletion_queue_; // retired by the frame timeline
+    uint64_t pending_upload_value_ = 0; // upload timeline value the next graphics submit waits on
     std::map<vra::BatchId, vra::VraDataBatcher::VraBatchHandle> vertex_index_staging_batch_handle_;
     std::map<vra::BatchId, vra::VraDataBatcher::VraBatchHandle> uniform_batch_handle_;
     vra::ResourceId vertex_data_id_;
     vra::ResourceId index_data_id_;
-    vra::ResourceId staging_vertex_data_id_;
-    vra::ResourceId staging_index_data_id_;
     std::vector<vra::ResourceId> uniform_buffer_id_;
 
     // vulkan native members
     VkBuffer local_buffer_;
-    VkBuffer staging_buffer_;
     VkBuffer uniform_buffer_;
-    VkDescriptorPool descriptor_pool_;
     VkDescriptorSetLayout descriptor_set_layout_;
     VkDescriptorSet descriptor_set_;
+    std::vector<vra::VraDescriptorBinding> descriptor_bindings_;
     VkVertexInputBindingDescription vertex_input_binding_description_;
     VkVertexInputAttributeDescription vertex_input_attribute_position_;
     VkVertexInputAttributeDescription vertex_input_attribute_color_;
 
     // vulkan helper members
     std::unique_ptr<VulkanSDLWindowHelper> vk_window_helper_;
-    std::unique_ptr<VulkanShaderHelper> vk_shader_helper_;
-    std::unique_ptr<VulkanRenderpassHelper> vk_renderpass_helper_;
-    std::unique_ptr<VulkanPipelineHelper> vk_pipeline_helper_;
-    std::unique_ptr<VulkanCommandBufferHelper> vk_command_buffer_helper_;
-    std::unique_ptr<VulkanFrameBufferHelper> vk_frame_buffer_helper_;
+    std::unique_ptr<VulkanShaderLibrary> vk_shader_library_;
+    std::unique_ptr<VulkanDescriptorSetLayoutCache> vk_set_layout_cache_;
+    uint64_t vertex_shader_key_   = VulkanShaderLibrary::INVALID_KEY;
+    uint64_t fragment_shader_key_ = VulkanShaderLibrary::INVALID_KEY;
+    const SVulkanShaderReflection* vertex_shader_reflection_   = nullptr; // owned by vk_shader_library_
+    const SVulkanShaderReflection* fragment_shader_reflection_ = nullptr;
+    std::filesystem::path vertex_shader_path_;
+    std::filesystem::path fragment_shader_path_;
+    std::unique_ptr<VulkanShaderWatcher> vk_shader_watcher_; // hot reload, recompiles edited GLSL in the background
+    std::optional<SShaderReload> pending_shader_reload_;
+    std::vector<uint64_t> retiring_shader_keys_; // replaced or rejected by a reload, destroyed once no compile reads them
+    std::unique_ptr<VulkanPipelineCache> vk_pipeline_cache_;
+    std::unique_ptr<VulkanPipelineLibrary> vk_pipeline_library_;
+    uint64_t pipeline_key_                       = VulkanPipelineLibrary::INVALID_KEY;
+    const VulkanPipelineHelper* active_pipeline_ = nullptr; // resolved once per frame before recording
+    bool graphics_pipeline_library_supported_    = false;   // VK_EXT_graphics_pipeline_library enabled on the device
+    SVulkanDynamicStateConfig dynamic_state_config_;        // dynamic state extensions enabled on the device
+    SVulkanDynamicStateFunctions dynamic_state_functions_;
+    std::unique_ptr<VulkanCommandAllocator> vk_command_allocator_;
     std::unique_ptr<VulkanSynchronizationHelper> vk_synchronization_helper_;
+    std::unique_ptr<VulkanParallelRecorder> vk_parallel_recorder_;
+    std::vector<VkCommandBuffer> secondary_command_buffers_;
 
     // uniform data
     std::vector<SMvpMatrix> mvp_matrices_;
-    void* uniform_buffer_mapped_data_;
+    std::unique_ptr<vra::VraMappedBatch> uniform_mapped_batch_; // persistently mapped uniform batch
 
     // Input handling members
     float last_x_ = 0.0F;
@@ -219,24 +289,40 @@ private:
     bool create_surface();
     bool create_physical_device();
     bool create_logical_device();
+    void query_optional_device_features();
     bool create_swapchain();
     bool create_depth_resources();
-    bool create_frame_buffer();
+    bool create_shaders();
     bool create_pipeline();
+    SVulkanPipelineConfig make_pipeline_config(uint64_t vertex_shader_key,
+                                               uint64_t fragment_shader_key,
+                                               const std::vector<VkVertexInputAttributeDescription>& vertex_attributes) const;
     bool create_command_pool();
     bool create_and_write_descriptor_relatives();
     bool create_vma_vra_objects();
-    void create_drawcall_list_buffer();
+    bool create_drawcall_list_buffer();
+    bool create_local_buffer();
+    bool destroy_local_buffer();
+    bool create_mesh_index_buffer(uint32_t mesh_index);
+    bool destroy_mesh_index_buffer(uint32_t mesh_index);
     bool create_uniform_buffers();
-    
-    bool allocate_per_frame_command_buffer();
     bool create_synchronization_objects();
     // ------------------------------------
 
     // --- Vulkan Draw Steps ---
     void draw_frame();
+    void abandon_frame(VkSemaphore image_available_semaphore);
     void resize_swapchain();
-    bool record_command(uint32_t image_index, const std::string& command_buffer_id);
+    void destroy_retired_swapchains(bool device_idle);
+    void track_frame_time();
+    void reload_shaders();
+    bool check_uniform_block(const SVulkanShaderReflection& reflection) const;
+    void retire_shader(uint64_t shader_key);
+    void collect_retired_shaders();
+    void retire_pipelines(std::vector<std::unique_ptr<VulkanPipelineHelper>> pipelines);
+    static bool live_resize_event_watch(void* userdata, SDL_Event* event);
+    bool record_command(uint32_t image_index, VkCommandBuffer command_buffer);
+    void record_draws(VkCommandBuffer command_buffer, uint32_t first_draw, uint32_t draw_count);
     void update_uniform_buffer(uint32_t current_frame_index);
     // -------------------------
 
@@ -252,7 +338,7 @@ private:
     VkDevice comm_vk_logical_device_;
     VkQueue comm_vk_graphics_queue_;
     VkQueue comm_vk_transfer_queue_;
-    VkSwapchainKHR comm_vk_swapchain_;
+    VkSwapchainKHR comm_vk_swapchain_ = VK_NULL_HANDLE;
     templates::common::CommVkInstanceContext comm_vk_instance_context_;
     templates::common::CommVkPhysicalDeviceContext comm_vk_physical_device_context_;
     templates::common::CommVkLogicalDeviceContext comm_vk_logical_device_context_;
@@ -264,24 +350,17 @@ private:
     std::vector<gltf::Vertex> vertices_;
 
     VkBuffer test_local_buffer_;
-    VkBuffer test_staging_buffer_;
     VkVertexInputBindingDescription test_vertex_input_binding_description_;
     std::vector<VkVertexInputAttributeDescription> test_vertex_input_attributes_;
+    std::vector<VkVertexInputAttributeDescription> available_vertex_attributes_; // every attribute gltf::Vertex provides
     VmaAllocation test_local_buffer_allocation_;
-    VmaAllocation test_staging_buffer_allocation_;
     VmaAllocationInfo test_local_buffer_allocation_info_;
-    VmaAllocationInfo test_staging_buffer_allocation_info_;
 
     vra::ResourceId test_vertex_buffer_id_;
-    vra::ResourceId test_index_buffer_id_;
-    vra::ResourceId test_staging_vertex_buffer_id_;
-    vra::ResourceId test_staging_index_buffer_id_;
 
     std::map<vra::BatchId, vra::VraDataBatcher::VraBatchHandle> test_local_host_batch_handle_;
     std::map<vra::BatchId, vra::VraDataBatcher::VraBatchHandle> test_uniform_batch_handle_;
 
-    
-
     // 深度资源相关成员
     VkImage depth_image_          = VK_NULL_HANDLE;
     VkDeviceMemory depth_memory_  = VK_NULL_HANDLE;
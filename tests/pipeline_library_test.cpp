@@ -0,0 +1,234 @@
+#include "_old/vulkan_pipeline_library.h"
+#include "_old/vulkan_shader_library.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+// builds the four graphics pipeline library parts through the fallback, then requests variants so that one is
+// built by a worker from a new part and one is fast linked on the calling thread from existing parts,
+// both must end up replaced by their optimized relink
+
+namespace
+{
+    int g_failures = 0;
+
+    void check(bool condition, const char *message)
+    {
+        if (!condition)
+        {
+            std::cerr << "pipeline_library_test: " << message << std::endl;
+            ++g_failures;
+        }
+    }
+
+    bool has_extension(VkPhysicalDevice physical_device, const char *name)
+    {
+        uint32_t count = 0;
+        vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &count, nullptr);
+        std::vector<VkExtensionProperties> extensions(count);
+        vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &count, extensions.data());
+        for (const auto &extension : extensions)
+        {
+            if (std::strcmp(extension.extensionName, name) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    bool supports_library(VkPhysicalDevice physical_device)
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_3 ||
+            !has_extension(physical_device, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) ||
+            !has_extension(physical_device, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+            return false;
+
+        VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT library_features{};
+        library_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+        VkPhysicalDeviceVulkan13Features features_13{};
+        features_13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+        features_13.pNext = &library_features;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &features_13;
+        vkGetPhysicalDeviceFeatures2(physical_device, &features);
+        return features_13.dynamicRendering && library_features.graphicsPipelineLibrary;
+    }
+
+    // the pending count drops to zero once every relink has been stored
+    bool wait_idle(const VulkanPipelineLibrary &library)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (library.GetPendingCount() != 0)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    void run(VkDevice device)
+    {
+        VulkanShaderLibrary shader_library(device);
+        std::vector<uint64_t> shader_keys;
+        std::vector<SVulkanShaderConfig> shader_configs = {
+            {EShaderType::kVertexShader, SHADER_DIRECTORY "triangle.vert.spv"},
+            {EShaderType::kFragmentShader, SHADER_DIRECTORY "triangle.frag.spv"}};
+        if (!shader_library.LoadShaders(shader_configs, shader_keys))
+        {
+            check(false, "failed to load the triangle shaders");
+            return;
+        }
+
+        const SVulkanShaderReflection *vertex_reflection = shader_library.GetReflection(shader_keys[0]);
+        const SVulkanShaderReflection *fragment_reflection = shader_library.GetReflection(shader_keys[1]);
+        std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> set_bindings;
+        if (!VulkanShaderReflection::MergeSetLayouts({vertex_reflection, fragment_reflection}, set_bindings))
+        {
+            check(false, "failed to merge the set layouts");
+            return;
+        }
+
+        VulkanDescriptorSetLayoutCache layout_cache(device);
+        SVulkanPipelineConfig config{};
+        config.swap_chain_extent = {64, 64};
+        config.shader_module_map = {{EShaderType::kVertexShader, shader_library.GetModule(shader_keys[0])},
+                                    {EShaderType::kFragmentShader, shader_library.GetModule(shader_keys[1])}};
+        config.color_attachment_formats = {VK_FORMAT_R8G8B8A8_UNORM};
+        config.depth_attachment_format = VK_FORMAT_D32_SFLOAT;
+        for (const auto &[set, bindings] : set_bindings)
+            config.descriptor_set_layouts.push_back(layout_cache.GetOrCreate(bindings));
+        config.push_constant_ranges = VulkanShaderReflection::MergePushConstantRanges({vertex_reflection, fragment_reflection});
+
+        // vec2 position and vec3 color, interleaved
+        config.vertex_input_binding_description = {0, 5 * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX};
+        std::vector<VkVertexInputAttributeDescription> available = {
+            {0, 0, VK_FORMAT_R32G32_SFLOAT, 0},
+            {1, 0, VK_FORMAT_R32G32B32_SFLOAT, 2 * sizeof(float)}};
+        check(VulkanShaderReflection::SelectVertexAttributes(*vertex_reflection, available, config.vertex_input_attribute_descriptions),
+              "the vertex format does not cover the triangle shader");
+
+        VulkanPipelineLibrary library(device, VK_NULL_HANDLE, {.thread_count = 2, .use_graphics_pipeline_library = true});
+        library.Initialize();
+
+        // the fallback builds the four parts next to its monolithic pipeline
+        uint64_t fallback_key = library.SetFallback(config);
+        check(fallback_key != VulkanPipelineLibrary::INVALID_KEY, "failed to compile the fallback");
+        if (fallback_key == VulkanPipelineLibrary::INVALID_KEY)
+            return;
+        check(library.Request(config) == fallback_key, "requesting the fallback state gave another key");
+
+        // another cull mode needs a new pre-rasterization part, built and linked by a worker
+        SVulkanPipelineConfig culled = config;
+        culled.cull_mode = VK_CULL_MODE_NONE;
+        // blending needs a new fragment output part
+        SVulkanPipelineConfig blended = config;
+        blended.blend_enable = VK_TRUE;
+        uint64_t culled_key = library.Request(culled);
+        uint64_t blended_key = library.Request(blended);
+        check(wait_idle(library), "worker builds did not finish");
+        check(library.IsReady(culled_key) && library.IsReady(blended_key), "worker built variants are not ready");
+        check(!library.HasFailed(culled_key) && !library.HasFailed(blended_key), "a worker built variant failed");
+
+        // both parts exist now, this combination is fast linked before Request returns
+        SVulkanPipelineConfig combined = culled;
+        combined.blend_enable = VK_TRUE;
+        uint64_t combined_key = library.Request(combined);
+        check(combined_key != culled_key && combined_key != blended_key, "the combined variant shares a key");
+        check(library.IsReady(combined_key), "the combined variant was not fast linked on the calling thread");
+        VkPipeline fast_linked = library.Get(combined_key)->GetPipeline();
+        check(fast_linked != VK_NULL_HANDLE, "the fast linked variant has no pipeline");
+        check(fast_linked != library.Get(fallback_key)->GetPipeline(), "the fast linked variant resolved to the fallback");
+
+        // requesting it again while the relink is pending neither links nor queues it twice
+        check(library.Request(combined) == combined_key, "a second request changed the key");
+
+        check(wait_idle(library), "the optimized relink did not finish");
+        check(library.IsReady(combined_key) && !library.HasFailed(combined_key), "the relinked variant is not ready");
+        check(library.Get(combined_key)->GetPipeline() != fast_linked, "the fast linked variant was not replaced by its relink");
+    }
+}
+
+int main()
+{
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "pipeline_library_test";
+    app_info.apiVersion = VK_API_VERSION_1_3;
+
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&instance_info, nullptr, &instance) != VK_SUCCESS)
+    {
+        std::cerr << "pipeline_library_test: no vulkan 1.3 instance, skipped" << std::endl;
+        return 77;
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(instance, &device_count, nullptr);
+    std::vector<VkPhysicalDevice> physical_devices(device_count);
+    vkEnumeratePhysicalDevices(instance, &device_count, physical_devices.data());
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    for (auto candidate : physical_devices)
+    {
+        if (supports_library(candidate))
+        {
+            physical_device = candidate;
+            break;
+        }
+    }
+    if (physical_device == VK_NULL_HANDLE)
+    {
+        std::cerr << "pipeline_library_test: no device with graphics pipeline library, skipped" << std::endl;
+        vkDestroyInstance(instance, nullptr);
+        return 77;
+    }
+
+    // pipelines are never submitted, any queue will do
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = 0;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT library_features{};
+    library_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    library_features.graphicsPipelineLibrary = VK_TRUE;
+    VkPhysicalDeviceVulkan13Features features_13{};
+    features_13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    features_13.pNext = &library_features;
+    features_13.dynamicRendering = VK_TRUE;
+
+    const char *device_extensions[] = {VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME};
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.pNext = &features_13;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.enabledExtensionCount = 2;
+    device_info.ppEnabledExtensionNames = device_extensions;
+
+    VkDevice device = VK_NULL_HANDLE;
+    if (vkCreateDevice(physical_device, &device_info, nullptr, &device) != VK_SUCCESS)
+    {
+        std::cerr << "pipeline_library_test: failed to create the device, skipped" << std::endl;
+        vkDestroyInstance(instance, nullptr);
+        return 77;
+    }
+
+    run(device);
+
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(instance, nullptr);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include "_rendergraph/render_graph.h"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// time setup, compile and execute of a frame with thousands of passes, the allocator only hands out counters
+
+namespace
+{
+    constexpr uint32_t kPassCount = 5000;
+    constexpr uint32_t kIterations = 10;
+
+    const rg::RgTextureDesc kTextureDesc{.width = 1920, .height = 1080, .format = 37};
+
+    using Clock = std::chrono::steady_clock;
+
+    double elapsed_ms(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void build(rg::RgRenderGraph &graph, uint32_t &executed)
+    {
+        rg::RgResourceHandle backbuffer = graph.ImportTexture("backbuffer", kTextureDesc, 0xB000);
+        std::vector<rg::RgResourceHandle> outputs;
+        outputs.reserve(kPassCount);
+        for (uint32_t i = 0; i < kPassCount; ++i)
+        {
+            // a long chain with skip connections, every 64th pass composites into the backbuffer
+            graph.AddPass("pass_" + std::to_string(i), [&](rg::RgPassBuilder &builder)
+                          {
+                              if (i >= 1)
+                              {
+                                  builder.Read(outputs[i - 1]);
+                              }
+                              if (i >= 7)
+                              {
+                                  builder.Read(outputs[i - 7]);
+                              }
+                              outputs.push_back(builder.CreateTexture("target_" + std::to_string(i), kTextureDesc));
+                              if (i % 64 == 63)
+                              {
+                                  backbuffer = builder.Write(backbuffer);
+                              }
+                              if (i == kPassCount - 1)
+                              {
+                                  builder.SetSideEffect();
+                              }
+                          },
+                          [&executed](const rg::RgPassResources &) { ++executed; });
+        }
+    }
+}
+
+int main()
+{
+    rg::RgPhysicalResource next = 1;
+    uint32_t live = 0;
+    rg::RgResourceAllocator allocator;
+    allocator.create_texture = [&](const std::string &, const rg::RgTextureDesc &)
+    {
+        ++live;
+        return next++;
+    };
+    allocator.destroy = [&](rg::RgResourceType, rg::RgPhysicalResource) { --live; };
+
+    rg::RgRenderGraph graph;
+    double build_ms = 0.0;
+    double compile_ms = 0.0;
+    double execute_ms = 0.0;
+    for (uint32_t iteration = 0; iteration < kIterations; ++iteration)
+    {
+        graph.Reset();
+        uint32_t executed = 0;
+
+        auto start_time = Clock::now();
+        build(graph, executed);
+        build_ms += elapsed_ms(start_time);
+
+        start_time = Clock::now();
+        if (!graph.Compile())
+        {
+            std::cerr << "render_graph_benchmark: graph of " << kPassCount << " passes failed to compile" << std::endl;
+            return 1;
+        }
+        compile_ms += elapsed_ms(start_time);
+
+        start_time = Clock::now();
+        if (!graph.Execute(allocator) || executed != kPassCount || live != 0)
+        {
+            std::cerr << "render_graph_benchmark: graph of " << kPassCount << " passes did not execute cleanly" << std::endl;
+            return 1;
+        }
+        execute_ms += elapsed_ms(start_time);
+    }
+
+    std::cout << "render_graph_benchmark: " << kPassCount << " passes, " << graph.GetResourceCount() << " resources, average over "
+              << kIterations << " frames" << std::endl;
+    std::cout << "  setup   " << build_ms / kIterations << " ms" << std::endl;
+    std::cout << "  compile " << compile_ms / kIterations << " ms" << std::endl;
+    std::cout << "  execute " << execute_ms / kIterations << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,272 @@
+#include "_rendergraph/render_graph.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// compile and execute small graphs without a graphics API, the allocator hands out counters as resources
+
+namespace
+{
+    int g_failures = 0;
+
+    void check(bool condition, const char *message)
+    {
+        if (!condition)
+        {
+            std::cerr << "render_graph_test: " << message << std::endl;
+            ++g_failures;
+        }
+    }
+
+    const rg::RgTextureDesc kTextureDesc{.width = 64, .height = 64, .format = 37};
+    const rg::RgBufferDesc kBufferDesc{.size = 256};
+    constexpr rg::RgPhysicalResource kBackbuffer = 0xB000;
+
+    struct CountingAllocator
+    {
+        rg::RgPhysicalResource next = 1;
+        std::vector<rg::RgPhysicalResource> alive;
+        uint32_t created = 0;
+        uint32_t destroyed = 0;
+
+        rg::RgResourceAllocator Get(bool with_buffers = true)
+        {
+            rg::RgResourceAllocator allocator;
+            allocator.create_texture = [this](const std::string &, const rg::RgTextureDesc &) { return create(); };
+            if (with_buffers)
+            {
+                allocator.create_buffer = [this](const std::string &, const rg::RgBufferDesc &) { return create(); };
+            }
+            allocator.destroy = [this](rg::RgResourceType, rg::RgPhysicalResource resource)
+            {
+                ++destroyed;
+                alive.erase(std::remove(alive.begin(), alive.end(), resource), alive.end());
+            };
+            return allocator;
+        }
+
+        rg::RgPhysicalResource create()
+        {
+            ++created;
+            alive.push_back(next);
+            return next++;
+        }
+    };
+
+    uint32_t position_of(const rg::RgRenderGraph &graph, uint32_t pass)
+    {
+        const auto &order = graph.GetExecutionOrder();
+        return static_cast<uint32_t>(std::find(order.begin(), order.end(), pass) - order.begin());
+    }
+
+    void test_culling()
+    {
+        rg::RgRenderGraph graph;
+        rg::RgResourceHandle backbuffer = graph.ImportTexture("backbuffer", kTextureDesc, kBackbuffer);
+
+        // nothing reads the chain's output
+        rg::RgResourceHandle unread;
+        uint32_t unread_producer = graph.AddPass("unread_producer", [&](rg::RgPassBuilder &builder)
+                                                 { unread = builder.CreateTexture("unread", kTextureDesc); }, nullptr);
+        uint32_t unread_consumer = graph.AddPass("unread_consumer", [&](rg::RgPassBuilder &builder)
+                                                 {
+                                                     builder.Read(unread);
+                                                     builder.CreateBuffer("unread_result", kBufferDesc);
+                                                 }, nullptr);
+
+        // kept because it writes the imported backbuffer, and so is the pass it reads from
+        rg::RgResourceHandle gbuffer;
+        uint32_t gbuffer_pass = graph.AddPass("gbuffer", [&](rg::RgPassBuilder &builder)
+                                              { gbuffer = builder.CreateTexture("gbuffer", kTextureDesc); }, nullptr);
+        uint32_t lighting_pass = graph.AddPass("lighting", [&](rg::RgPassBuilder &builder)
+                                               {
+                                                   builder.Read(gbuffer);
+                                                   builder.Write(backbuffer);
+                                               }, nullptr);
+
+        // kept for its side effect alone
+        uint32_t readback_pass = graph.AddPass("readback", [](rg::RgPassBuilder &builder) { builder.SetSideEffect(); }, nullptr);
+
+        check(graph.Compile(), "culling graph failed to compile");
+        check(graph.IsPassCulled(unread_producer) && graph.IsPassCulled(unread_consumer), "a pass nothing reads was kept");
+        check(!graph.IsPassCulled(lighting_pass), "the writer of an imported resource was culled");
+        check(!graph.IsPassCulled(gbuffer_pass), "a pass read by a root was culled");
+        check(!graph.IsPassCulled(readback_pass), "a side effect pass was culled");
+        check(graph.GetExecutionOrder().size() == 3, "culled passes are in the execution order");
+
+        // a culled resource has no lifetime, nothing is created for it
+        uint32_t first_use = 0;
+        uint32_t last_use = 0;
+        check(!graph.GetResourceLifetime(unread, first_use, last_use), "a culled resource has a lifetime");
+        CountingAllocator allocator;
+        check(graph.Execute(allocator.Get()), "culling graph failed to execute");
+        check(allocator.created == 1 && allocator.destroyed == 1 && allocator.alive.empty(), "only the gbuffer should be realized");
+    }
+
+    void test_ordering()
+    {
+        rg::RgRenderGraph graph;
+        rg::RgResourceHandle backbuffer = graph.ImportTexture("backbuffer", kTextureDesc, kBackbuffer);
+
+        // declared in an order that differs from the one the dependencies force
+        rg::RgResourceHandle history;
+        rg::RgResourceHandle history_v1;
+        std::vector<uint32_t> executed;
+        uint32_t create_pass = graph.AddPass("create", [&](rg::RgPassBuilder &builder)
+                                             { history = builder.CreateTexture("history", kTextureDesc); },
+                                             [&](const rg::RgPassResources &) { executed.push_back(0); });
+        rg::RgPhysicalResource seen_by_read = 0;
+        uint32_t read_pass = graph.AddPass("read", [&](rg::RgPassBuilder &builder)
+                                           {
+                                               builder.Read(history);
+                                               backbuffer = builder.Write(backbuffer);
+                                           },
+                                           [&](const rg::RgPassResources &resources)
+                                           {
+                                               executed.push_back(1);
+                                               seen_by_read = resources.Get(history);
+                                           });
+        // write after read, the reader of the previous version has to run first
+        uint32_t overwrite_pass = graph.AddPass("overwrite", [&](rg::RgPassBuilder &builder)
+                                                { history_v1 = builder.Write(history); },
+                                                [&](const rg::RgPassResources &) { executed.push_back(2); });
+        rg::RgPhysicalResource backbuffer_seen = 0;
+        uint32_t present_pass = graph.AddPass("present", [&](rg::RgPassBuilder &builder)
+                                              {
+                                                  builder.Read(history_v1);
+                                                  builder.Write(backbuffer);
+                                              },
+                                              [&](const rg::RgPassResources &resources)
+                                              {
+                                                  executed.push_back(3);
+                                                  backbuffer_seen = resources.Get(backbuffer);
+                                              });
+
+        check(history_v1.IsValid() && history_v1 != history, "a write did not produce a new version");
+        check(graph.Compile(), "ordering graph failed to compile");
+        check(graph.GetExecutionOrder().size() == 4, "ordering graph lost a pass");
+        check(position_of(graph, create_pass) < position_of(graph, read_pass), "read after write is out of order");
+        check(position_of(graph, read_pass) < position_of(graph, overwrite_pass), "write after read is out of order");
+        check(position_of(graph, overwrite_pass) < position_of(graph, present_pass), "read of the new version is out of order");
+        check(graph.GetPassLevel(create_pass) == 0 && graph.GetPassLevel(read_pass) == 1 && graph.GetPassLevel(overwrite_pass) == 2 &&
+                  graph.GetPassLevel(present_pass) == 3,
+              "dependency levels do not follow the chain");
+
+        // every version of the history spans the whole chain, the backbuffer from its first writer on
+        uint32_t first_use = 0;
+        uint32_t last_use = 0;
+        check(graph.GetResourceLifetime(history, first_use, last_use) && first_use == 0 && last_use == 3,
+              "history lifetime does not span create to present");
+        check(graph.GetResourceLifetime(history_v1, first_use, last_use) && first_use == 0 && last_use == 3,
+              "versions of one resource do not share its lifetime");
+        check(graph.GetResourceLifetime(backbuffer, first_use, last_use) && first_use == 1 && last_use == 3,
+              "backbuffer lifetime does not start at its first writer");
+
+        CountingAllocator allocator;
+        check(graph.Execute(allocator.Get()), "ordering graph failed to execute");
+        check(executed == std::vector<uint32_t>({0, 1, 2, 3}), "callbacks did not run in the execution order");
+        check(seen_by_read != 0, "a pass did not see the realized resource");
+        check(backbuffer_seen == kBackbuffer, "an imported resource did not resolve to its own object");
+        check(allocator.created == 1 && allocator.destroyed == 1 && allocator.alive.empty(), "transient history leaked or was realized twice");
+    }
+
+    void test_cycle()
+    {
+        rg::RgRenderGraph graph;
+        rg::RgResourceHandle version_0;
+        rg::RgResourceHandle version_1;
+        graph.AddPass("create", [&](rg::RgPassBuilder &builder) { version_0 = builder.CreateTexture("target", kTextureDesc); }, nullptr);
+        graph.AddPass("overwrite", [&](rg::RgPassBuilder &builder) { version_1 = builder.Write(version_0); }, nullptr);
+        // reads the version the overwrite replaces and the one it produces, it would have to run before and after it
+        graph.AddPass("both", [&](rg::RgPassBuilder &builder)
+                      {
+                          builder.Read(version_0);
+                          builder.Read(version_1);
+                          builder.SetSideEffect();
+                      }, nullptr);
+
+        std::ostringstream report;
+        auto *previous_buffer = std::cerr.rdbuf(report.rdbuf());
+        bool compiled = graph.Compile();
+        CountingAllocator allocator;
+        bool executed = graph.Execute(allocator.Get());
+        std::cerr.rdbuf(previous_buffer);
+
+        check(!compiled, "a cyclic graph compiled");
+        check(report.str().find("cycle") != std::string::npos, "the cycle was not reported");
+        check(graph.GetExecutionOrder().empty(), "a cyclic graph kept a partial execution order");
+        check(!executed && allocator.created == 0, "a graph that failed to compile executed");
+    }
+
+    void test_outdated_write()
+    {
+        rg::RgRenderGraph graph;
+        rg::RgResourceHandle version_0;
+        rg::RgResourceHandle forked;
+        graph.AddPass("create", [&](rg::RgPassBuilder &builder) { version_0 = builder.CreateTexture("target", kTextureDesc); }, nullptr);
+        graph.AddPass("overwrite", [&](rg::RgPassBuilder &builder) { builder.Write(version_0); }, nullptr);
+
+        std::ostringstream report;
+        auto *previous_buffer = std::cerr.rdbuf(report.rdbuf());
+        graph.AddPass("fork", [&](rg::RgPassBuilder &builder)
+                      {
+                          forked = builder.Write(version_0);
+                          builder.SetSideEffect();
+                      }, nullptr);
+        bool compiled = graph.Compile();
+        std::cerr.rdbuf(previous_buffer);
+
+        check(!forked.IsValid(), "a write to an outdated version returned a handle");
+        check(report.str().find("outdated") != std::string::npos, "the outdated write was not reported");
+        check(!compiled, "a graph with an outdated write compiled");
+
+        // Reset starts over with a clean setup
+        graph.Reset();
+        graph.AddPass("side_effect", [](rg::RgPassBuilder &builder) { builder.SetSideEffect(); }, nullptr);
+        check(graph.Compile(), "a reset graph did not compile");
+    }
+
+    void test_failed_execute()
+    {
+        // the buffer cannot be realized, the texture realized before it must not leak
+        rg::RgRenderGraph graph;
+        rg::RgResourceHandle texture;
+        rg::RgResourceHandle buffer;
+        graph.AddPass("texture", [&](rg::RgPassBuilder &builder) { texture = builder.CreateTexture("texture", kTextureDesc); }, nullptr);
+        graph.AddPass("buffer", [&](rg::RgPassBuilder &builder)
+                      {
+                          builder.Read(texture);
+                          buffer = builder.CreateBuffer("buffer", kBufferDesc);
+                      }, nullptr);
+        graph.AddPass("consume", [&](rg::RgPassBuilder &builder)
+                      {
+                          builder.Read(texture);
+                          builder.Read(buffer);
+                          builder.SetSideEffect();
+                      }, nullptr);
+        check(graph.Compile(), "failed execute graph did not compile");
+
+        CountingAllocator allocator;
+        std::ostringstream report;
+        auto *previous_buffer = std::cerr.rdbuf(report.rdbuf());
+        bool executed = graph.Execute(allocator.Get(false));
+        std::cerr.rdbuf(previous_buffer);
+
+        check(!executed, "execute succeeded without a buffer allocator");
+        check(allocator.created == 1, "the texture was not realized before the failure");
+        check(allocator.alive.empty() && allocator.destroyed == allocator.created, "an aborted execute leaked a realized transient");
+    }
+}
+
+int main()
+{
+    test_culling();
+    test_ordering();
+    test_cycle();
+    test_outdated_write();
+    test_failed_execute();
+    return g_failures == 0 ? 0 : 1;
+}
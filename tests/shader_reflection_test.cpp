@@ -0,0 +1,479 @@
+#include "_old/vulkan_shader_library.h"
+#include "_old/vulkan_shader_reflection.h"
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// hand assembled SPIR-V fixtures, a vertex shader touching every kind of resource the reflection reports
+// and truncated instructions that must reject the module instead of reading past it,
+// the shader library cases need a device to create modules and are skipped without one
+
+namespace
+{
+    int g_failures = 0;
+
+    void check(bool condition, const char *message)
+    {
+        if (!condition)
+        {
+            std::cerr << "shader_reflection_test: " << message << std::endl;
+            ++g_failures;
+        }
+    }
+
+    constexpr uint32_t kOpName = 5;
+    constexpr uint32_t kOpMemoryModel = 14;
+    constexpr uint32_t kOpEntryPoint = 15;
+    constexpr uint32_t kOpCapability = 17;
+    constexpr uint32_t kOpTypeVoid = 19;
+    constexpr uint32_t kOpTypeInt = 21;
+    constexpr uint32_t kOpTypeFloat = 22;
+    constexpr uint32_t kOpTypeVector = 23;
+    constexpr uint32_t kOpTypeMatrix = 24;
+    constexpr uint32_t kOpTypeImage = 25;
+    constexpr uint32_t kOpTypeSampledImage = 27;
+    constexpr uint32_t kOpTypeArray = 28;
+    constexpr uint32_t kOpTypeRuntimeArray = 29;
+    constexpr uint32_t kOpTypeStruct = 30;
+    constexpr uint32_t kOpTypePointer = 32;
+    constexpr uint32_t kOpTypeFunction = 33;
+    constexpr uint32_t kOpConstant = 43;
+    constexpr uint32_t kOpSpecConstant = 50;
+    constexpr uint32_t kOpFunction = 54;
+    constexpr uint32_t kOpFunctionEnd = 56;
+    constexpr uint32_t kOpVariable = 59;
+    constexpr uint32_t kOpLoad = 61;
+    constexpr uint32_t kOpDecorate = 71;
+    constexpr uint32_t kOpMemberDecorate = 72;
+    constexpr uint32_t kOpLabel = 248;
+    constexpr uint32_t kOpReturn = 253;
+
+    constexpr uint32_t kDecorationSpecId = 1;
+    constexpr uint32_t kDecorationBlock = 2;
+    constexpr uint32_t kDecorationArrayStride = 6;
+    constexpr uint32_t kDecorationMatrixStride = 7;
+    constexpr uint32_t kDecorationLocation = 30;
+    constexpr uint32_t kDecorationBinding = 33;
+    constexpr uint32_t kDecorationDescriptorSet = 34;
+    constexpr uint32_t kDecorationOffset = 35;
+
+    constexpr uint32_t kStorageUniformConstant = 0;
+    constexpr uint32_t kStorageInput = 1;
+    constexpr uint32_t kStorageUniform = 2;
+    constexpr uint32_t kStoragePushConstant = 9;
+    constexpr uint32_t kStorageStorageBuffer = 12;
+
+    enum EId : uint32_t
+    {
+        kVoid = 1,
+        kFunctionType,
+        kFloat,
+        kUint,
+        kVec2,
+        kVec4,
+        kMat2,
+        kMat4,
+        kFour,
+        kImage,
+        kSampledImage,
+        kSampledImageArray,
+        kCameraStruct,
+        kCameraPointer,
+        kCamera,
+        kFloatRuntimeArray,
+        kParticlesStruct,
+        kParticlesPointer,
+        kParticles,
+        kTexturesPointer,
+        kTextures,
+        kPushStruct,
+        kPushPointer,
+        kPush,
+        kVec2InputPointer,
+        kVec4InputPointer,
+        kUintInputPointer,
+        kMat2InputPointer,
+        kPosition,
+        kColor,
+        kIndex,
+        kTransform,
+        kSpecA,
+        kSpecB,
+        kMain,
+        kLabel,
+        kLoadedPosition,
+        kLoadedColor,
+        kBound,
+    };
+
+    class SpirvAssembler
+    {
+    public:
+        SpirvAssembler() : words_{0x07230203, 0x00010300, 0, kBound, 0} {}
+
+        void op(uint32_t opcode, std::initializer_list<uint32_t> operands)
+        {
+            words_.push_back(static_cast<uint32_t>(operands.size() + 1) << 16 | opcode);
+            words_.insert(words_.end(), operands);
+        }
+
+        // literal string packed four characters per word and nul terminated, followed by more operands
+        void op_string(uint32_t opcode, std::initializer_list<uint32_t> before, const char *text, std::initializer_list<uint32_t> after = {})
+        {
+            std::vector<uint32_t> packed((std::strlen(text) + 4) / 4, 0);
+            std::memcpy(packed.data(), text, std::strlen(text));
+            words_.push_back(static_cast<uint32_t>(before.size() + packed.size() + after.size() + 1) << 16 | opcode);
+            words_.insert(words_.end(), before);
+            words_.insert(words_.end(), packed.begin(), packed.end());
+            words_.insert(words_.end(), after);
+        }
+
+        // a header word claiming word_count words, followed by the words that are really there
+        void raw(uint32_t opcode, uint32_t word_count, std::initializer_list<uint32_t> operands)
+        {
+            words_.push_back(word_count << 16 | opcode);
+            words_.insert(words_.end(), operands);
+        }
+
+        const std::vector<uint32_t> &words() const { return words_; }
+
+    private:
+        std::vector<uint32_t> words_;
+    };
+
+    SpirvAssembler vertex_shader()
+    {
+        SpirvAssembler spirv;
+        spirv.op(kOpCapability, {1});
+        spirv.op(kOpMemoryModel, {0, 1});
+        spirv.op_string(kOpEntryPoint, {0, kMain}, "main", {kPosition, kColor, kIndex, kTransform});
+
+        spirv.op_string(kOpName, {kCamera}, "camera");
+        spirv.op_string(kOpName, {kParticlesStruct}, "Particles");
+        spirv.op_string(kOpName, {kTextures}, "textures");
+        spirv.op_string(kOpName, {kPosition}, "in_position");
+        spirv.op_string(kOpName, {kSpecA}, "spec_a");
+        spirv.op_string(kOpName, {kSpecB}, "spec_b");
+
+        spirv.op(kOpDecorate, {kPosition, kDecorationLocation, 0});
+        spirv.op(kOpDecorate, {kColor, kDecorationLocation, 1});
+        spirv.op(kOpDecorate, {kIndex, kDecorationLocation, 2});
+        spirv.op(kOpDecorate, {kTransform, kDecorationLocation, 3});
+        spirv.op(kOpDecorate, {kCameraStruct, kDecorationBlock});
+        spirv.op(kOpMemberDecorate, {kCameraStruct, 0, kDecorationOffset, 0});
+        spirv.op(kOpMemberDecorate, {kCameraStruct, 0, kDecorationMatrixStride, 16});
+        spirv.op(kOpMemberDecorate, {kCameraStruct, 1, kDecorationOffset, 64});
+        spirv.op(kOpDecorate, {kCamera, kDecorationDescriptorSet, 0});
+        spirv.op(kOpDecorate, {kCamera, kDecorationBinding, 0});
+        spirv.op(kOpDecorate, {kFloatRuntimeArray, kDecorationArrayStride, 4});
+        spirv.op(kOpDecorate, {kParticlesStruct, kDecorationBlock});
+        spirv.op(kOpMemberDecorate, {kParticlesStruct, 0, kDecorationOffset, 0});
+        spirv.op(kOpMemberDecorate, {kParticlesStruct, 1, kDecorationOffset, 4});
+        spirv.op(kOpDecorate, {kParticles, kDecorationDescriptorSet, 1});
+        spirv.op(kOpDecorate, {kParticles, kDecorationBinding, 0});
+        spirv.op(kOpDecorate, {kTextures, kDecorationDescriptorSet, 1});
+        spirv.op(kOpDecorate, {kTextures, kDecorationBinding, 2});
+        spirv.op(kOpDecorate, {kPushStruct, kDecorationBlock});
+        spirv.op(kOpMemberDecorate, {kPushStruct, 0, kDecorationOffset, 16});
+        spirv.op(kOpMemberDecorate, {kPushStruct, 1, kDecorationOffset, 32});
+        spirv.op(kOpDecorate, {kSpecA, kDecorationSpecId, 7});
+        spirv.op(kOpDecorate, {kSpecB, kDecorationSpecId, 3});
+
+        spirv.op(kOpTypeVoid, {kVoid});
+        spirv.op(kOpTypeFunction, {kFunctionType, kVoid});
+        spirv.op(kOpTypeFloat, {kFloat, 32});
+        spirv.op(kOpTypeInt, {kUint, 32, 0});
+        spirv.op(kOpTypeVector, {kVec2, kFloat, 2});
+        spirv.op(kOpTypeVector, {kVec4, kFloat, 4});
+        spirv.op(kOpTypeMatrix, {kMat2, kVec2, 2});
+        spirv.op(kOpTypeMatrix, {kMat4, kVec4, 4});
+        spirv.op(kOpConstant, {kUint, kFour, 4});
+        spirv.op(kOpSpecConstant, {kUint, kSpecA, 1});
+        spirv.op(kOpSpecConstant, {kUint, kSpecB, 0});
+
+        // uniform block of a matrix and a vector, 80 bytes
+        spirv.op(kOpTypeStruct, {kCameraStruct, kMat4, kVec4});
+        spirv.op(kOpTypePointer, {kCameraPointer, kStorageUniform, kCameraStruct});
+        spirv.op(kOpVariable, {kCameraPointer, kCamera, kStorageUniform});
+
+        // storage block ending in a runtime array, only the count is sized
+        spirv.op(kOpTypeRuntimeArray, {kFloatRuntimeArray, kFloat});
+        spirv.op(kOpTypeStruct, {kParticlesStruct, kUint, kFloatRuntimeArray});
+        spirv.op(kOpTypePointer, {kParticlesPointer, kStorageStorageBuffer, kParticlesStruct});
+        spirv.op(kOpVariable, {kParticlesPointer, kParticles, kStorageStorageBuffer});
+
+        // four combined image samplers
+        spirv.op(kOpTypeImage, {kImage, kFloat, 1, 0, 0, 0, 1, 0});
+        spirv.op(kOpTypeSampledImage, {kSampledImage, kImage});
+        spirv.op(kOpTypeArray, {kSampledImageArray, kSampledImage, kFour});
+        spirv.op(kOpTypePointer, {kTexturesPointer, kStorageUniformConstant, kSampledImageArray});
+        spirv.op(kOpVariable, {kTexturesPointer, kTextures, kStorageUniformConstant});
+
+        // push constants from byte 16 to byte 36
+        spirv.op(kOpTypeStruct, {kPushStruct, kVec4, kFloat});
+        spirv.op(kOpTypePointer, {kPushPointer, kStoragePushConstant, kPushStruct});
+        spirv.op(kOpVariable, {kPushPointer, kPush, kStoragePushConstant});
+
+        spirv.op(kOpTypePointer, {kVec2InputPointer, kStorageInput, kVec2});
+        spirv.op(kOpTypePointer, {kVec4InputPointer, kStorageInput, kVec4});
+        spirv.op(kOpTypePointer, {kUintInputPointer, kStorageInput, kUint});
+        spirv.op(kOpTypePointer, {kMat2InputPointer, kStorageInput, kMat2});
+        spirv.op(kOpVariable, {kVec2InputPointer, kPosition, kStorageInput});
+        spirv.op(kOpVariable, {kVec4InputPointer, kColor, kStorageInput});
+        spirv.op(kOpVariable, {kUintInputPointer, kIndex, kStorageInput});
+        spirv.op(kOpVariable, {kMat2InputPointer, kTransform, kStorageInput});
+
+        // only position and color are read
+        spirv.op(kOpFunction, {kVoid, kMain, 0, kFunctionType});
+        spirv.op(kOpLabel, {kLabel});
+        spirv.op(kOpLoad, {kVec2, kLoadedPosition, kPosition});
+        spirv.op(kOpLoad, {kVec4, kLoadedColor, kColor});
+        spirv.op(kOpReturn, {});
+        spirv.op(kOpFunctionEnd, {});
+        return spirv;
+    }
+
+    const SVulkanReflectedBinding *find_binding(const SVulkanShaderReflection &reflection, uint32_t set, uint32_t binding)
+    {
+        for (const auto &reflected : reflection.bindings)
+        {
+            if (reflected.set == set && reflected.binding == binding)
+                return &reflected;
+        }
+        return nullptr;
+    }
+
+    void test_vertex_shader()
+    {
+        SVulkanShaderReflection reflection;
+        if (!VulkanShaderReflection::Reflect(vertex_shader().words(), reflection))
+        {
+            check(false, "the vertex fixture was rejected");
+            return;
+        }
+        check(reflection.stage == VK_SHADER_STAGE_VERTEX_BIT, "wrong stage");
+        check(reflection.entry_point == "main", "wrong entry point");
+
+        // bindings
+        check(reflection.bindings.size() == 3, "expected three bindings");
+        const auto *camera = find_binding(reflection, 0, 0);
+        check(camera != nullptr && camera->descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && camera->descriptor_count == 1 &&
+                  camera->block_size == 80 && camera->name == "camera",
+              "set 0 binding 0 is not the 80 byte camera uniform buffer");
+        const auto *particles = find_binding(reflection, 1, 0);
+        check(particles != nullptr && particles->descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER && particles->block_size == 4 &&
+                  particles->name == "Particles",
+              "set 1 binding 0 is not the storage buffer named by its block");
+        const auto *textures = find_binding(reflection, 1, 2);
+        check(textures != nullptr && textures->descriptor_type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && textures->descriptor_count == 4,
+              "set 1 binding 2 is not an array of four combined image samplers");
+
+        // push constants
+        check(reflection.push_constant_ranges.size() == 1, "expected one push constant range");
+        if (reflection.push_constant_ranges.size() == 1)
+        {
+            const auto &range = reflection.push_constant_ranges[0];
+            check(range.stageFlags == VK_SHADER_STAGE_VERTEX_BIT && range.offset == 16 && range.size == 20,
+                  "push constant range does not start at the first member");
+        }
+
+        // vertex inputs, the matrix takes one location per column
+        check(reflection.vertex_inputs.size() == 5, "expected five vertex input locations");
+        if (reflection.vertex_inputs.size() == 5)
+        {
+            const auto &inputs = reflection.vertex_inputs;
+            check(inputs[0].location == 0 && inputs[0].format == VK_FORMAT_R32G32_SFLOAT && inputs[0].used && inputs[0].name == "in_position",
+                  "location 0 is not the used vec2 position");
+            check(inputs[1].location == 1 && inputs[1].format == VK_FORMAT_R32G32B32A32_SFLOAT && inputs[1].used,
+                  "location 1 is not the used vec4 color");
+            check(inputs[2].location == 2 && inputs[2].format == VK_FORMAT_R32_UINT && !inputs[2].used,
+                  "location 2 is not the unused uint index");
+            check(inputs[3].location == 3 && inputs[4].location == 4 && inputs[3].format == VK_FORMAT_R32G32_SFLOAT &&
+                      inputs[4].format == VK_FORMAT_R32G32_SFLOAT && !inputs[3].used,
+                  "the mat2 input does not span locations 3 and 4");
+        }
+
+        // specialization constants, sorted by constant id
+        check(reflection.specialization_constants.size() == 2, "expected two specialization constants");
+        if (reflection.specialization_constants.size() == 2)
+        {
+            check(reflection.specialization_constants[0].constant_id == 3 && reflection.specialization_constants[0].name == "spec_b" &&
+                      reflection.specialization_constants[1].constant_id == 7 && reflection.specialization_constants[1].name == "spec_a",
+                  "specialization constants do not match their SpecId");
+        }
+
+        // only the attributes the shader reads are selected
+        std::vector<VkVertexInputAttributeDescription> available = {
+            {0, 0, VK_FORMAT_R32G32_SFLOAT, 0},
+            {1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, 8},
+            {2, 0, VK_FORMAT_R32_UINT, 24}};
+        std::vector<VkVertexInputAttributeDescription> selected;
+        check(VulkanShaderReflection::SelectVertexAttributes(reflection, available, selected) && selected.size() == 2 &&
+                  selected[0].location == 0 && selected[1].location == 1,
+              "attribute selection kept an unused location");
+        available.erase(available.begin() + 1);
+        check(!VulkanShaderReflection::SelectVertexAttributes(reflection, available, selected),
+              "attribute selection accepted a vertex format missing a used location");
+
+        // stages sharing a binding combine their flags, stages disagreeing on it are rejected
+        SVulkanShaderReflection fragment = reflection;
+        fragment.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> set_layouts;
+        check(VulkanShaderReflection::MergeSetLayouts({&reflection, &fragment}, set_layouts) && set_layouts.size() == 2 &&
+                  set_layouts[0].size() == 1 && set_layouts[1].size() == 2 &&
+                  set_layouts[0][0].stageFlags == (VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
+              "merged set layouts do not combine the stages");
+        fragment.bindings[0].descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        check(!VulkanShaderReflection::MergeSetLayouts({&reflection, &fragment}, set_layouts),
+              "merging accepted two stages declaring one binding differently");
+
+        SVulkanShaderReflection second_block = reflection;
+        second_block.push_constant_ranges[0] = {VK_SHADER_STAGE_VERTEX_BIT, 0, 8};
+        auto ranges = VulkanShaderReflection::MergePushConstantRanges({&reflection, &second_block});
+        check(ranges.size() == 1 && ranges[0].offset == 0 && ranges[0].size == 36,
+              "push constant blocks of one stage are not widened into one range");
+    }
+
+    void expect_rejected(const std::vector<uint32_t> &spirv, const char *message)
+    {
+        SVulkanShaderReflection reflection;
+        check(!VulkanShaderReflection::Reflect(spirv, reflection), message);
+    }
+
+    void test_malformed_modules()
+    {
+        std::vector<uint32_t> not_spirv = vertex_shader().words();
+        not_spirv[0] = 0;
+        expect_rejected(not_spirv, "accepted a module without the magic number");
+
+        SpirvAssembler past_end = vertex_shader();
+        past_end.raw(kOpTypeVector, 4, {kBound, kFloat});
+        expect_rejected(past_end.words(), "accepted an instruction running past the module");
+
+        SpirvAssembler empty_name = vertex_shader();
+        empty_name.raw(kOpName, 2, {kCamera});
+        expect_rejected(empty_name.words(), "accepted an OpName without a string");
+
+        SpirvAssembler empty_entry_point = vertex_shader();
+        empty_entry_point.raw(kOpEntryPoint, 3, {0, kMain});
+        expect_rejected(empty_entry_point.words(), "accepted an OpEntryPoint without a name");
+
+        SpirvAssembler short_image = vertex_shader();
+        short_image.raw(kOpTypeImage, 8, {kBound, kFloat, 1, 0, 0, 0, 1});
+        expect_rejected(short_image.words(), "accepted an OpTypeImage without its sampled operand");
+
+        SpirvAssembler short_pointer = vertex_shader();
+        short_pointer.raw(kOpTypePointer, 3, {kBound, kStorageUniform});
+        expect_rejected(short_pointer.words(), "accepted an OpTypePointer without its pointee");
+
+        SpirvAssembler short_variable = vertex_shader();
+        short_variable.raw(kOpVariable, 3, {kCameraPointer, kBound});
+        expect_rejected(short_variable.words(), "accepted an OpVariable without its storage class");
+
+        SpirvAssembler short_decorate = vertex_shader();
+        short_decorate.raw(kOpDecorate, 2, {kCamera});
+        expect_rejected(short_decorate.words(), "accepted an OpDecorate without a decoration");
+
+        SpirvAssembler short_member_decorate = vertex_shader();
+        short_member_decorate.raw(kOpMemberDecorate, 3, {kCameraStruct, 0});
+        expect_rejected(short_member_decorate.words(), "accepted an OpMemberDecorate without a decoration");
+
+        SpirvAssembler zero_words = vertex_shader();
+        zero_words.raw(kOpLoad, 0, {});
+        expect_rejected(zero_words.words(), "accepted an instruction of zero words");
+    }
+
+    void test_hash_code()
+    {
+        std::vector<uint32_t> spirv = vertex_shader().words();
+        std::vector<uint32_t> copy = spirv;
+        check(VulkanShaderLibrary::HashCode(spirv) == VulkanShaderLibrary::HashCode(copy), "identical SPIR-V hashed to different keys");
+        check(VulkanShaderLibrary::HashCode(spirv) != VulkanShaderLibrary::INVALID_KEY, "a module hashed to the invalid key");
+        copy.back() ^= 1;
+        check(VulkanShaderLibrary::HashCode(spirv) != VulkanShaderLibrary::HashCode(copy), "a changed word kept the key");
+    }
+
+    void test_shader_library()
+    {
+        VkApplicationInfo app_info{};
+        app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        app_info.pApplicationName = "shader_reflection_test";
+        app_info.apiVersion = VK_API_VERSION_1_3;
+
+        VkInstanceCreateInfo instance_info{};
+        instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instance_info.pApplicationInfo = &app_info;
+
+        VkInstance instance = VK_NULL_HANDLE;
+        if (vkCreateInstance(&instance_info, nullptr, &instance) != VK_SUCCESS)
+        {
+            std::cerr << "shader_reflection_test: no vulkan instance, shader library cases skipped" << std::endl;
+            return;
+        }
+
+        uint32_t device_count = 1;
+        VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+        VkResult enumerate_result = vkEnumeratePhysicalDevices(instance, &device_count, &physical_device);
+        float queue_priority = 1.0f;
+        VkDeviceQueueCreateInfo queue_info{};
+        queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queue_info.queueFamilyIndex = 0;
+        queue_info.queueCount = 1;
+        queue_info.pQueuePriorities = &queue_priority;
+        VkDeviceCreateInfo device_info{};
+        device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        device_info.queueCreateInfoCount = 1;
+        device_info.pQueueCreateInfos = &queue_info;
+        VkDevice device = VK_NULL_HANDLE;
+        if ((enumerate_result != VK_SUCCESS && enumerate_result != VK_INCOMPLETE) || device_count == 0 ||
+            vkCreateDevice(physical_device, &device_info, nullptr, &device) != VK_SUCCESS)
+        {
+            std::cerr << "shader_reflection_test: no vulkan device, shader library cases skipped" << std::endl;
+            vkDestroyInstance(instance, nullptr);
+            return;
+        }
+
+        {
+            VulkanShaderLibrary library(device);
+            std::vector<uint32_t> spirv = vertex_shader().words();
+
+            // identical code is one module under its content hash
+            uint64_t key = library.AddShader(EShaderType::kVertexShader, spirv);
+            check(key == VulkanShaderLibrary::HashCode(spirv), "a module is not keyed by its content hash");
+            std::vector<uint32_t> copy = spirv;
+            check(library.AddShader(EShaderType::kVertexShader, copy) == key && library.GetModuleCount() == 1,
+                  "identical SPIR-V created a second module");
+
+            // declared names become constants under their SpecId, everything else is dropped
+            auto constants = library.Specialize(key, {{"spec_a", 5}, {"spec_b", 0}, {"use_vertex_color", 1}});
+            check(constants.size() == 2, "specialization kept a name the module does not declare");
+            if (constants.size() == 2)
+            {
+                check(constants[0].constant_id == 3 && constants[0].value == 0 && constants[1].constant_id == 7 && constants[1].value == 5,
+                      "specialization constants do not carry the declared ids and the given values");
+            }
+            check(library.Specialize(key, {{"alpha_mask", 1}}).empty(), "an undeclared feature produced a constant");
+            check(library.Specialize(VulkanShaderLibrary::INVALID_KEY, {{"spec_a", 5}}).empty(),
+                  "an unknown module produced constants");
+
+            VkShaderModule module = library.Release(key);
+            check(module != VK_NULL_HANDLE && library.GetModuleCount() == 0, "release did not hand back the module");
+            vkDestroyShaderModule(device, module, nullptr);
+        }
+
+        vkDestroyDevice(device, nullptr);
+        vkDestroyInstance(instance, nullptr);
+    }
+}
+
+int main()
+{
+    test_vertex_shader();
+    test_malformed_modules();
+    test_hash_code();
+    test_shader_library();
+    return g_failures == 0 ? 0 : 1;
+}
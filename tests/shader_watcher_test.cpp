@@ -0,0 +1,116 @@
+#include "_old/vulkan_shader_watcher.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// runs the watcher on a temporary directory with a stub compiler that copies its input to the -o path,
+// a changed source has to come back as its .spv exactly once, a .spv next to its source is never reported
+
+namespace
+{
+    int g_failures = 0;
+
+    void check(bool condition, const char *message)
+    {
+        if (!condition)
+        {
+            std::cerr << "shader_watcher_test: " << message << std::endl;
+            ++g_failures;
+        }
+    }
+
+    constexpr std::chrono::milliseconds kPollInterval{20};
+    constexpr std::chrono::milliseconds kTimeout{5000};
+
+    void write_file(const std::filesystem::path &path, const std::string &contents)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << contents;
+    }
+
+    std::string read_file(const std::filesystem::path &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // collects reports until one arrives or the timeout passes
+    std::vector<std::filesystem::path> wait_for_changes(VulkanShaderWatcher &watcher)
+    {
+        auto deadline = std::chrono::steady_clock::now() + kTimeout;
+        std::vector<std::filesystem::path> changed;
+        while (changed.empty() && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(kPollInterval);
+            changed = watcher.TakeChangedShaders();
+        }
+        return changed;
+    }
+
+    void write_stub_compiler(const std::filesystem::path &path)
+    {
+        write_file(path,
+                   "#!/bin/sh\n"
+                   "while [ $# -gt 0 ]; do\n"
+                   "    if [ \"$1\" = \"-o\" ]; then output=\"$2\"; shift 2; else source=\"$1\"; shift; fi\n"
+                   "done\n"
+                   "cp \"$source\" \"$output\"\n");
+        std::filesystem::permissions(path,
+                                     std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec |
+                                         std::filesystem::perms::others_exec,
+                                     std::filesystem::perm_options::add);
+    }
+}
+
+int main()
+{
+#if defined(_WIN32)
+    std::cerr << "shader_watcher_test: the stub compiler is a shell script, skipped" << std::endl;
+    return 77;
+#else
+    auto root = std::filesystem::temp_directory_path() /
+                ("shader_watcher_test_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    auto shader_directory = root / "shaders";
+    std::filesystem::create_directories(shader_directory);
+    write_stub_compiler(root / "compile.sh");
+
+    {
+        VulkanShaderWatcher watcher(SVulkanShaderWatcherConfig{
+            .shader_directory = shader_directory.string(), .compiler = (root / "compile.sh").string(), .poll_interval = kPollInterval});
+        check(watcher.Start(), "the watcher did not start on an existing directory");
+
+        // a new source is compiled next to itself and reported once
+        write_file(shader_directory / "x.vert", "#version 450\nvoid main() {}\n");
+        auto changed = wait_for_changes(watcher);
+        check(changed.size() == 1 && changed[0] == shader_directory / "x.vert.spv", "the changed source was not reported as its .spv");
+        check(read_file(shader_directory / "x.vert.spv") == "#version 450\nvoid main() {}\n", "the stub compiler output is missing");
+
+        // the compiler's own write of x.vert.spv must not come back as a second change
+        std::this_thread::sleep_for(kPollInterval * 10);
+        check(watcher.TakeChangedShaders().empty(), "the rebuilt .spv was reported twice");
+
+        // a .spv next to its source is left to the source, one without a source is reported as it is
+        write_file(shader_directory / "x.vert.spv", "stale");
+        write_file(shader_directory / "y.spv", "prebuilt");
+        changed = wait_for_changes(watcher);
+        std::this_thread::sleep_for(kPollInterval * 10);
+        auto late = watcher.TakeChangedShaders();
+        changed.insert(changed.end(), late.begin(), late.end());
+        check(std::find(changed.begin(), changed.end(), shader_directory / "y.spv") != changed.end(),
+              "a .spv without a source was not reported");
+        check(std::find(changed.begin(), changed.end(), shader_directory / "x.vert.spv") == changed.end(),
+              "a .spv with a sibling source was reported");
+
+        watcher.Stop();
+    }
+
+    std::error_code error;
+    std::filesystem::remove_all(root, error);
+    return g_failures == 0 ? 0 : 1;
+#endif
+}
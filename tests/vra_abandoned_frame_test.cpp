@@ -0,0 +1,352 @@
+#include "_vra/defragmenter.h"
+#include "_vra/upload.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// a frame recorded with defragmentation copies and ownership acquires is abandoned, its serial still retires through
+// an empty batch: the copies must not count as done and the acquires must be recorded again by the next frame
+
+namespace
+{
+    constexpr uint32_t kBufferCount = 8;
+    constexpr VkDeviceSize kBufferSize = 64 * 1024;
+    constexpr uint32_t kWordCount = static_cast<uint32_t>(kBufferSize / sizeof(uint32_t));
+
+    int g_failures = 0;
+
+    void check(bool condition, const char *message)
+    {
+        if (!condition)
+        {
+            std::cerr << "vra_abandoned_frame_test: " << message << std::endl;
+            ++g_failures;
+        }
+    }
+
+    struct SFrameContext
+    {
+        VkDevice device = VK_NULL_HANDLE;
+        VkQueue queue = VK_NULL_HANDLE;
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    };
+
+    void begin_frame(const SFrameContext &context)
+    {
+        vkResetCommandBuffer(context.command_buffer, 0);
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(context.command_buffer, &begin_info);
+    }
+
+    // submits and waits, the frame has retired when this returns
+    bool submit_frame(const SFrameContext &context)
+    {
+        vkEndCommandBuffer(context.command_buffer);
+        VkCommandBufferSubmitInfo command_buffer_info{};
+        command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        command_buffer_info.commandBuffer = context.command_buffer;
+        VkSubmitInfo2 submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        submit_info.commandBufferInfoCount = 1;
+        submit_info.pCommandBufferInfos = &command_buffer_info;
+        return vkQueueSubmit2(context.queue, 1, &submit_info, VK_NULL_HANDLE) == VK_SUCCESS && vkQueueWaitIdle(context.queue) == VK_SUCCESS;
+    }
+
+    uint32_t pattern(uint32_t buffer, uint32_t word)
+    {
+        return (buffer << 24) | word;
+    }
+
+    bool holds_pattern(VmaAllocator allocator, VmaAllocation allocation, uint32_t buffer)
+    {
+        void *data = nullptr;
+        if (vmaMapMemory(allocator, allocation, &data) != VK_SUCCESS)
+            return false;
+        vmaInvalidateAllocation(allocator, allocation, 0, VK_WHOLE_SIZE);
+        const auto *words = static_cast<const uint32_t *>(data);
+        bool intact = true;
+        for (uint32_t word = 0; word < kWordCount && intact; ++word)
+            intact = words[word] == pattern(buffer, word);
+        vmaUnmapMemory(allocator, allocation);
+        return intact;
+    }
+
+    void test_defragmentation(const SFrameContext &context, VmaAllocator allocator)
+    {
+        VkBufferCreateInfo buffer_info{};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size = kBufferSize;
+        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        // host visible so the contents can be checked where the buffers end up
+        VmaAllocationCreateInfo allocation_info{};
+        allocation_info.usage = VMA_MEMORY_USAGE_AUTO;
+        allocation_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+        uint32_t memory_type_index = 0;
+        if (vmaFindMemoryTypeIndexForBufferInfo(allocator, &buffer_info, &allocation_info, &memory_type_index) != VK_SUCCESS)
+        {
+            check(false, "no host visible memory type for the test buffers");
+            return;
+        }
+
+        // four buffers per block, the first three of block 0 are freed so block 1 can move into them
+        VmaPoolCreateInfo pool_info{};
+        pool_info.memoryTypeIndex = memory_type_index;
+        pool_info.blockSize = kBufferSize * 4;
+        VmaPool pool = VK_NULL_HANDLE;
+        if (vmaCreatePool(allocator, &pool_info, &pool) != VK_SUCCESS)
+        {
+            check(false, "failed to create the test pool");
+            return;
+        }
+        allocation_info.pool = pool;
+
+        std::vector<VkBuffer> buffers(kBufferCount, VK_NULL_HANDLE);
+        std::vector<VmaAllocation> allocations(kBufferCount, VK_NULL_HANDLE);
+        for (uint32_t i = 0; i < kBufferCount; ++i)
+        {
+            void *data = nullptr;
+            if (vmaCreateBuffer(allocator, &buffer_info, &allocation_info, &buffers[i], &allocations[i], nullptr) != VK_SUCCESS ||
+                vmaMapMemory(allocator, allocations[i], &data) != VK_SUCCESS)
+            {
+                check(false, "failed to create a test buffer");
+                return;
+            }
+            auto *words = static_cast<uint32_t *>(data);
+            for (uint32_t word = 0; word < kWordCount; ++word)
+                words[word] = pattern(i, word);
+            vmaFlushAllocation(allocator, allocations[i], 0, VK_WHOLE_SIZE);
+            vmaUnmapMemory(allocator, allocations[i]);
+        }
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            vmaDestroyBuffer(allocator, buffers[i], allocations[i]);
+            buffers[i] = VK_NULL_HANDLE;
+        }
+
+        vra::VraDefragmenter defragmenter(context.device,
+                                          allocator,
+                                          {.pool = pool, .algorithm = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FULL_BIT});
+        uint32_t relocations = 0;
+        for (uint32_t i = 3; i < kBufferCount; ++i)
+        {
+            defragmenter.RegisterBuffer(buffers[i],
+                                        allocations[i],
+                                        buffer_info,
+                                        [&, i](const vra::VraRelocation &relocation)
+                                        {
+                                            buffers[i] = relocation.new_buffer;
+                                            ++relocations;
+                                        });
+        }
+        check(defragmenter.Begin(), "failed to begin defragmentation");
+
+        // frame 1 records the copies and is abandoned, an empty batch retires its serial
+        begin_frame(context);
+        defragmenter.Tick(context.command_buffer, 1, 0);
+        vkEndCommandBuffer(context.command_buffer);
+        check(defragmenter.IsActive(), "the fragmented pool proposed no moves");
+        defragmenter.AbortRecordedPass(1);
+
+        // frame 2 sees serial 1 retired, the copies it held never ran so nothing may move yet
+        begin_frame(context);
+        defragmenter.Tick(context.command_buffer, 2, 1);
+        check(relocations == 0, "an abandoned pass handed out destinations whose copies never ran");
+        // frame 2 is submitted, aborting another frame leaves its copies alone
+        defragmenter.AbortRecordedPass(1);
+        check(submit_frame(context), "failed to submit frame 2");
+
+        // every later frame is submitted and retires before the next one records
+        uint64_t serial = 3;
+        for (; defragmenter.IsActive() && serial < 64; ++serial)
+        {
+            begin_frame(context);
+            defragmenter.Tick(context.command_buffer, serial, serial - 1);
+            check(submit_frame(context), "failed to submit a frame");
+        }
+        check(!defragmenter.IsActive(), "defragmentation did not finish");
+        check(relocations > 0, "nothing was relocated");
+        check(defragmenter.GetLastReport().stats.allocationsMoved == relocations, "moves and relocations disagree");
+
+        for (uint32_t i = 3; i < kBufferCount; ++i)
+        {
+            check(holds_pattern(allocator, allocations[i], i), "a buffer lost its contents across the abandoned frame");
+            defragmenter.UnregisterBuffer(allocations[i]);
+            vmaDestroyBuffer(allocator, buffers[i], allocations[i]);
+        }
+        vmaDestroyPool(allocator, pool);
+    }
+
+    void test_upload_acquires(const SFrameContext &context, VmaAllocator allocator, uint32_t queue_family)
+    {
+        vra::VraUploadManager upload_manager(context.device,
+                                             allocator,
+                                             {.transfer_queue = context.queue,
+                                              .transfer_queue_family = queue_family,
+                                              .graphics_queue_family = queue_family,
+                                              .staging_ring = {.size = kBufferSize}});
+        if (!upload_manager.Create())
+        {
+            check(false, "failed to create the upload manager");
+            return;
+        }
+
+        VkBufferCreateInfo buffer_info{};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size = kBufferSize;
+        buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VmaAllocationCreateInfo allocation_info{};
+        allocation_info.usage = VMA_MEMORY_USAGE_AUTO;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        if (vmaCreateBuffer(allocator, &buffer_info, &allocation_info, &buffer, &allocation, nullptr) != VK_SUCCESS)
+        {
+            check(false, "failed to create the upload destination");
+            return;
+        }
+
+        std::vector<uint32_t> data(kWordCount, 0xA5A5A5A5u);
+        vra::VraBufferUpload upload{};
+        upload.dst_buffer = buffer;
+        upload.data = data.data();
+        upload.size = kBufferSize;
+        check(upload_manager.Enqueue(upload), "failed to queue the upload");
+        uint64_t upload_value = upload_manager.Submit();
+        check(upload_value != 0, "failed to submit the upload");
+
+        // frame 1 records the acquire and is abandoned
+        begin_frame(context);
+        check(upload_manager.RecordAcquireBarriers(context.command_buffer, 1) == upload_value, "frame 1 did not acquire the upload");
+        vkEndCommandBuffer(context.command_buffer);
+        upload_manager.AbortAcquireBarriers(1);
+
+        // frame 2 has to acquire it again, aborting the stale serial afterwards changes nothing
+        begin_frame(context);
+        check(upload_manager.RecordAcquireBarriers(context.command_buffer, 2) == upload_value, "the abandoned acquire was lost");
+        upload_manager.AbortAcquireBarriers(1);
+        vkEndCommandBuffer(context.command_buffer);
+
+        begin_frame(context);
+        check(upload_manager.RecordAcquireBarriers(context.command_buffer, 3) == 0, "a submitted acquire was recorded twice");
+        vkEndCommandBuffer(context.command_buffer);
+
+        check(upload_manager.Wait(upload_value), "the upload did not complete");
+        vmaDestroyBuffer(allocator, buffer, allocation);
+    }
+}
+
+int main()
+{
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "vra_abandoned_frame_test";
+    app_info.apiVersion = VK_API_VERSION_1_3;
+
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&instance_info, nullptr, &instance) != VK_SUCCESS)
+    {
+        std::cerr << "vra_abandoned_frame_test: no vulkan 1.3 instance, skipped" << std::endl;
+        return 77;
+    }
+
+    uint32_t device_count = 1;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkResult enumerate_result = vkEnumeratePhysicalDevices(instance, &device_count, &physical_device);
+    VkPhysicalDeviceProperties properties{};
+    if ((enumerate_result == VK_SUCCESS || enumerate_result == VK_INCOMPLETE) && device_count != 0)
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_3)
+    {
+        std::cerr << "vra_abandoned_frame_test: no vulkan 1.3 device, skipped" << std::endl;
+        vkDestroyInstance(instance, nullptr);
+        return 77;
+    }
+
+    // graphics and compute families support transfers too, copies and uploads run on the same queue
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families.data());
+    uint32_t queue_family = 0;
+    while (queue_family < family_count &&
+           !(families[queue_family].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT)))
+        ++queue_family;
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkPhysicalDeviceVulkan13Features features_13{};
+    features_13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    features_13.synchronization2 = VK_TRUE;
+    VkPhysicalDeviceVulkan12Features features_12{};
+    features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features_12.pNext = &features_13;
+    features_12.timelineSemaphore = VK_TRUE;
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.pNext = &features_12;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+
+    VkDevice device = VK_NULL_HANDLE;
+    if (queue_family == family_count || vkCreateDevice(physical_device, &device_info, nullptr, &device) != VK_SUCCESS)
+    {
+        std::cerr << "vra_abandoned_frame_test: failed to create the device, skipped" << std::endl;
+        vkDestroyInstance(instance, nullptr);
+        return 77;
+    }
+
+    VmaAllocatorCreateInfo allocator_info{};
+    allocator_info.vulkanApiVersion = VK_API_VERSION_1_3;
+    allocator_info.instance = instance;
+    allocator_info.physicalDevice = physical_device;
+    allocator_info.device = device;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    if (vmaCreateAllocator(&allocator_info, &allocator) != VK_SUCCESS)
+    {
+        std::cerr << "vra_abandoned_frame_test: failed to create the allocator" << std::endl;
+        vkDestroyDevice(device, nullptr);
+        vkDestroyInstance(instance, nullptr);
+        return 1;
+    }
+
+    SFrameContext context;
+    context.device = device;
+    vkGetDeviceQueue(device, queue_family, 0, &context.queue);
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+    VkCommandPool command_pool = VK_NULL_HANDLE;
+    vkCreateCommandPool(device, &pool_info, nullptr, &command_pool);
+    VkCommandBufferAllocateInfo command_buffer_info{};
+    command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_info.commandPool = command_pool;
+    command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_info.commandBufferCount = 1;
+    vkAllocateCommandBuffers(device, &command_buffer_info, &context.command_buffer);
+
+    test_defragmentation(context, allocator);
+    test_upload_acquires(context, allocator, queue_family);
+
+    vkDeviceWaitIdle(device);
+    vkDestroyCommandPool(device, command_pool, nullptr);
+    vmaDestroyAllocator(allocator);
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(instance, nullptr);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#include "_vra/vra.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
+
+// 16 producers collect concurrently while the main thread keeps merging their lists through Batch,
+// the final batch must hold every item exactly once, in resource id order, with its own payload
+
+namespace
+{
+    constexpr uint32_t kProducerCount = 16;
+    constexpr uint32_t kItemsPerProducer = 1024;
+    constexpr uint32_t kTotalItems = kProducerCount * kItemsPerProducer;
+
+    int g_failures = 0;
+
+    void check(bool condition, const char *message)
+    {
+        if (!condition)
+        {
+            std::cerr << "vra_data_batcher_test: " << message << std::endl;
+            ++g_failures;
+        }
+    }
+}
+
+int main()
+{
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "vra_data_batcher_test";
+    app_info.apiVersion = VK_API_VERSION_1_0;
+
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+    // the batcher only reads the device limits, any physical device will do
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&instance_info, nullptr, &instance) != VK_SUCCESS)
+    {
+        std::cerr << "vra_data_batcher_test: no vulkan instance, skipped" << std::endl;
+        return 77;
+    }
+    uint32_t device_count = 1;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkResult enumerate_result = vkEnumeratePhysicalDevices(instance, &device_count, &physical_device);
+    if ((enumerate_result != VK_SUCCESS && enumerate_result != VK_INCOMPLETE) || device_count == 0)
+    {
+        std::cerr << "vra_data_batcher_test: no physical device, skipped" << std::endl;
+        vkDestroyInstance(instance, nullptr);
+        return 77;
+    }
+
+    {
+        vra::VraDataBatcher batcher(physical_device);
+
+        // vertex usage, the built-in batcher pads uniform and storage items only
+        VkBufferCreateInfo buffer_info{};
+        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        vra::VraDataDesc desc(vra::VraDataMemoryPattern::GPU_Only, vra::VraDataUpdateRate::RarelyOrNever, buffer_info);
+
+        // payloads stay alive until the last Batch, Collect keeps the pointers
+        std::vector<std::vector<uint32_t>> payloads(kProducerCount, std::vector<uint32_t>(kItemsPerProducer));
+        std::vector<std::vector<vra::ResourceId>> ids(kProducerCount, std::vector<vra::ResourceId>(kItemsPerProducer));
+        std::atomic<uint32_t> failed_collects{0};
+        std::atomic<uint32_t> running_producers{kProducerCount};
+        std::atomic<bool> start{false};
+
+        std::vector<std::thread> producers;
+        for (uint32_t producer = 0; producer < kProducerCount; ++producer)
+        {
+            producers.emplace_back(
+                [&, producer]()
+                {
+                    while (!start.load())
+                        std::this_thread::yield();
+                    for (uint32_t i = 0; i < kItemsPerProducer; ++i)
+                    {
+                        // give the merging thread a chance to drain shards mid-stream
+                        if (i % 64 == 0)
+                            std::this_thread::yield();
+                        payloads[producer][i] = producer * kItemsPerProducer + i;
+                        vra::VraRawData data{&payloads[producer][i], sizeof(uint32_t)};
+                        if (!batcher.Collect(desc, data, ids[producer][i]))
+                            failed_collects.fetch_add(1);
+                    }
+                    running_producers.fetch_sub(1);
+                });
+        }
+
+        // merge while the producers are still appending
+        start.store(true);
+        uint32_t intermediate_batches = 0;
+        while (running_producers.load() != 0)
+        {
+            batcher.Batch();
+            ++intermediate_batches;
+        }
+        for (auto &producer : producers)
+            producer.join();
+
+        check(failed_collects.load() == 0, "Collect rejected an item");
+
+        std::set<vra::ResourceId> unique_ids;
+        for (const auto &producer_ids : ids)
+            unique_ids.insert(producer_ids.begin(), producer_ids.end());
+        check(unique_ids.size() == kTotalItems, "resource ids are not unique");
+
+        auto batches = batcher.Batch();
+        const auto &batch = batches[vra::VraBuiltInBatchIds::GPU_Only];
+        check(batch.offsets.size() == kTotalItems, "merged batch lost or duplicated items");
+        check(batch.consolidated_data.size() == kTotalItems * sizeof(uint32_t), "merged batch size does not match the items");
+
+        for (uint32_t producer = 0; producer < kProducerCount; ++producer)
+        {
+            for (uint32_t i = 0; i < kItemsPerProducer; ++i)
+            {
+                auto it = batch.offsets.find(ids[producer][i]);
+                if (it == batch.offsets.end())
+                {
+                    check(false, "an item is missing from the merged batch");
+                    continue;
+                }
+                // ids are handed out in order, the merge keeps that order whichever thread collected them
+                check(it->second == ids[producer][i] * sizeof(uint32_t), "merged batch is not in resource id order");
+                uint32_t value = 0;
+                std::memcpy(&value, batch.consolidated_data.data() + it->second, sizeof(uint32_t));
+                check(value == payloads[producer][i], "an item carries another item's payload");
+            }
+        }
+
+        // a second batch without new collects must give the same result
+        auto again = batcher.Batch();
+        check(again[vra::VraBuiltInBatchIds::GPU_Only].offsets.size() == kTotalItems, "batching again changed the item count");
+
+        std::cout << "vra_data_batcher_test: " << kTotalItems << " items from " << kProducerCount << " producers, "
+                  << intermediate_batches << " concurrent merges" << std::endl;
+    }
+
+    vkDestroyInstance(instance, nullptr);
+    return g_failures == 0 ? 0 : 1;
+}